@@ -3,7 +3,9 @@
 #include <tinyformat/tinyformat.h>
 #include <sys/time.h>
 #include <cstdio>
+#include <cwchar>
 #include <iomanip>
+#include <sstream>
 
 using namespace pnt;
 
@@ -47,17 +49,64 @@ class FileStreambuf2 : public std::streambuf
     int_type sputc(char_type ch)
     {
       fputc(ch, m_file);
+      return traits_type::to_int_type(ch);
     }
 
     std::streamsize sputn(const char_type* s, std::streamsize count)
     {
       fwrite(s, count, 1, m_file);
+      return count;
     }
 
   private:
     FILE* m_file;
 };
 
+// Keeps the last characters written in a fixed buffer, so that the wide
+// benchmarks measure the formatting rather than the output of wide
+// characters to a byte oriented stdout.
+template <typename CharT>
+class BufferStreambuf
+{
+  public:
+    typedef CharT char_type;
+    typedef std::char_traits<CharT> traits_type;
+    typedef typename traits_type::int_type int_type;
+
+    BufferStreambuf() :
+      m_size(0),
+      m_total(0)
+    {}
+
+    int_type sputc(char_type ch)
+    {
+      if (m_size == SIZE)
+        m_size = 0;
+      m_buf[m_size++] = ch;
+      ++m_total;
+      return traits_type::to_int_type(ch);
+    }
+
+    std::streamsize sputn(const char_type* s, std::streamsize count)
+    {
+      for (std::streamsize i = 0; i < count; ++i)
+        sputc(s[i]);
+      return count;
+    }
+
+    std::size_t total() const
+    {
+      return m_total;
+    }
+
+  private:
+    static const std::size_t SIZE = 4096;
+
+    char_type m_buf[SIZE];
+    std::size_t m_size;
+    std::size_t m_total;
+};
+
 class ScopedTimer
 {
   public:
@@ -89,6 +138,9 @@ int main()
 {
   const int nbPrints = 10000000;
 
+  // select another level with PNT_SIMD=scalar|sse2|sse4.2|avx2|avx512
+  std::cerr << "simd level: " << simd::levelName(simd::level()) << std::endl;
+
   std::cerr << "int" << std::endl;
 
   {
@@ -150,7 +202,96 @@ int main()
       fmt.print("Positive value: %+12.8d, negative value: %+12.8d\n", i, -i);
   }
 
-  return 0;
+  // the same formats, into memory, with narrow and wide characters
+  std::size_t total = 0;
+
+  std::cerr << "wchar_t int" << std::endl;
+
+  {
+    wchar_t buf[64];
+    ScopedTimer t("swprintf");
+    for (int i = 0; i < nbPrints; ++i)
+      total += swprintf(buf, 64, L"%d\n", i);
+  }
+
+  {
+    std::wostringstream stream;
+    ScopedTimer t("wostream");
+    for (int i = 0; i < nbPrints; ++i)
+    {
+      stream.seekp(0);
+      stream << i << L"\n";
+    }
+    total += stream.str().size();
+  }
+
+  {
+    BufferStreambuf<char> sb;
+    ScopedTimer t("pnt char");
+    Formatter<BufferStreambuf<char>> fmt(sb);
+    for (int i = 0; i < nbPrints; ++i)
+      fmt.print("%d\n", i);
+    total += sb.total();
+  }
+
+  {
+    BufferStreambuf<wchar_t> sb;
+    ScopedTimer t("pnt wchar_t");
+    Formatter<BufferStreambuf<wchar_t>> fmt(sb);
+    for (int i = 0; i < nbPrints; ++i)
+      fmt.print(L"%d\n", i);
+    total += sb.total();
+  }
+
+  std::cerr << "wchar_t ints, negative, precision, padding, string"
+    << std::endl;
+
+  {
+    wchar_t buf[128];
+    ScopedTimer t("swprintf");
+    for (int i = 0; i < nbPrints; ++i)
+      total += swprintf(buf, 128,
+          L"Positive value: %+12.8d, negative value: %+12.8d, %ls\n",
+          i, -i, L"done");
+  }
+
+  {
+    std::wostringstream stream;
+    ScopedTimer t("wostream");
+    for (int i = 0; i < nbPrints; ++i)
+    {
+      stream.seekp(0);
+      stream << L"Positive value: "
+        << std::showpos << std::setw(8) << std::internal
+        << std::setfill(L'0') << i
+        << L", negative value: "
+        << std::showpos << std::setw(8) << std::internal
+        << std::setfill(L'0') << -i << L", " << L"done" << L"\n";
+    }
+    total += stream.str().size();
+  }
+
+  {
+    BufferStreambuf<char> sb;
+    ScopedTimer t("pnt char");
+    Formatter<BufferStreambuf<char>> fmt(sb);
+    for (int i = 0; i < nbPrints; ++i)
+      fmt.print("Positive value: %+12.8d, negative value: %+12.8d, %s\n",
+          i, -i, "done");
+    total += sb.total();
+  }
+
+  {
+    BufferStreambuf<wchar_t> sb;
+    ScopedTimer t("pnt wchar_t");
+    Formatter<BufferStreambuf<wchar_t>> fmt(sb);
+    for (int i = 0; i < nbPrints; ++i)
+      fmt.print(L"Positive value: %+12.8d, negative value: %+12.8d, %s\n",
+          i, -i, L"done");
+    total += sb.total();
+  }
+
+  return total == 0;
 }
 
 // vim: ts=2:sw=2:sts=2:expandtab
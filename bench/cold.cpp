@@ -0,0 +1,190 @@
+// Per-call latency of Formatter::print when cycling through thousands of
+// distinct log sites, as on a server where each site runs rarely, compared
+// to a single site called in a tight loop.
+//
+// Usage: bench_cold corpus [calls] [evict-MB]
+//
+// Each distinct format string of the corpus (see corpusgen) is a log site.
+// The sites do not have code of their own: those with the same argument
+// types share an instantiation of Formatter::print, of which there are at
+// most 341, and what differs is their format string, parsed at runtime.
+// The instantiation of each site is resolved before the calls are timed.
+// The sites are called in a shuffled order, and when evict-MB is given, a
+// buffer of that size is read between the calls to evict the caches. Each
+// call is timed on its own, and the distribution of the times is reported.
+
+#include "replay.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <set>
+#include <vector>
+
+using namespace pnt;
+
+namespace
+{
+
+typedef std::chrono::steady_clock Clock;
+
+// reads one byte per cache line, the sum is returned so that the reads are
+// not optimized away
+unsigned int evict(const std::vector<unsigned char>& buffer)
+{
+  unsigned int sum = 0;
+  for (std::size_t i = 0; i < buffer.size(); i += 64)
+    sum += buffer[i];
+  return sum;
+}
+
+// smallest time between two consecutive clock reads, subtracted from the
+// samples
+double clockOverhead()
+{
+  double best = 1e9;
+  for (int i = 0; i < 10000; ++i)
+  {
+    auto start = Clock::now();
+    auto stop = Clock::now();
+    best = std::min(best,
+        std::chrono::duration<double, std::nano>(stop - start).count());
+  }
+  return best;
+}
+
+void report(const char* name, std::vector<double>& samples)
+{
+  std::sort(samples.begin(), samples.end());
+
+  double sum = 0;
+  for (double sample : samples)
+    sum += sample;
+
+  auto percentile = [&](double p)
+    {
+      return samples[static_cast<std::size_t>(p * (samples.size() - 1))];
+    };
+
+  std::cout << std::left << std::setw(16) << name << std::right
+    << std::setw(10) << sum / samples.size()
+    << std::setw(10) << percentile(0.5)
+    << std::setw(10) << percentile(0.9)
+    << std::setw(10) << percentile(0.99)
+    << std::setw(10) << percentile(0.999)
+    << std::setw(10) << samples.back() << "\n";
+}
+
+}
+
+int main(int argc, char* argv[])
+{
+  if (argc < 2)
+  {
+    std::cerr << "usage: bench_cold corpus [calls] [evict-MB]" << std::endl;
+    return 1;
+  }
+
+  unsigned long nbCalls = argc > 2 ? std::strtoul(argv[2], 0, 10) : 200000;
+  unsigned long evictSize = argc > 3 ?
+    std::strtoul(argv[3], 0, 10) * 1024 * 1024 : 0;
+
+  std::ifstream in(argv[1]);
+  if (!in)
+  {
+    std::cerr << "can't open " << argv[1] << std::endl;
+    return 1;
+  }
+
+  // one record per distinct format string
+  std::vector<corpus::Record> sites;
+  std::set<std::string> formats;
+  corpus::Record record;
+  std::string error;
+  while (corpus::read(in, record, error))
+    if (formats.insert(record.format).second)
+      sites.push_back(record);
+  if (!error.empty())
+  {
+    std::cerr << "invalid corpus: " << error << std::endl;
+    return 1;
+  }
+  if (sites.empty() || !nbCalls)
+  {
+    std::cerr << "empty corpus" << std::endl;
+    return 1;
+  }
+
+  std::mt19937 random(42);
+  std::shuffle(sites.begin(), sites.end(), random);
+
+  std::vector<Replay> replays;
+  for (const corpus::Record& site : sites)
+    replays.push_back(resolve(site));
+
+  std::vector<unsigned char> evictBuffer(evictSize, 1);
+  unsigned int evictSum = 0;
+  double overhead = clockOverhead();
+
+  NullStreambuf sb;
+  Formatter<NullStreambuf> formatter(sb);
+
+  auto run = [&](bool cycle, bool evicting)
+    {
+      std::vector<double> samples;
+      samples.reserve(nbCalls);
+
+      for (unsigned long i = 0; i < nbCalls; ++i)
+      {
+        std::size_t index = cycle ? i % sites.size() : 0;
+        const corpus::Record& site = sites[index];
+        Replay replay = replays[index];
+        if (evicting)
+          evictSum += evict(evictBuffer);
+
+        auto start = Clock::now();
+        replay(formatter, site);
+        auto stop = Clock::now();
+
+        double time = std::chrono::duration<double, std::nano>(
+            stop - start).count() - overhead;
+        samples.push_back(time > 0 ? time : 0);
+      }
+      return samples;
+    };
+
+  std::cout << "simd level:     " << simd::levelName(simd::level()) << "\n";
+  std::cout << "log sites:      " << sites.size() << "\n";
+  std::cout << "calls:          " << nbCalls << "\n";
+  std::cout << "clock overhead: " << overhead << " ns, subtracted\n";
+  std::cout << "time per call in ns\n\n";
+
+  std::cout << std::left << std::setw(16) << "scenario" << std::right
+    << std::setw(10) << "mean" << std::setw(10) << "p50"
+    << std::setw(10) << "p90" << std::setw(10) << "p99"
+    << std::setw(10) << "p99.9" << std::setw(10) << "max" << "\n";
+  std::cout << std::fixed << std::setprecision(1);
+
+  // warms up the instantiations and the clock
+  run(true, false);
+
+  std::vector<double> samples = run(false, false);
+  report("one site", samples);
+  samples = run(true, false);
+  report("all sites", samples);
+  if (evictSize)
+  {
+    // fewer calls, each eviction reads the whole buffer
+    nbCalls = std::min<unsigned long>(nbCalls, 5000);
+    samples = run(true, true);
+    report("all, evicted", samples);
+  }
+
+  return sb.size() + evictSum == 0;
+}
+
+// vim: ts=2:sw=2:sts=2:expandtab
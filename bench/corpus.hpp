@@ -0,0 +1,149 @@
+// Log corpus used by the replay benchmark.
+//
+// A corpus is a text file with one record per line: the format string
+// followed by its arguments, separated by tabulations. Each argument starts
+// with its type: i for a signed integer, u for an unsigned integer, s for a
+// string and c for a character. Backslashes, tabulations and new lines are
+// escaped as \\, \t and \n in format strings and string arguments.
+
+#ifndef PNT_BENCH_CORPUS_HPP
+#define PNT_BENCH_CORPUS_HPP
+
+#include <istream>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace corpus
+{
+
+// resolve dispatches on the argument types at runtime, each additional
+// argument multiplies the number of instantiations of Formatter::print by 4
+const std::size_t MAX_ARGS = 4;
+
+struct Arg
+{
+  char type;
+  long long i;
+  unsigned long long u;
+  std::string s;
+};
+
+struct Record
+{
+  std::string format;
+  std::vector<Arg> args;
+};
+
+inline void writeEscaped(std::ostream& out, const std::string& str)
+{
+  for (char c : str)
+    switch (c)
+    {
+      case '\\': out << "\\\\"; break;
+      case '\t': out << "\\t"; break;
+      case '\n': out << "\\n"; break;
+      default: out << c;
+    }
+}
+
+inline std::string unescape(const std::string& str)
+{
+  std::string out;
+  for (std::size_t i = 0; i < str.size(); ++i)
+  {
+    if (str[i] != '\\' || i + 1 == str.size())
+    {
+      out += str[i];
+      continue;
+    }
+
+    switch (str[++i])
+    {
+      case 't': out += '\t'; break;
+      case 'n': out += '\n'; break;
+      default: out += str[i];
+    }
+  }
+  return out;
+}
+
+inline void write(std::ostream& out, const Record& record)
+{
+  writeEscaped(out, record.format);
+  for (auto& arg : record.args)
+  {
+    out << '\t' << arg.type;
+    switch (arg.type)
+    {
+      case 'i': out << arg.i; break;
+      case 'u': out << arg.u; break;
+      default: writeEscaped(out, arg.s); break;
+    }
+  }
+  out << '\n';
+}
+
+// returns false on end of input or on a malformed line, which is reported
+// in error
+inline bool read(std::istream& in, Record& record, std::string& error)
+{
+  std::string line;
+  if (!std::getline(in, line))
+    return false;
+
+  std::vector<std::string> fields;
+  std::string::size_type start = 0, end;
+  do
+  {
+    end = line.find('\t', start);
+    fields.push_back(line.substr(start, end - start));
+    start = end + 1;
+  }
+  while (end != std::string::npos);
+
+  record.format = unescape(fields[0]);
+  record.args.clear();
+
+  if (fields.size() - 1 > MAX_ARGS)
+  {
+    error = "too many arguments: " + line;
+    return false;
+  }
+
+  for (std::size_t i = 1; i < fields.size(); ++i)
+  {
+    const std::string& field = fields[i];
+    if (field.empty())
+    {
+      error = "empty argument: " + line;
+      return false;
+    }
+
+    Arg arg = {field[0], 0, 0, unescape(field.substr(1))};
+    switch (arg.type)
+    {
+      case 'i': arg.i = std::stoll(arg.s); break;
+      case 'u': arg.u = std::stoull(arg.s); break;
+      case 's': break;
+      case 'c':
+        if (arg.s.size() != 1)
+        {
+          error = "invalid character argument: " + line;
+          return false;
+        }
+        break;
+      default:
+        error = "unknown argument type: " + line;
+        return false;
+    }
+    record.args.push_back(arg);
+  }
+
+  return true;
+}
+
+}
+
+#endif
+// vim: ts=2:sw=2:sts=2:expandtab
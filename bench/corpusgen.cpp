@@ -0,0 +1,250 @@
+// Generates a log corpus for bench_replay on the standard output.
+//
+// Usage: corpusgen [records] [sites] [seed]
+//
+// The corpus mimics server logs: a few hundred log sites, each with its own
+// format string, are hit with a skewed distribution so that a handful of them
+// dominate. Format strings mix short and long literals, padding, flags,
+// positional arguments, integers of all magnitudes and strings.
+
+#include "corpus.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <sstream>
+
+using corpus::Arg;
+using corpus::Record;
+
+namespace
+{
+
+const char* words[] = {
+  "request", "connection", "accepted", "from", "user", "session", "closed",
+  "timeout", "retrying", "cache", "miss", "hit", "bytes", "sent", "received",
+  "worker", "queue", "depth", "latency", "ms", "status", "error", "ok",
+  "shard", "replica", "lag", "commit", "offset", "partition", "flush",
+};
+
+const char* paths[] = {
+  "/", "/index.html", "/api/v1/users", "/api/v1/orders/search",
+  "/static/js/application.bundle.min.js", "/healthz",
+  "/api/v2/accounts/settings/notifications/preferences",
+};
+
+const char* hosts[] = {
+  "10.0.0.1", "192.168.12.254", "db-primary.internal", "cache-07",
+  "frontend-eu-west-1c.example.com", "localhost",
+};
+
+struct Spec
+{
+  char type;
+  std::string conversion;
+};
+
+class Generator
+{
+  public:
+    Generator(unsigned int seed) :
+      m_random(seed)
+    {}
+
+    std::size_t pick(std::size_t size)
+    {
+      return std::uniform_int_distribution<std::size_t>(0, size - 1)(
+          m_random);
+    }
+
+    bool chance(double probability)
+    {
+      return std::bernoulli_distribution(probability)(m_random);
+    }
+
+    std::string literal()
+    {
+      // mostly a few words, sometimes a long sentence
+      std::size_t nbWords = chance(0.15) ? 8 + pick(12) : 1 + pick(3);
+      std::string out;
+      for (std::size_t i = 0; i < nbWords; ++i)
+      {
+        if (i)
+          out += ' ';
+        out += words[pick(sizeof(words)/sizeof(*words))];
+      }
+      return out;
+    }
+
+    Spec spec()
+    {
+      static const char* ints[] = {"d", "d", "d", "5d", "-6d", "+d", "08d"};
+      static const char* unsigneds[] =
+        {"d", "x", "#x", "08x", "X", "o", "12d"};
+      static const char* strings[] = {"s", "s", "s", "-12s", "20s"};
+
+      double p = std::uniform_real_distribution<double>(0, 1)(m_random);
+      if (p < 0.35)
+        return Spec{'i', ints[pick(sizeof(ints)/sizeof(*ints))]};
+      if (p < 0.55)
+        return Spec{'u', unsigneds[pick(sizeof(unsigneds)/sizeof(*unsigneds))]};
+      if (p < 0.9)
+        return Spec{'s', strings[pick(sizeof(strings)/sizeof(*strings))]};
+      return Spec{'c', "c"};
+    }
+
+    long long integer()
+    {
+      // log-uniform magnitude
+      int digits = pick(19);
+      long long value = static_cast<long long>(
+          std::pow(10.0, digits + std::uniform_real_distribution<double>(
+              0, 1)(m_random)) / 10);
+      return chance(0.2) ? -value : value;
+    }
+
+    std::string string()
+    {
+      double p = std::uniform_real_distribution<double>(0, 1)(m_random);
+      if (p < 0.4)
+        return paths[pick(sizeof(paths)/sizeof(*paths))];
+      if (p < 0.7)
+        return hosts[pick(sizeof(hosts)/sizeof(*hosts))];
+      if (p < 0.9)
+        return words[pick(sizeof(words)/sizeof(*words))];
+
+      // identifiers
+      std::string out;
+      for (std::size_t i = 0, size = 8 + pick(32); i < size; ++i)
+        out += "0123456789abcdef"[pick(16)];
+      return out;
+    }
+
+    Arg value(char type)
+    {
+      Arg arg = {type, 0, 0, std::string()};
+      switch (type)
+      {
+        case 'i': arg.i = integer(); break;
+        case 'u': arg.u = static_cast<unsigned long long>(integer()); break;
+        case 's': arg.s = string(); break;
+        case 'c': arg.s = std::string(1, "IWEDF"[pick(5)]); break;
+      }
+      return arg;
+    }
+
+    // a log site: its format string and argument types
+    Record site()
+    {
+      Record record;
+      std::size_t nbArgs = pick(corpus::MAX_ARGS + 1);
+      std::vector<Spec> specs;
+      for (std::size_t i = 0; i < nbArgs; ++i)
+        specs.push_back(spec());
+
+      std::vector<std::size_t> order;
+      for (std::size_t i = 0; i < nbArgs; ++i)
+        order.push_back(i);
+
+      // positional arguments, in another order, some printed twice
+      bool positional = nbArgs > 1 && chance(0.1);
+      if (positional)
+      {
+        std::shuffle(order.begin(), order.end(), m_random);
+        order.push_back(order[pick(order.size())]);
+      }
+
+      std::string format = chance(0.3) ? "[%s] " : "";
+      if (!format.empty())
+      {
+        // the level, not positional
+        specs.insert(specs.begin(), Spec{'s', "s"});
+        for (auto& index : order)
+          ++index;
+        positional = true;
+      }
+
+      for (std::size_t index : order)
+      {
+        format += literal();
+        format += chance(0.5) ? ": " : " ";
+        format += '%';
+        if (positional)
+        {
+          std::ostringstream ss;
+          ss << index << '$';
+          format += ss.str();
+        }
+        format += specs[index].conversion;
+        format += ' ';
+      }
+      if (chance(0.5))
+        format += literal();
+      format += '\n';
+
+      record.format = format;
+      for (auto& spec : specs)
+        record.args.push_back(Arg{spec.type, 0, 0, std::string()});
+      return record;
+    }
+
+  private:
+    std::mt19937 m_random;
+};
+
+}
+
+int main(int argc, char* argv[])
+{
+  unsigned long nbRecords = argc > 1 ? std::strtoul(argv[1], 0, 10) : 100000;
+  unsigned long nbSites = argc > 2 ? std::strtoul(argv[2], 0, 10) : 300;
+  unsigned int seed = argc > 3 ? std::strtoul(argv[3], 0, 10) : 42;
+
+  if (!nbSites)
+  {
+    std::cerr << "usage: corpusgen [records] [sites] [seed]" << std::endl;
+    return 1;
+  }
+
+  Generator generator(seed);
+
+  std::vector<Record> sites;
+  for (unsigned long i = 0; i < nbSites; ++i)
+  {
+    Record site = generator.site();
+    // the level prefix takes one of the argument slots
+    if (site.args.size() > corpus::MAX_ARGS)
+      site = Record{"[%s] " + generator.literal() + "\n",
+        {Arg{'s', 0, 0, std::string()}}};
+    sites.push_back(site);
+  }
+
+  // Zipf-like popularity of the sites
+  std::vector<double> weights;
+  for (unsigned long i = 0; i < nbSites; ++i)
+    weights.push_back(1.0 / std::pow(i + 1, 1.1));
+  std::mt19937 random(seed);
+  std::discrete_distribution<unsigned long> distribution(
+      weights.begin(), weights.end());
+
+  static const char* levels[] = {"INFO", "INFO", "INFO", "WARN", "ERROR"};
+
+  for (unsigned long i = 0; i < nbRecords; ++i)
+  {
+    Record record = sites[distribution(random)];
+    for (auto& arg : record.args)
+      arg = generator.value(arg.type);
+
+    // the level prefix is always the first argument when present
+    if (record.format.compare(0, 5, "[%s] ") == 0)
+      record.args[0].s = levels[generator.pick(5)];
+
+    corpus::write(std::cout, record);
+  }
+
+  return 0;
+}
+
+// vim: ts=2:sw=2:sts=2:expandtab
@@ -0,0 +1,277 @@
+// Runs the same workloads with pnt and the standard formatting facilities,
+// writing into memory to leave I/O out of the measure, and prints a table of
+// the time per formatted item in nanoseconds.
+//
+// std::to_chars is only given the workloads it can express, it is the floor
+// pnt should aim to match for integer conversion.
+
+#include <pnt.hpp>
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#if __cplusplus >= 201703L
+#include <charconv>
+#define PNT_BENCH_TO_CHARS 1
+#endif
+
+#if defined(__has_include)
+#if __has_include(<version>)
+#include <version>
+#endif
+#endif
+
+#ifdef __cpp_lib_format
+#include <format>
+#define PNT_BENCH_FORMAT 1
+#endif
+
+using namespace pnt;
+
+class ArrayStreambuf
+{
+  public:
+    typedef char char_type;
+    typedef std::char_traits<char> traits_type;
+
+    ArrayStreambuf() :
+      m_ptr(m_buf)
+    {}
+
+    int sputc(char c)
+    {
+      if (m_ptr != m_buf + sizeof(m_buf))
+        *m_ptr++ = c;
+      return c;
+    }
+
+    std::streamsize sputn(const char* s, std::streamsize count)
+    {
+      std::streamsize room = m_buf + sizeof(m_buf) - m_ptr;
+      if (count > room)
+        count = room;
+      std::memcpy(m_ptr, s, count);
+      m_ptr += count;
+      return count;
+    }
+
+    void reset()
+    {
+      m_ptr = m_buf;
+    }
+
+    std::size_t size() const
+    {
+      return m_ptr - m_buf;
+    }
+
+  private:
+    char m_buf[256];
+    char* m_ptr;
+};
+
+struct Record
+{
+  long long integer;
+  unsigned long long hex;
+  int small;
+  int negative;
+  const char* name;
+  char status;
+};
+
+std::vector<Record> makeRecords(std::size_t count)
+{
+  static const char* names[] =
+    {"alice", "bob", "a rather long user name", "x", "carol", "dave"};
+
+  std::vector<Record> records;
+  unsigned long long state = 88172645463325252ull;
+  for (std::size_t i = 0; i < count; ++i)
+  {
+    state ^= state << 13;
+    state ^= state >> 7;
+    state ^= state << 17;
+
+    Record record;
+    // magnitudes spread over all the digit counts
+    record.integer = static_cast<long long>(
+        state >> (state % 60)) * ((state & 1) ? -1 : 1);
+    record.hex = state;
+    record.small = state % 1000;
+    record.negative = -static_cast<int>(state % 100000);
+    record.name = names[state % (sizeof(names)/sizeof(*names))];
+    record.status = 'A' + state % 26;
+    records.push_back(record);
+  }
+  return records;
+}
+
+const double NOT_AVAILABLE = -1;
+
+// Calls f for every record nbRounds times and returns the time per call in
+// nanoseconds. f returns the size it produced, added to produced to keep
+// the work observable.
+template <typename F>
+double measure(const std::vector<Record>& records, unsigned int nbRounds,
+    std::size_t& produced, F f)
+{
+  std::size_t total = 0;
+
+  auto start = std::chrono::steady_clock::now();
+  for (unsigned int round = 0; round < nbRounds; ++round)
+    for (auto& record : records)
+      total += f(record);
+  auto stop = std::chrono::steady_clock::now();
+  produced += total;
+
+  return std::chrono::duration<double, std::nano>(stop - start).count() /
+    (records.size() * nbRounds);
+}
+
+struct Workload
+{
+  const char* name;
+  std::vector<double> times;
+};
+
+int main(int argc, char* argv[])
+{
+  unsigned int nbRounds = argc > 1 ? std::atoi(argv[1]) : 200;
+  std::vector<Record> records = makeRecords(4096);
+
+  ArrayStreambuf sb;
+  Formatter<ArrayStreambuf> pnt(sb);
+  char buf[256];
+  std::ostringstream os;
+
+  std::vector<const char*> engines =
+    {"pnt", "snprintf", "to_chars", "ostringstream", "std::format"};
+  std::vector<Workload> workloads;
+  std::size_t produced = 0;
+
+  // one measure of each engine per workload, pnt has no length modifiers so
+  // snprintf gets its own format string
+#define PNT_BENCH(...) \
+  measure(records, nbRounds, produced, \
+      [&](const Record& r) -> std::size_t { __VA_ARGS__ })
+
+#define PNT_BENCH_PNT(...) \
+  PNT_BENCH(sb.reset(); pnt.print(__VA_ARGS__); return sb.size();)
+
+#define PNT_BENCH_SNPRINTF(...) \
+  PNT_BENCH(return std::snprintf(buf, sizeof(buf), __VA_ARGS__);)
+
+#ifdef PNT_BENCH_TO_CHARS
+#define PNT_BENCH_TO_CHARS_CALL(value, base) \
+  PNT_BENCH(return std::to_chars(buf, buf + sizeof(buf), value, base).ptr - buf;)
+#else
+#define PNT_BENCH_TO_CHARS_CALL(value, base) NOT_AVAILABLE
+#endif
+
+#define PNT_BENCH_OSTREAM(...) \
+  PNT_BENCH(os.seekp(0); os << __VA_ARGS__; return os.tellp();)
+
+#ifdef PNT_BENCH_FORMAT
+#define PNT_BENCH_STD_FORMAT(...) \
+  PNT_BENCH(return std::format_to_n(buf, sizeof(buf), __VA_ARGS__).size;)
+#else
+#define PNT_BENCH_STD_FORMAT(...) NOT_AVAILABLE
+#endif
+
+  workloads.push_back({"small ints", {
+      PNT_BENCH_PNT("%d", r.small),
+      PNT_BENCH_SNPRINTF("%d", r.small),
+      PNT_BENCH_TO_CHARS_CALL(r.small, 10),
+      PNT_BENCH_OSTREAM(r.small),
+      PNT_BENCH_STD_FORMAT("{}", r.small)}});
+
+  workloads.push_back({"64 bit ints", {
+      PNT_BENCH_PNT("%d", r.integer),
+      PNT_BENCH_SNPRINTF("%lld", r.integer),
+      PNT_BENCH_TO_CHARS_CALL(r.integer, 10),
+      PNT_BENCH_OSTREAM(r.integer),
+      PNT_BENCH_STD_FORMAT("{}", r.integer)}});
+
+  workloads.push_back({"negative ints", {
+      PNT_BENCH_PNT("%d", r.negative),
+      PNT_BENCH_SNPRINTF("%d", r.negative),
+      PNT_BENCH_TO_CHARS_CALL(r.negative, 10),
+      PNT_BENCH_OSTREAM(r.negative),
+      PNT_BENCH_STD_FORMAT("{}", r.negative)}});
+
+  workloads.push_back({"hex", {
+      PNT_BENCH_PNT("%x", r.hex),
+      PNT_BENCH_SNPRINTF("%llx", r.hex),
+      PNT_BENCH_TO_CHARS_CALL(r.hex, 16),
+      PNT_BENCH_OSTREAM(std::hex << r.hex << std::dec),
+      PNT_BENCH_STD_FORMAT("{:x}", r.hex)}});
+
+  workloads.push_back({"padded", {
+      PNT_BENCH_PNT("%+12d", r.negative),
+      PNT_BENCH_SNPRINTF("%+12d", r.negative),
+      NOT_AVAILABLE,
+      PNT_BENCH_OSTREAM(std::showpos << std::setw(12) << r.negative
+        << std::noshowpos),
+      PNT_BENCH_STD_FORMAT("{:+12}", r.negative)}});
+
+  workloads.push_back({"strings", {
+      PNT_BENCH_PNT("%-24s|", r.name),
+      PNT_BENCH_SNPRINTF("%-24s|", r.name),
+      NOT_AVAILABLE,
+      PNT_BENCH_OSTREAM(std::left << std::setw(24) << r.name << '|'
+        << std::right),
+      PNT_BENCH_STD_FORMAT("{:<24}|", r.name)}});
+
+  workloads.push_back({"mixed records", {
+      PNT_BENCH_PNT("user=%s id=%d small=%d flags=%#x status=%c\n",
+        r.name, r.negative, r.small, r.hex, r.status),
+      PNT_BENCH_SNPRINTF("user=%s id=%d small=%d flags=%#llx status=%c\n",
+        r.name, r.negative, r.small, r.hex, r.status),
+      NOT_AVAILABLE,
+      PNT_BENCH_OSTREAM("user=" << r.name << " id=" << r.negative
+        << " small=" << r.small << " flags=" << std::showbase << std::hex
+        << r.hex << std::dec << std::noshowbase << " status=" << r.status
+        << '\n'),
+      PNT_BENCH_STD_FORMAT("user={} id={} small={} flags={:#x} status={}\n",
+        r.name, r.negative, r.small, r.hex, r.status)}});
+
+  std::cout << "simd level: " << simd::levelName(simd::level()) << "\n";
+  std::cout << "time per item in ns, "
+    << records.size() * nbRounds << " items per cell\n\n";
+
+  std::cout << std::left << std::setw(16) << "workload" << std::right;
+  for (auto engine : engines)
+    std::cout << std::setw(15) << engine;
+  std::cout << std::setw(15) << "pnt/best" << "\n";
+
+  std::cout << std::fixed << std::setprecision(2);
+  for (auto& workload : workloads)
+  {
+    std::cout << std::left << std::setw(16) << workload.name << std::right;
+
+    double best = workload.times[0];
+    for (double time : workload.times)
+    {
+      if (time == NOT_AVAILABLE)
+        std::cout << std::setw(15) << "-";
+      else
+      {
+        std::cout << std::setw(15) << time;
+        if (time < best)
+          best = time;
+      }
+    }
+    std::cout << std::setw(15) << workload.times[0] / best << "\n";
+  }
+
+  return produced == 0;
+}
+
+// vim: ts=2:sw=2:sts=2:expandtab
@@ -0,0 +1,75 @@
+// Replays a log corpus (see corpus.hpp and corpusgen) through
+// Formatter::print into a sink which only counts characters, and reports the
+// throughput in MB/s and the time per record.
+//
+// Usage: bench_replay corpus [rounds]
+
+#include "replay.hpp"
+
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+
+using namespace pnt;
+
+int main(int argc, char* argv[])
+{
+  if (argc < 2)
+  {
+    std::cerr << "usage: bench_replay corpus [rounds]" << std::endl;
+    return 1;
+  }
+
+  unsigned int nbRounds = argc > 2 ? std::atoi(argv[2]) : 10;
+
+  std::ifstream in(argv[1]);
+  if (!in)
+  {
+    std::cerr << "can't open " << argv[1] << std::endl;
+    return 1;
+  }
+
+  std::vector<corpus::Record> records;
+  corpus::Record record;
+  std::string error;
+  while (corpus::read(in, record, error))
+    records.push_back(record);
+  if (!error.empty())
+  {
+    std::cerr << "invalid corpus: " << error << std::endl;
+    return 1;
+  }
+  if (records.empty())
+  {
+    std::cerr << "empty corpus" << std::endl;
+    return 1;
+  }
+
+  std::vector<Replay> replays;
+  for (auto& record : records)
+    replays.push_back(resolve(record));
+
+  NullStreambuf sb;
+  Formatter<NullStreambuf> formatter(sb);
+
+  auto start = std::chrono::steady_clock::now();
+  for (unsigned int round = 0; round < nbRounds; ++round)
+    for (std::size_t i = 0; i < records.size(); ++i)
+      replays[i](formatter, records[i]);
+  auto stop = std::chrono::steady_clock::now();
+
+  double seconds = std::chrono::duration<double>(stop - start).count();
+  double nbReplayed = static_cast<double>(records.size()) * nbRounds;
+
+  std::cout << "simd level: " << simd::levelName(simd::level()) << "\n";
+  std::cout << "records:    " << records.size() << " x " << nbRounds << "\n";
+  std::cout << "output:     " << sb.size() << " bytes\n";
+  std::cout << "time:       " << seconds << " s\n";
+  std::cout << "throughput: " << sb.size() / seconds / 1e6 << " MB/s\n";
+  std::cout << "per record: " << seconds * 1e9 / nbReplayed << " ns\n";
+
+  return 0;
+}
+
+// vim: ts=2:sw=2:sts=2:expandtab
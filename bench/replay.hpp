@@ -0,0 +1,137 @@
+// Replay of corpus records through Formatter::print, shared by the
+// benchmarks reading a corpus.
+
+#ifndef PNT_BENCH_REPLAY_HPP
+#define PNT_BENCH_REPLAY_HPP
+
+#include "corpus.hpp"
+
+#include <pnt.hpp>
+
+#include <type_traits>
+
+// Only counts the characters it is given.
+class NullStreambuf
+{
+  public:
+    typedef char char_type;
+    typedef std::char_traits<char> traits_type;
+
+    NullStreambuf() :
+      m_size(0)
+    {}
+
+    int sputc(char c)
+    {
+      ++m_size;
+      return c;
+    }
+
+    std::streamsize sputn(const char*, std::streamsize count)
+    {
+      m_size += count;
+      return count;
+    }
+
+    unsigned long long size() const
+    {
+      return m_size;
+    }
+
+  private:
+    unsigned long long m_size;
+};
+
+namespace _Replay
+{
+  template <typename T>
+  T get(const corpus::Arg& arg);
+
+  template <>
+  inline long long get<long long>(const corpus::Arg& arg)
+  {
+    return arg.i;
+  }
+
+  template <>
+  inline unsigned long long get<unsigned long long>(const corpus::Arg& arg)
+  {
+    return arg.u;
+  }
+
+  template <>
+  inline const char* get<const char*>(const corpus::Arg& arg)
+  {
+    return arg.s.c_str();
+  }
+
+  template <>
+  inline char get<char>(const corpus::Arg& arg)
+  {
+    return arg.s[0];
+  }
+
+  // Calls Formatter::print with the arguments of a record whose types are
+  // Types, without looking at the types of the record again.
+  template <typename... Types>
+  struct Play;
+
+  template <>
+  struct Play<>
+  {
+    template <typename... Args>
+    static void print(pnt::Formatter<NullStreambuf>& formatter,
+        const corpus::Record& record, Args... args)
+    {
+      formatter.print(record.format.c_str(), args...);
+    }
+  };
+
+  template <typename T, typename... Types>
+  struct Play<T, Types...>
+  {
+    template <typename... Args>
+    static void print(pnt::Formatter<NullStreambuf>& formatter,
+        const corpus::Record& record, Args... args)
+    {
+      Play<Types...>::print(formatter, record, args...,
+          get<T>(record.args[sizeof...(Args)]));
+    }
+  };
+}
+
+// Replays a record through the Formatter::print instantiation matching its
+// argument types.
+typedef void (*Replay)(pnt::Formatter<NullStreambuf>& formatter,
+    const corpus::Record& record);
+
+// Turns the runtime argument types of the record into the static types of
+// a Formatter::print call, one argument at a time. The benchmarks do it
+// before timing, the calls then only cost an indirect call on top of
+// Formatter::print. Records with the same argument types share the same
+// instantiation, there are at most 341 of them for 4 arguments.
+template <typename... Types>
+typename std::enable_if<(sizeof...(Types) == corpus::MAX_ARGS), Replay>::type
+  resolve(const corpus::Record&)
+{
+  return &_Replay::Play<Types...>::template print<>;
+}
+
+template <typename... Types>
+typename std::enable_if<(sizeof...(Types) < corpus::MAX_ARGS), Replay>::type
+  resolve(const corpus::Record& record)
+{
+  if (sizeof...(Types) == record.args.size())
+    return &_Replay::Play<Types...>::template print<>;
+
+  switch (record.args[sizeof...(Types)].type)
+  {
+    case 'i': return resolve<Types..., long long>(record);
+    case 'u': return resolve<Types..., unsigned long long>(record);
+    case 's': return resolve<Types..., const char*>(record);
+    default: return resolve<Types..., char>(record);
+  }
+}
+
+#endif
+// vim: ts=2:sw=2:sts=2:expandtab
@@ -0,0 +1,141 @@
+// Rendering of a large report with pnt::Template, compiled once and
+// rendered repeatedly, compared to compiling the template for each render,
+// and to the same report written by hand with Formatter::print.
+//
+// Usage: bench_template [rows] [renders]
+
+#include <pnt/template.hpp>
+#include <pnt/buffer.hpp>
+
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+
+using namespace pnt;
+
+namespace
+{
+
+const char* const REPORT =
+  "Report {{title}}, generated by {{user}}\n"
+  "{{#each hosts}}\n"
+  "{{@index:%5d}} {{name:%-20s}} {{cpu:%3d}}% {{memory:%10d}} KB"
+  "{{#if down}} DOWN{{/if}}\n"
+  "{{#each disks}}\n"
+  "      {{path:%-16s}} {{used:%12d}}/{{size:%-12d}}"
+  "{{#unless @last}},{{/unless}}\n"
+  "{{/each}}\n"
+  "{{/each}}\n"
+  "{{#if truncated}}\n"
+  "(truncated)\n"
+  "{{/if}}\n";
+
+typedef std::chrono::steady_clock Clock;
+
+}
+
+int main(int argc, char* argv[])
+{
+  unsigned int nbRows = argc > 1 ? std::atoi(argv[1]) : 10000;
+  unsigned int nbRenders = argc > 2 ? std::atoi(argv[2]) : 20;
+
+  Template report(REPORT);
+
+  std::vector<std::string> names;
+  for (unsigned int i = 0; i < nbRows; ++i)
+    names.push_back("host" + std::to_string(i) + ".example.com");
+  const char* const paths[] = {"/", "/var", "/home"};
+
+  std::vector<std::vector<TemplateData>> disks(nbRows);
+  std::vector<TemplateData> hosts;
+  hosts.reserve(nbRows);
+  for (unsigned int i = 0; i < nbRows; ++i)
+  {
+    for (unsigned int j = 0; j < 3; ++j)
+    {
+      disks[i].emplace_back(report);
+      disks[i].back().set("path", paths[j])
+        .set("used", (i * 7919 + j * 104729) % 1000000000)
+        .set("size", 1000000000 + j);
+    }
+
+    hosts.emplace_back(report);
+    hosts.back().set("name", names[i])
+      .set("cpu", i * 37 % 101)
+      .set("memory", i * 2654435761u % 64000000)
+      .set("down", i % 97 == 0)
+      .set("disks", disks[i]);
+  }
+
+  TemplateData data(report);
+  data.set("title", "daily").set("user", "bench").set("hosts", hosts)
+    .set("truncated", false);
+
+  Buffer buffer;
+  report.render(buffer, data);
+  std::string expected = buffer.str();
+  std::size_t size = expected.size();
+
+  // the same output, without the template
+  auto byHand = [&]()
+    {
+      Formatter<Buffer> formatter(buffer);
+      formatter.print("Report %s, generated by %s\n", "daily", "bench");
+      for (unsigned int i = 0; i < nbRows; ++i)
+      {
+        formatter.print("%5d %-20s %3d%% %10d KB%s\n", i, names[i],
+            i * 37 % 101, i * 2654435761u % 64000000,
+            i % 97 == 0 ? " DOWN" : "");
+        for (unsigned int j = 0; j < 3; ++j)
+          formatter.print("      %-16s %12d/%-12d%s\n", paths[j],
+              (i * 7919 + j * 104729) % 1000000000, 1000000000 + j,
+              j < 2 ? "," : "");
+      }
+    };
+
+  enum Mode { ONCE, PER_RENDER, BY_HAND };
+
+  auto run = [&](Mode mode)
+    {
+      auto start = Clock::now();
+      for (unsigned int i = 0; i < nbRenders; ++i)
+      {
+        buffer.clear();
+        if (mode == ONCE)
+          report.render(buffer, data);
+        else if (mode == PER_RENDER)
+          Template(REPORT).render(buffer, data);
+        else
+          byHand();
+      }
+      auto stop = Clock::now();
+      return std::chrono::duration<double>(stop - start).count();
+    };
+
+  buffer.clear();
+  byHand();
+  if (buffer.str() != expected)
+  {
+    std::cerr << "the reports differ" << std::endl;
+    return 1;
+  }
+
+  run(ONCE);
+
+  std::cout << "rows:      " << nbRows << " x " << nbRenders << "\n";
+  std::cout << "output:    " << size << " bytes per render\n";
+  const char* const labels[] = {"compiled once:       ",
+    "compiled per render: ", "print by hand:       "};
+  for (Mode mode : {ONCE, PER_RENDER, BY_HAND})
+  {
+    double seconds = run(mode);
+    std::cout << labels[mode] << seconds * 1e3 / nbRenders
+      << " ms per render, " << size * nbRenders / seconds / 1e6 << " MB/s\n";
+  }
+
+  return buffer.size() != size;
+}
+
+// vim: ts=2:sw=2:sts=2:expandtab
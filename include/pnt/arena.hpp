@@ -0,0 +1,222 @@
+// Copyright (c) 2013, Philippe Daouadi <p.daouadi@free.fr>
+// All rights reserved.
+//
+// This file is distributed under the same license as pnt.hpp, see the
+// COPYING file.
+
+#ifndef PNT_ARENA_HPP
+#define PNT_ARENA_HPP
+
+#include <pnt/core.hpp>
+
+#include <cstddef>
+#include <new>
+#include <string>
+
+#if __cplusplus >= 201703L && defined(__has_include)
+#if __has_include(<memory_resource>)
+#include <memory_resource>
+#define PNT_HAS_PMR 1
+#endif
+#endif
+
+// Formatted strings allocated from an arena.
+//
+// Request-scoped strings are carved from an Arena and freed all at once
+// when it is released, instead of going through the global allocator for
+// each of them:
+//
+//   pnt::Arena arena;
+//   pnt::ArenaString<char> line = pnt::format(arena, "%s %d", name, value);
+//   ...
+//   arena.release();
+//
+// With C++17, the same can be done with any std::pmr::memory_resource.
+
+namespace pnt
+{
+
+// Bump allocator. Memory is taken from blocks of blockSize bytes, or larger
+// for larger allocations, and only given back by release() and the
+// destructor.
+class Arena
+{
+  public:
+    explicit Arena(std::size_t blockSize = 4096);
+    ~Arena();
+
+    Arena(const Arena&) = delete;
+    Arena& operator=(const Arena&) = delete;
+
+    void* allocate(std::size_t size,
+        std::size_t alignment = alignof(std::max_align_t));
+    // only reclaims the memory if it was the last allocation, which lets a
+    // string growing at the top of the arena reuse its previous buffer
+    void deallocate(void* ptr, std::size_t size);
+
+    // frees everything allocated from the arena and keeps its first block
+    void release();
+
+  private:
+    struct Block
+    {
+      Block* next;
+      std::size_t size;
+    };
+
+    Block* m_head;
+    char* m_ptr;
+    char* m_end;
+    std::size_t m_blockSize;
+
+    void addBlock(std::size_t size);
+};
+
+inline Arena::Arena(std::size_t blockSize) :
+  m_head(nullptr),
+  m_ptr(nullptr),
+  m_end(nullptr),
+  m_blockSize(blockSize)
+{
+}
+
+inline Arena::~Arena()
+{
+  while (m_head)
+  {
+    Block* next = m_head->next;
+    ::operator delete(m_head);
+    m_head = next;
+  }
+}
+
+inline void* Arena::allocate(std::size_t size, std::size_t alignment)
+{
+  std::size_t padding = -reinterpret_cast<std::uintptr_t>(m_ptr) &
+    (alignment - 1);
+  if (!m_head || static_cast<std::size_t>(m_end - m_ptr) < padding + size)
+  {
+    addBlock(size + alignment);
+    padding = -reinterpret_cast<std::uintptr_t>(m_ptr) & (alignment - 1);
+  }
+
+  void* ptr = m_ptr + padding;
+  m_ptr += padding + size;
+  return ptr;
+}
+
+inline void Arena::deallocate(void* ptr, std::size_t size)
+{
+  if (static_cast<char*>(ptr) + size == m_ptr)
+    m_ptr = static_cast<char*>(ptr);
+}
+
+inline void Arena::release()
+{
+  if (!m_head)
+    return;
+
+  while (m_head->next)
+  {
+    Block* next = m_head->next;
+    ::operator delete(m_head);
+    m_head = next;
+  }
+
+  m_ptr = reinterpret_cast<char*>(m_head + 1);
+  m_end = m_ptr + m_head->size;
+}
+
+inline void Arena::addBlock(std::size_t size)
+{
+  if (size < m_blockSize)
+    size = m_blockSize;
+
+  Block* block = static_cast<Block*>(::operator new(sizeof(Block) + size));
+  block->next = m_head;
+  block->size = size;
+  m_head = block;
+
+  m_ptr = reinterpret_cast<char*>(block + 1);
+  m_end = m_ptr + size;
+}
+
+// Standard allocator on top of an Arena.
+template <typename T>
+class ArenaAllocator
+{
+  public:
+    typedef T value_type;
+
+    ArenaAllocator(Arena& arena) noexcept :
+      m_arena(&arena)
+    {}
+
+    template <typename U>
+    ArenaAllocator(const ArenaAllocator<U>& other) noexcept :
+      m_arena(other.arena())
+    {}
+
+    T* allocate(std::size_t n)
+    {
+      return static_cast<T*>(m_arena->allocate(n * sizeof(T), alignof(T)));
+    }
+
+    void deallocate(T* ptr, std::size_t n) noexcept
+    {
+      m_arena->deallocate(ptr, n * sizeof(T));
+    }
+
+    Arena* arena() const noexcept
+    {
+      return m_arena;
+    }
+
+  private:
+    Arena* m_arena;
+};
+
+template <typename T, typename U>
+inline bool operator==(const ArenaAllocator<T>& lhs,
+    const ArenaAllocator<U>& rhs) noexcept
+{
+  return lhs.arena() == rhs.arena();
+}
+
+template <typename T, typename U>
+inline bool operator!=(const ArenaAllocator<T>& lhs,
+    const ArenaAllocator<U>& rhs) noexcept
+{
+  return lhs.arena() != rhs.arena();
+}
+
+template <typename CharT>
+using ArenaString =
+  std::basic_string<CharT, std::char_traits<CharT>, ArenaAllocator<CharT>>;
+
+template <typename CharT, typename... Args>
+inline ArenaString<CharT> format(Arena& arena, const CharT* format,
+    const Args&... args)
+{
+  ArenaString<CharT> str{ArenaAllocator<CharT>(arena)};
+  appendf(str, format, args...);
+  return str;
+}
+
+#ifdef PNT_HAS_PMR
+template <typename CharT, typename... Args>
+inline std::pmr::basic_string<CharT> format(
+    std::pmr::memory_resource* resource, const CharT* format,
+    const Args&... args)
+{
+  std::pmr::basic_string<CharT> str{
+    std::pmr::polymorphic_allocator<CharT>(resource)};
+  appendf(str, format, args...);
+  return str;
+}
+#endif
+
+}
+
+#endif
+// vim: ts=2:sw=2:sts=2:expandtab
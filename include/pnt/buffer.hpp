@@ -0,0 +1,151 @@
+// Copyright (c) 2013, Philippe Daouadi <p.daouadi@free.fr>
+// All rights reserved.
+//
+// This file is distributed under the same license as pnt.hpp, see the
+// COPYING file.
+
+#ifndef PNT_BUFFER_HPP
+#define PNT_BUFFER_HPP
+
+#include <pnt/core.hpp>
+
+#include <cstring>
+#include <memory>
+#include <string>
+
+namespace pnt
+{
+
+// Growable in-memory streambuf. clear() keeps the allocated memory so that a
+// buffer reused for each batch of output stops allocating once it reached
+// its steady state size.
+template <typename CharT, typename Traits = std::char_traits<CharT>>
+class BasicBuffer
+{
+  public:
+    typedef CharT char_type;
+    typedef Traits traits_type;
+    typedef typename Traits::int_type int_type;
+
+    explicit BasicBuffer(std::size_t capacity = 256);
+
+    BasicBuffer(const BasicBuffer&) = delete;
+    BasicBuffer& operator=(const BasicBuffer&) = delete;
+
+    int_type sputc(char_type c);
+    std::streamsize sputn(const char_type* s, std::streamsize count);
+
+    const char_type* data() const;
+    std::size_t size() const;
+    std::size_t capacity() const;
+    std::basic_string<char_type, traits_type> str() const;
+
+    void clear();
+    // drops what was written after the first size characters
+    void truncate(std::size_t size);
+    void reserve(std::size_t capacity);
+
+  private:
+    std::unique_ptr<char_type[]> m_data;
+    std::size_t m_size;
+    std::size_t m_capacity;
+
+    void grow(std::size_t needed);
+};
+
+typedef BasicBuffer<char> Buffer;
+typedef BasicBuffer<wchar_t> WBuffer;
+
+template <typename CharT, typename Traits>
+inline BasicBuffer<CharT, Traits>::BasicBuffer(std::size_t capacity) :
+  m_data(new char_type[capacity ? capacity : 1]),
+  m_size(0),
+  m_capacity(capacity ? capacity : 1)
+{
+}
+
+template <typename CharT, typename Traits>
+inline typename BasicBuffer<CharT, Traits>::int_type
+  BasicBuffer<CharT, Traits>::sputc(char_type c)
+{
+  if (m_size == m_capacity)
+    grow(m_size + 1);
+  m_data[m_size++] = c;
+  return traits_type::to_int_type(c);
+}
+
+template <typename CharT, typename Traits>
+inline std::streamsize BasicBuffer<CharT, Traits>::sputn(
+    const char_type* s, std::streamsize count)
+{
+  if (m_capacity - m_size < static_cast<std::size_t>(count))
+    grow(m_size + count);
+  std::memcpy(m_data.get() + m_size, s, count * sizeof(char_type));
+  m_size += count;
+  return count;
+}
+
+template <typename CharT, typename Traits>
+inline const typename BasicBuffer<CharT, Traits>::char_type*
+  BasicBuffer<CharT, Traits>::data() const
+{
+  return m_data.get();
+}
+
+template <typename CharT, typename Traits>
+inline std::size_t BasicBuffer<CharT, Traits>::size() const
+{
+  return m_size;
+}
+
+template <typename CharT, typename Traits>
+inline std::size_t BasicBuffer<CharT, Traits>::capacity() const
+{
+  return m_capacity;
+}
+
+template <typename CharT, typename Traits>
+inline std::basic_string<CharT, Traits>
+  BasicBuffer<CharT, Traits>::str() const
+{
+  return std::basic_string<char_type, traits_type>(m_data.get(), m_size);
+}
+
+template <typename CharT, typename Traits>
+inline void BasicBuffer<CharT, Traits>::clear()
+{
+  m_size = 0;
+}
+
+template <typename CharT, typename Traits>
+inline void BasicBuffer<CharT, Traits>::truncate(std::size_t size)
+{
+  if (size < m_size)
+    m_size = size;
+}
+
+template <typename CharT, typename Traits>
+inline void BasicBuffer<CharT, Traits>::reserve(std::size_t capacity)
+{
+  if (capacity <= m_capacity)
+    return;
+
+  std::unique_ptr<char_type[]> data(new char_type[capacity]);
+  std::memcpy(data.get(), m_data.get(), m_size * sizeof(char_type));
+  m_data = std::move(data);
+  m_capacity = capacity;
+}
+
+template <typename CharT, typename Traits>
+void BasicBuffer<CharT, Traits>::grow(std::size_t needed)
+{
+  std::size_t capacity = m_capacity * 2;
+  if (capacity < needed)
+    capacity = needed;
+  reserve(capacity);
+}
+
+}
+
+#endif
+// vim: ts=2:sw=2:sts=2:expandtab
@@ -0,0 +1,210 @@
+// Copyright (c) 2013, Philippe Daouadi <p.daouadi@free.fr>
+// All rights reserved.
+//
+// This file is distributed under the same license as pnt.hpp, see the
+// COPYING file.
+
+#ifndef PNT_CHECKSUM_HPP
+#define PNT_CHECKSUM_HPP
+
+#include <pnt/core.hpp>
+
+#include <cstring>
+
+namespace pnt
+{
+
+namespace _Checksum
+{
+  typedef std::uint32_t (*Crc32cKernel)(std::uint32_t crc,
+      const unsigned char* data, std::size_t size);
+
+  struct Crc32cTables
+  {
+    std::uint32_t table[8][256];
+
+    Crc32cTables()
+    {
+      for (std::uint32_t i = 0; i < 256; ++i)
+      {
+        std::uint32_t crc = i;
+        for (int bit = 0; bit < 8; ++bit)
+          crc = crc & 1 ? (crc >> 1) ^ 0x82f63b78 : crc >> 1;
+        table[0][i] = crc;
+      }
+
+      for (std::uint32_t i = 0; i < 256; ++i)
+        for (int k = 1; k < 8; ++k)
+          table[k][i] = (table[k-1][i] >> 8) ^ table[0][table[k-1][i] & 0xff];
+    }
+  };
+
+  inline const Crc32cTables& crc32cTables()
+  {
+    static const Crc32cTables tables;
+    return tables;
+  }
+
+  // slicing by 8, crc is not inverted
+  inline std::uint32_t crc32cScalar(std::uint32_t crc,
+      const unsigned char* data, std::size_t size)
+  {
+    const std::uint32_t (*table)[256] = crc32cTables().table;
+
+    for (; size >= 8; data += 8, size -= 8)
+    {
+      crc ^= data[0] | data[1] << 8 | data[2] << 16 |
+        static_cast<std::uint32_t>(data[3]) << 24;
+      crc = table[7][crc & 0xff] ^ table[6][crc >> 8 & 0xff] ^
+        table[5][crc >> 16 & 0xff] ^ table[4][crc >> 24] ^
+        table[3][data[4]] ^ table[2][data[5]] ^
+        table[1][data[6]] ^ table[0][data[7]];
+    }
+
+    for (; size; ++data, --size)
+      crc = (crc >> 8) ^ table[0][(crc ^ *data) & 0xff];
+
+    return crc;
+  }
+
+#if PNT_SIMD_X86
+
+  PNT_SIMD_TARGET("sse4.2")
+  inline std::uint32_t crc32cSse42(std::uint32_t crc,
+      const unsigned char* data, std::size_t size)
+  {
+#if defined(__x86_64__) || defined(_M_X64)
+    std::uint64_t crc64 = crc;
+    for (; size >= 8; data += 8, size -= 8)
+    {
+      std::uint64_t value;
+      std::memcpy(&value, data, 8);
+      crc64 = _mm_crc32_u64(crc64, value);
+    }
+    crc = static_cast<std::uint32_t>(crc64);
+#endif
+
+    for (; size >= 4; data += 4, size -= 4)
+    {
+      std::uint32_t value;
+      std::memcpy(&value, data, 4);
+      crc = _mm_crc32_u32(crc, value);
+    }
+
+    for (; size; ++data, --size)
+      crc = _mm_crc32_u8(crc, *data);
+
+    return crc;
+  }
+
+#endif
+
+  inline Crc32cKernel crc32cKernel(simd::Level level)
+  {
+#if PNT_SIMD_X86
+    if (level >= simd::Sse42)
+      return crc32cSse42;
+#else
+    (void)level;
+#endif
+    return crc32cScalar;
+  }
+}
+
+// CRC32C (Castagnoli) of [data, data+size). crc is the checksum of the
+// preceding data, to compute it incrementally.
+inline std::uint32_t crc32c(const void* data, std::size_t size,
+    std::uint32_t crc = 0)
+{
+  return ~_Checksum::crc32cKernel(simd::level())(~crc,
+      static_cast<const unsigned char*>(data), size);
+}
+
+// Streambuf adapter computing the CRC32C of everything written through it
+// to the wrapped streambuf, so that output is checksummed as it is formatted
+// rather than read again afterwards. Characters the wrapped streambuf did
+// not accept are not part of the checksum. For wide streambufs, the
+// checksum covers the in-memory representation of the characters.
+//
+//   std::filebuf file;
+//   pnt::Crc32cStreambuf<std::filebuf> checked(file);
+//   pnt::writef(checked, "%s %d\n", name, value);
+//   std::uint32_t crc = checked.checksum();
+template <typename Streambuf>
+class Crc32cStreambuf
+{
+  public:
+    typedef typename Streambuf::char_type char_type;
+    typedef typename Streambuf::traits_type traits_type;
+    typedef typename traits_type::int_type int_type;
+
+    explicit Crc32cStreambuf(Streambuf& streambuf, std::uint32_t crc = 0);
+
+    int_type sputc(char_type c);
+    std::streamsize sputn(const char_type* s, std::streamsize count);
+
+    std::uint32_t checksum() const;
+    // restarts the checksum, at the beginning of a new segment for example
+    void reset(std::uint32_t crc = 0);
+
+    Streambuf& streambuf();
+
+  private:
+    Streambuf& m_streambuf;
+    std::uint32_t m_crc;
+    _Checksum::Crc32cKernel m_kernel;
+};
+
+template <typename Streambuf>
+inline Crc32cStreambuf<Streambuf>::Crc32cStreambuf(Streambuf& streambuf,
+    std::uint32_t crc) :
+  m_streambuf(streambuf),
+  m_crc(~crc),
+  m_kernel(_Checksum::crc32cKernel(simd::level()))
+{
+}
+
+template <typename Streambuf>
+inline typename Crc32cStreambuf<Streambuf>::int_type
+  Crc32cStreambuf<Streambuf>::sputc(char_type c)
+{
+  int_type result = m_streambuf.sputc(c);
+  if (!traits_type::eq_int_type(result, traits_type::eof()))
+    m_crc = m_kernel(m_crc, reinterpret_cast<const unsigned char*>(&c),
+        sizeof(c));
+  return result;
+}
+
+template <typename Streambuf>
+inline std::streamsize Crc32cStreambuf<Streambuf>::sputn(
+    const char_type* s, std::streamsize count)
+{
+  std::streamsize written = m_streambuf.sputn(s, count);
+  if (written > 0)
+    m_crc = m_kernel(m_crc, reinterpret_cast<const unsigned char*>(s),
+        written * sizeof(char_type));
+  return written;
+}
+
+template <typename Streambuf>
+inline std::uint32_t Crc32cStreambuf<Streambuf>::checksum() const
+{
+  return ~m_crc;
+}
+
+template <typename Streambuf>
+inline void Crc32cStreambuf<Streambuf>::reset(std::uint32_t crc)
+{
+  m_crc = ~crc;
+}
+
+template <typename Streambuf>
+inline Streambuf& Crc32cStreambuf<Streambuf>::streambuf()
+{
+  return m_streambuf;
+}
+
+}
+
+#endif
+// vim: ts=2:sw=2:sts=2:expandtab
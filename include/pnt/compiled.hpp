@@ -0,0 +1,103 @@
+// Copyright (c) 2013, Philippe Daouadi <p.daouadi@free.fr>
+// All rights reserved.
+//
+// This file is distributed under the same license as pnt.hpp, see the
+// COPYING file.
+
+#ifndef PNT_COMPILED_HPP
+#define PNT_COMPILED_HPP
+
+#include <pnt/core.hpp>
+
+// Format strings compiled ahead of time by pntc.
+//
+// A call site opts in by wrapping its format string literal:
+//
+//   pnt::writef(sb, PNT_COMPILED("Value: %+12.8d\n"), value);
+//
+// pntc --extract finds these literals in the sources and generates a header
+// with one specialized function per format string. That header must be
+// included (directly or by defining PNT_COMPILED_FORMATS to its name) in
+// every translation unit using PNT_COMPILED, otherwise the call falls back
+// to the runtime parser.
+
+#define PNT_COMPILED(format) \
+  (::pnt::CompiledFormat< \
+     typename std::remove_const<typename std::remove_reference< \
+       decltype(*(format))>::type>::type, \
+     ::pnt::_Formatter::formatId(format)>{format})
+
+namespace pnt
+{
+
+template <typename CharT, std::uint64_t Id>
+struct CompiledFormat
+{
+  const CharT* format;
+};
+
+namespace _Formatter
+{
+  // specialized by the code generated by pntc
+  template <std::uint64_t Id>
+  struct CompiledPrinter
+  {
+    static constexpr bool compiled = false;
+
+    template <typename Streambuf, typename... Args>
+    static void print(Streambuf& streambuf,
+        const typename Streambuf::char_type* format, const Args&... args)
+    {
+      Formatter<Streambuf>(streambuf).print(format, args...);
+    }
+  };
+}
+
+template <typename Streambuf, std::uint64_t Id, typename... Args>
+inline void writef(Streambuf& streambuf,
+    CompiledFormat<typename Streambuf::char_type, Id> format,
+    const Args&... args)
+{
+  _Formatter::CompiledPrinter<Id>::print(streambuf, format.format, args...);
+}
+
+template <typename CharT, typename Traits, typename Alloc, std::uint64_t Id,
+         typename... Args>
+inline void appendf(std::basic_string<CharT, Traits, Alloc>& str,
+    CompiledFormat<CharT, Id> format, const Args&... args)
+{
+  typedef _Formatter::StringStreambuf<
+    std::basic_string<CharT, Traits, Alloc>> Streambuf;
+
+  _Formatter::appendHinted(str, format.format, [&](Streambuf& sb)
+      {
+        _Formatter::CompiledPrinter<Id>::print(sb, format.format, args...);
+      });
+}
+
+template <std::uint64_t Id, typename... Args>
+inline std::string format(CompiledFormat<char, Id> format,
+    const Args&... args)
+{
+  std::string str;
+  appendf(str, format, args...);
+  return str;
+}
+
+template <std::uint64_t Id, typename... Args>
+inline std::wstring format(CompiledFormat<wchar_t, Id> format,
+    const Args&... args)
+{
+  std::wstring str;
+  appendf(str, format, args...);
+  return str;
+}
+
+}
+
+#ifdef PNT_COMPILED_FORMATS
+#include PNT_COMPILED_FORMATS
+#endif
+
+#endif
+// vim: ts=2:sw=2:sts=2:expandtab
@@ -0,0 +1,2852 @@
+// Copyright (c) 2013, Philippe Daouadi <p.daouadi@free.fr>
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met: 
+// 
+// 1. Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer. 
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution. 
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+// 
+// The views and conclusions contained in the software and documentation are
+// those of the authors and should not be interpreted as representing official
+// policies, either expressed or implied, of the FreeBSD Project.
+
+#ifndef PNT_CORE_HPP
+#define PNT_CORE_HPP
+
+// The formatter, without the standard streams: it does not include
+// <iostream>, so that including it adds no static initializer to a
+// translation unit, nor <stdexcept>. Formatters write to any streambuf
+// providing char_type, traits_type, sputc and sputn, std::basic_streambuf
+// or not. pnt.hpp adds the writef overloads printing to std::cout and
+// std::wcout.
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <cstdint>
+#include <cstdlib>
+#include <exception>
+#include <iosfwd>
+#include <limits>
+#include <string>
+#include <type_traits>
+
+#if !defined(PNT_NO_SIMD) && \
+  (defined(__x86_64__) || defined(__i386__) || \
+   defined(_M_X64) || defined(_M_IX86))
+#define PNT_SIMD_X86 1
+#else
+#define PNT_SIMD_X86 0
+#endif
+
+#if PNT_SIMD_X86
+#ifdef _MSC_VER
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#endif
+#include <immintrin.h>
+#endif
+
+// SIMD kernels are compiled for their instruction set with the target
+// attribute so that no compiler flag is needed, the right one is chosen at
+// runtime.
+#if defined(__GNUC__) || defined(__clang__)
+#define PNT_SIMD_TARGET(isa) __attribute__((target(isa)))
+#define PNT_SIMD_NO_SANITIZE __attribute__((no_sanitize_address))
+#else
+#define PNT_SIMD_TARGET(isa)
+#define PNT_SIMD_NO_SANITIZE
+#endif
+
+// pnt.cppm includes pnt.hpp in the purview of the pnt module with
+// PNT_MODULE_INTERFACE defined. PNT_EXPORT then exports the public API, and
+// the functions with static variables are not inline, so that the module
+// object owns these variables instead of each importer.
+#ifdef PNT_MODULE_INTERFACE
+#define PNT_EXPORT export
+#define PNT_INLINE_STATIC
+#else
+#define PNT_EXPORT
+#define PNT_INLINE_STATIC inline
+#endif
+
+/*
+FormatString:
+    FormatStringItem*
+FormatStringItem:
+    '%%'
+    '%' Position Flags Width Precision FormatChar
+    '%(' FormatString '%)'
+    OtherCharacterExceptPercent
+Position:
+    empty
+    Integer '$'
+Flags:
+    empty
+    '-' Flags
+    '+' Flags
+    '#' Flags
+    '0' Flags
+    ' ' Flags
+Width:
+    empty
+    Integer
+    '*'
+Precision:
+    empty
+    '.'
+    '.' Integer
+    '.*'
+Integer:
+    Digit
+    Digit Integer
+Digit:
+    '0'|'1'|'2'|'3'|'4'|'5'|'6'|'7'|'8'|'9'
+FormatChar:
+    's'|'c'|'b'|'d'|'o'|'x'|'X'|'p'|'e'|'E'|'f'|'F'|'g'|'G'|'a'|'A'
+*/
+
+#ifdef FORMATTER_THROW_ON_ERROR
+#define FORMAT_ERROR(type) \
+  throw FormatError(type)
+#else
+#define FORMAT_ERROR(type) \
+  assert(!#type)
+#endif
+
+namespace pnt
+{
+
+PNT_EXPORT class FormatError : public std::exception
+{
+  public:
+    enum Type
+    {
+      InvalidFormatter,
+      TooFewArguments,
+      TooManyArguments,
+      IncompatibleType,
+      NotImplemented,
+      BufferTooSmall
+    };
+
+    FormatError(Type type);
+
+    const char* what() const noexcept;
+
+  private:
+    Type m_type;
+};
+
+inline FormatError::FormatError(Type type) :
+  m_type(type)
+{
+}
+
+inline const char* FormatError::what() const noexcept
+{
+  switch (m_type)
+  {
+    case InvalidFormatter: return "Invalid formatter";
+    case TooFewArguments: return "Too few arguments";
+    case TooManyArguments: return "Too many arguments";
+    case IncompatibleType: return "Incompatible type";
+    case NotImplemented: return "Not implemented";
+    case BufferTooSmall: return "Buffer too small";
+    default: return "Unknown error";
+  }
+}
+
+PNT_EXPORT namespace simd
+{
+  // Instruction set levels the SIMD kernels are compiled for. Each level
+  // implies the previous ones.
+  enum Level
+  {
+    Scalar,
+    Sse2,
+    Sse42,
+    Avx2,
+    Avx512
+  };
+
+  Level detectLevel();
+  Level level();
+  Level setLevel(Level level);
+  const char* levelName(Level level);
+  bool parseLevel(const char* name, Level& level);
+}
+
+namespace _Simd
+{
+  struct Kernels
+  {
+    // first occurrence of c or of the terminating '\0'
+    const char* (*scan)(const char* str, char c);
+    // first occurrence of a, b or c in [begin, end), end if none
+    const char* (*findAny)(const char* begin, const char* end,
+        char a, char b, char c);
+    // the 8 decimal digits of value, which must be lower than 10^8
+    void (*digits8)(std::uint32_t value, char* out);
+    // Base64 of [in, in+size), size being a multiple of 3, with the url and
+    // filename safe alphabet if url, returns the end of the output
+    char* (*base64)(const unsigned char* in, std::size_t size, char* out,
+        bool url);
+    // first occurrence of c or of the terminating L'\0' in a wide string
+    const wchar_t* (*wscan)(const wchar_t* str, wchar_t c);
+  };
+
+  inline const char* scanScalar(const char* str, char c)
+  {
+    while (*str && *str != c)
+      ++str;
+    return str;
+  }
+
+  inline const wchar_t* wscanScalar(const wchar_t* str, wchar_t c)
+  {
+    while (*str && *str != c)
+      ++str;
+    return str;
+  }
+
+  inline const char* findAnyScalar(const char* begin, const char* end,
+      char a, char b, char c)
+  {
+    for (; begin != end; ++begin)
+      if (*begin == a || *begin == b || *begin == c)
+        break;
+    return begin;
+  }
+
+  inline void digits8Scalar(std::uint32_t value, char* out)
+  {
+    for (int i = 7; i >= 0; --i)
+    {
+      out[i] = '0' + value % 10;
+      value /= 10;
+    }
+  }
+
+  PNT_INLINE_STATIC char* base64Scalar(const unsigned char* in,
+      std::size_t size, char* out, bool url)
+  {
+    static const char standard[] =
+      "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+    static const char urlSafe[] =
+      "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789-_";
+
+    const char* alphabet = url ? urlSafe : standard;
+    for (const unsigned char* end = in + size; in != end; in += 3)
+    {
+      std::uint32_t value = in[0] << 16 | in[1] << 8 | in[2];
+      *out++ = alphabet[value >> 18];
+      *out++ = alphabet[value >> 12 & 63];
+      *out++ = alphabet[value >> 6 & 63];
+      *out++ = alphabet[value & 63];
+    }
+    return out;
+  }
+
+#if PNT_SIMD_X86
+
+  inline unsigned int countTrailingZeros(unsigned int mask)
+  {
+#ifdef _MSC_VER
+    unsigned long index;
+    _BitScanForward(&index, mask);
+    return index;
+#else
+    return __builtin_ctz(mask);
+#endif
+  }
+
+  inline unsigned int countTrailingZeros(unsigned long long mask)
+  {
+#ifdef _MSC_VER
+    unsigned long index;
+    if (static_cast<unsigned int>(mask))
+      _BitScanForward(&index, static_cast<unsigned int>(mask));
+    else
+    {
+      _BitScanForward(&index, static_cast<unsigned int>(mask >> 32));
+      index += 32;
+    }
+    return index;
+#else
+    return __builtin_ctzll(mask);
+#endif
+  }
+
+  // The scan kernels only use aligned loads so that they never cross a page
+  // boundary, but they read bytes before the string and after its end.
+
+  PNT_SIMD_TARGET("sse2") PNT_SIMD_NO_SANITIZE
+  inline const char* scanSse2(const char* str, char c)
+  {
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i needle = _mm_set1_epi8(c);
+
+    unsigned int misalign = reinterpret_cast<std::uintptr_t>(str) & 15;
+    const __m128i* block = reinterpret_cast<const __m128i*>(str - misalign);
+
+    __m128i chunk = _mm_load_si128(block);
+    unsigned int mask = _mm_movemask_epi8(_mm_or_si128(
+          _mm_cmpeq_epi8(chunk, zero), _mm_cmpeq_epi8(chunk, needle)));
+    mask >>= misalign;
+    if (mask)
+      return str + countTrailingZeros(mask);
+
+    while (true)
+    {
+      ++block;
+      chunk = _mm_load_si128(block);
+      mask = _mm_movemask_epi8(_mm_or_si128(
+            _mm_cmpeq_epi8(chunk, zero), _mm_cmpeq_epi8(chunk, needle)));
+      if (mask)
+        return reinterpret_cast<const char*>(block) +
+          countTrailingZeros(mask);
+    }
+  }
+
+  PNT_SIMD_TARGET("avx2") PNT_SIMD_NO_SANITIZE
+  inline const char* scanAvx2(const char* str, char c)
+  {
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i needle = _mm256_set1_epi8(c);
+
+    unsigned int misalign = reinterpret_cast<std::uintptr_t>(str) & 31;
+    const __m256i* block = reinterpret_cast<const __m256i*>(str - misalign);
+
+    __m256i chunk = _mm256_load_si256(block);
+    unsigned int mask = _mm256_movemask_epi8(_mm256_or_si256(
+          _mm256_cmpeq_epi8(chunk, zero), _mm256_cmpeq_epi8(chunk, needle)));
+    mask >>= misalign;
+    if (mask)
+      return str + countTrailingZeros(mask);
+
+    while (true)
+    {
+      ++block;
+      chunk = _mm256_load_si256(block);
+      mask = _mm256_movemask_epi8(_mm256_or_si256(
+            _mm256_cmpeq_epi8(chunk, zero),
+            _mm256_cmpeq_epi8(chunk, needle)));
+      if (mask)
+        return reinterpret_cast<const char*>(block) +
+          countTrailingZeros(mask);
+    }
+  }
+
+  PNT_SIMD_TARGET("avx512f,avx512bw") PNT_SIMD_NO_SANITIZE
+  inline const char* scanAvx512(const char* str, char c)
+  {
+    const __m512i zero = _mm512_setzero_si512();
+    const __m512i needle = _mm512_set1_epi8(c);
+
+    unsigned int misalign = reinterpret_cast<std::uintptr_t>(str) & 63;
+    const __m512i* block = reinterpret_cast<const __m512i*>(str - misalign);
+
+    __m512i chunk = _mm512_load_si512(block);
+    unsigned long long mask =
+      _mm512_cmpeq_epi8_mask(chunk, zero) |
+      _mm512_cmpeq_epi8_mask(chunk, needle);
+    mask >>= misalign;
+    if (mask)
+      return str + countTrailingZeros(mask);
+
+    while (true)
+    {
+      ++block;
+      chunk = _mm512_load_si512(block);
+      mask =
+        _mm512_cmpeq_epi8_mask(chunk, zero) |
+        _mm512_cmpeq_epi8_mask(chunk, needle);
+      if (mask)
+        return reinterpret_cast<const char*>(block) +
+          countTrailingZeros(mask);
+    }
+  }
+
+  // The wide scan kernels compare whole code units, of 16 bits on Windows
+  // and of 32 bits elsewhere. A wchar_t is aligned on its size, so the
+  // misalignment of a block is a whole number of code units.
+
+  PNT_SIMD_TARGET("sse2")
+  inline __m128i wideEqualSse2(__m128i a, __m128i b)
+  {
+    return sizeof(wchar_t) == 2 ? _mm_cmpeq_epi16(a, b) :
+      _mm_cmpeq_epi32(a, b);
+  }
+
+  PNT_SIMD_TARGET("sse2") PNT_SIMD_NO_SANITIZE
+  inline const wchar_t* wscanSse2(const wchar_t* str, wchar_t c)
+  {
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i needle = sizeof(wchar_t) == 2 ?
+      _mm_set1_epi16(static_cast<short>(c)) :
+      _mm_set1_epi32(static_cast<int>(c));
+
+    unsigned int misalign = reinterpret_cast<std::uintptr_t>(str) & 15;
+    const __m128i* block = reinterpret_cast<const __m128i*>(
+        reinterpret_cast<const char*>(str) - misalign);
+
+    __m128i chunk = _mm_load_si128(block);
+    unsigned int mask = _mm_movemask_epi8(_mm_or_si128(
+          wideEqualSse2(chunk, zero), wideEqualSse2(chunk, needle)));
+    mask >>= misalign;
+    if (mask)
+      return reinterpret_cast<const wchar_t*>(
+          reinterpret_cast<const char*>(str) + countTrailingZeros(mask));
+
+    while (true)
+    {
+      ++block;
+      chunk = _mm_load_si128(block);
+      mask = _mm_movemask_epi8(_mm_or_si128(
+            wideEqualSse2(chunk, zero), wideEqualSse2(chunk, needle)));
+      if (mask)
+        return reinterpret_cast<const wchar_t*>(
+            reinterpret_cast<const char*>(block) + countTrailingZeros(mask));
+    }
+  }
+
+  PNT_SIMD_TARGET("avx2")
+  inline __m256i wideEqualAvx2(__m256i a, __m256i b)
+  {
+    return sizeof(wchar_t) == 2 ? _mm256_cmpeq_epi16(a, b) :
+      _mm256_cmpeq_epi32(a, b);
+  }
+
+  PNT_SIMD_TARGET("avx2") PNT_SIMD_NO_SANITIZE
+  inline const wchar_t* wscanAvx2(const wchar_t* str, wchar_t c)
+  {
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i needle = sizeof(wchar_t) == 2 ?
+      _mm256_set1_epi16(static_cast<short>(c)) :
+      _mm256_set1_epi32(static_cast<int>(c));
+
+    unsigned int misalign = reinterpret_cast<std::uintptr_t>(str) & 31;
+    const __m256i* block = reinterpret_cast<const __m256i*>(
+        reinterpret_cast<const char*>(str) - misalign);
+
+    __m256i chunk = _mm256_load_si256(block);
+    unsigned int mask = _mm256_movemask_epi8(_mm256_or_si256(
+          wideEqualAvx2(chunk, zero), wideEqualAvx2(chunk, needle)));
+    mask >>= misalign;
+    if (mask)
+      return reinterpret_cast<const wchar_t*>(
+          reinterpret_cast<const char*>(str) + countTrailingZeros(mask));
+
+    while (true)
+    {
+      ++block;
+      chunk = _mm256_load_si256(block);
+      mask = _mm256_movemask_epi8(_mm256_or_si256(
+            wideEqualAvx2(chunk, zero), wideEqualAvx2(chunk, needle)));
+      if (mask)
+        return reinterpret_cast<const wchar_t*>(
+            reinterpret_cast<const char*>(block) + countTrailingZeros(mask));
+    }
+  }
+
+  PNT_SIMD_TARGET("sse2")
+  inline const char* findAnySse2(const char* begin, const char* end,
+      char a, char b, char c)
+  {
+    const __m128i na = _mm_set1_epi8(a);
+    const __m128i nb = _mm_set1_epi8(b);
+    const __m128i nc = _mm_set1_epi8(c);
+
+    for (; end - begin >= 16; begin += 16)
+    {
+      __m128i chunk =
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(begin));
+      unsigned int mask = _mm_movemask_epi8(_mm_or_si128(
+            _mm_or_si128(_mm_cmpeq_epi8(chunk, na), _mm_cmpeq_epi8(chunk, nb)),
+            _mm_cmpeq_epi8(chunk, nc)));
+      if (mask)
+        return begin + countTrailingZeros(mask);
+    }
+
+    return findAnyScalar(begin, end, a, b, c);
+  }
+
+  PNT_SIMD_TARGET("sse4.2")
+  inline const char* findAnySse42(const char* begin, const char* end,
+      char a, char b, char c)
+  {
+    const __m128i set = _mm_setr_epi8(a, b, c,
+        0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0);
+
+    for (; end - begin >= 16; begin += 16)
+    {
+      __m128i chunk =
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(begin));
+      int index = _mm_cmpestri(set, 3, chunk, 16,
+          _SIDD_UBYTE_OPS | _SIDD_CMP_EQUAL_ANY | _SIDD_LEAST_SIGNIFICANT);
+      if (index != 16)
+        return begin + index;
+    }
+
+    return findAnyScalar(begin, end, a, b, c);
+  }
+
+  PNT_SIMD_TARGET("avx2")
+  inline const char* findAnyAvx2(const char* begin, const char* end,
+      char a, char b, char c)
+  {
+    const __m256i na = _mm256_set1_epi8(a);
+    const __m256i nb = _mm256_set1_epi8(b);
+    const __m256i nc = _mm256_set1_epi8(c);
+
+    for (; end - begin >= 32; begin += 32)
+    {
+      __m256i chunk =
+        _mm256_loadu_si256(reinterpret_cast<const __m256i*>(begin));
+      unsigned int mask = _mm256_movemask_epi8(_mm256_or_si256(
+            _mm256_or_si256(
+              _mm256_cmpeq_epi8(chunk, na), _mm256_cmpeq_epi8(chunk, nb)),
+            _mm256_cmpeq_epi8(chunk, nc)));
+      if (mask)
+        return begin + countTrailingZeros(mask);
+    }
+
+    return findAnySse2(begin, end, a, b, c);
+  }
+
+  PNT_SIMD_TARGET("avx512f,avx512bw")
+  inline const char* findAnyAvx512(const char* begin, const char* end,
+      char a, char b, char c)
+  {
+    const __m512i na = _mm512_set1_epi8(a);
+    const __m512i nb = _mm512_set1_epi8(b);
+    const __m512i nc = _mm512_set1_epi8(c);
+
+    for (; end - begin >= 64; begin += 64)
+    {
+      __m512i chunk = _mm512_loadu_si512(begin);
+      unsigned long long mask =
+        _mm512_cmpeq_epi8_mask(chunk, na) |
+        _mm512_cmpeq_epi8_mask(chunk, nb) |
+        _mm512_cmpeq_epi8_mask(chunk, nc);
+      if (mask)
+        return begin + countTrailingZeros(mask);
+    }
+
+    return findAnyAvx2(begin, end, a, b, c);
+  }
+
+  // Splits the value in abcd and efgh, then computes the 8 prefixes
+  // a, ab, abc, abcd, e, ef, efg, efgh with multiplications by fixed-point
+  // inverses of the powers of 10 and subtracts ten times the previous prefix
+  // to isolate each digit.
+  PNT_SIMD_TARGET("sse2")
+  inline void digits8Sse2(std::uint32_t value, char* out)
+  {
+    const __m128i input = _mm_cvtsi32_si128(value);
+    const __m128i abcd = _mm_srli_epi64(
+        _mm_mul_epu32(input, _mm_set1_epi32(0xd1b71759)), 45);
+    const __m128i efgh = _mm_sub_epi32(input,
+        _mm_mul_epu32(abcd, _mm_set1_epi32(10000)));
+
+    const __m128i v1 = _mm_slli_epi64(_mm_unpacklo_epi16(abcd, efgh), 2);
+    const __m128i v2 = _mm_unpacklo_epi32(
+        _mm_unpacklo_epi16(v1, v1), _mm_unpacklo_epi16(v1, v1));
+
+    const __m128i v3 = _mm_mulhi_epu16(v2,
+        _mm_setr_epi16(8389, 5243, 13108, -32768, 8389, 5243, 13108, -32768));
+    const __m128i v4 = _mm_mulhi_epu16(v3,
+        _mm_setr_epi16(128, 2048, 8192, -32768, 128, 2048, 8192, -32768));
+
+    const __m128i v5 = _mm_mullo_epi16(v4, _mm_set1_epi16(10));
+    const __m128i v6 = _mm_slli_epi64(v5, 16);
+    const __m128i digits = _mm_sub_epi16(v4, v6);
+
+    _mm_storel_epi64(reinterpret_cast<__m128i*>(out), _mm_add_epi8(
+          _mm_packus_epi16(digits, _mm_setzero_si128()), _mm_set1_epi8('0')));
+  }
+
+  // Base64 with pshufb, after Wojciech Mula and Daniel Lemire. Each 12
+  // byte group is shuffled so that every 32 bit lane holds the 3 bytes of a
+  // group, the 4 sextets are moved to their own byte with multiplications
+  // and turned into characters by adding an offset looked up from their
+  // range: A-Z, a-z, 0-9 and the last two characters.
+  PNT_SIMD_TARGET("ssse3")
+  inline __m128i base64Sse(__m128i in, __m128i offsets)
+  {
+    in = _mm_shuffle_epi8(in, _mm_setr_epi8(
+          1, 0, 2, 1, 4, 3, 5, 4, 7, 6, 8, 7, 10, 9, 11, 10));
+
+    const __m128i high = _mm_mulhi_epu16(
+        _mm_and_si128(in, _mm_set1_epi32(0x0fc0fc00)),
+        _mm_set1_epi32(0x04000040));
+    const __m128i low = _mm_mullo_epi16(
+        _mm_and_si128(in, _mm_set1_epi32(0x003f03f0)),
+        _mm_set1_epi32(0x01000010));
+    const __m128i sextets = _mm_or_si128(high, low);
+
+    // 0..25 -> 13, 26..51 -> 0, 52..61 -> 1..10, 62 -> 11, 63 -> 12
+    __m128i range = _mm_subs_epu8(sextets, _mm_set1_epi8(51));
+    range = _mm_or_si128(range, _mm_and_si128(
+          _mm_cmpgt_epi8(_mm_set1_epi8(26), sextets), _mm_set1_epi8(13)));
+
+    return _mm_add_epi8(sextets, _mm_shuffle_epi8(offsets, range));
+  }
+
+  PNT_SIMD_TARGET("ssse3")
+  inline __m128i base64Offsets(bool url)
+  {
+    return _mm_setr_epi8('a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+        '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+        (url ? '-' : '+') - 62, (url ? '_' : '/') - 63, 'A', 0, 0);
+  }
+
+  // loads 16 bytes for each 12 encoded, the last group goes through the
+  // scalar kernel to stay in [in, in+size)
+  PNT_SIMD_TARGET("ssse3")
+  inline char* base64Ssse3(const unsigned char* in, std::size_t size,
+      char* out, bool url)
+  {
+    const __m128i offsets = base64Offsets(url);
+
+    const unsigned char* end = in + size;
+    for (; end - in >= 16; in += 12, out += 16)
+      _mm_storeu_si128(reinterpret_cast<__m128i*>(out), base64Sse(
+            _mm_loadu_si128(reinterpret_cast<const __m128i*>(in)),
+            offsets));
+
+    return base64Scalar(in, end - in, out, url);
+  }
+
+  PNT_SIMD_TARGET("avx2")
+  inline char* base64Avx2(const unsigned char* in, std::size_t size,
+      char* out, bool url)
+  {
+    const __m256i offsets = _mm256_broadcastsi128_si256(base64Offsets(url));
+    const __m256i shuffle = _mm256_setr_epi8(
+        1, 0, 2, 1, 4, 3, 5, 4, 7, 6, 8, 7, 10, 9, 11, 10,
+        1, 0, 2, 1, 4, 3, 5, 4, 7, 6, 8, 7, 10, 9, 11, 10);
+
+    const unsigned char* end = in + size;
+    for (; end - in >= 28; in += 24, out += 32)
+    {
+      __m256i chunk = _mm256_inserti128_si256(_mm256_castsi128_si256(
+            _mm_loadu_si128(reinterpret_cast<const __m128i*>(in))),
+          _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + 12)), 1);
+      chunk = _mm256_shuffle_epi8(chunk, shuffle);
+
+      const __m256i high = _mm256_mulhi_epu16(
+          _mm256_and_si256(chunk, _mm256_set1_epi32(0x0fc0fc00)),
+          _mm256_set1_epi32(0x04000040));
+      const __m256i low = _mm256_mullo_epi16(
+          _mm256_and_si256(chunk, _mm256_set1_epi32(0x003f03f0)),
+          _mm256_set1_epi32(0x01000010));
+      const __m256i sextets = _mm256_or_si256(high, low);
+
+      __m256i range = _mm256_subs_epu8(sextets, _mm256_set1_epi8(51));
+      range = _mm256_or_si256(range, _mm256_and_si256(
+            _mm256_cmpgt_epi8(_mm256_set1_epi8(26), sextets),
+            _mm256_set1_epi8(13)));
+
+      _mm256_storeu_si256(reinterpret_cast<__m256i*>(out), _mm256_add_epi8(
+            sextets, _mm256_shuffle_epi8(offsets, range)));
+    }
+
+    return base64Ssse3(in, end - in, out, url);
+  }
+
+  inline void cpuid(unsigned int leaf, unsigned int subleaf,
+      unsigned int regs[4])
+  {
+#ifdef _MSC_VER
+    __cpuidex(reinterpret_cast<int*>(regs), leaf, subleaf);
+#else
+    __cpuid_count(leaf, subleaf, regs[0], regs[1], regs[2], regs[3]);
+#endif
+  }
+
+  inline unsigned long long xgetbv()
+  {
+#ifdef _MSC_VER
+    return _xgetbv(0);
+#else
+    unsigned int eax, edx;
+    __asm__ ("xgetbv" : "=a"(eax), "=d"(edx) : "c"(0));
+    return (static_cast<unsigned long long>(edx) << 32) | eax;
+#endif
+  }
+
+#endif
+
+  PNT_INLINE_STATIC const Kernels& kernelsFor(simd::Level level)
+  {
+    static const Kernels kernels[] = {
+      {scanScalar, findAnyScalar, digits8Scalar, base64Scalar, wscanScalar},
+#if PNT_SIMD_X86
+      {scanSse2, findAnySse2, digits8Sse2, base64Scalar, wscanSse2},
+      {scanSse2, findAnySse42, digits8Sse2, base64Ssse3, wscanSse2},
+      {scanAvx2, findAnyAvx2, digits8Sse2, base64Avx2, wscanAvx2},
+      {scanAvx512, findAnyAvx512, digits8Sse2, base64Avx2, wscanAvx2},
+#endif
+    };
+
+    return kernels[level];
+  }
+
+  inline simd::Level initialLevel()
+  {
+    simd::Level level = simd::detectLevel();
+
+    simd::Level requested;
+    const char* env = std::getenv("PNT_SIMD");
+    if (env && simd::parseLevel(env, requested) && requested < level)
+      level = requested;
+
+    return level;
+  }
+
+  struct State
+  {
+    std::atomic<const Kernels*> kernels;
+    std::atomic<int> level;
+
+    State()
+    {
+      simd::Level initial = initialLevel();
+      kernels.store(&kernelsFor(initial));
+      level.store(initial);
+    }
+  };
+
+  PNT_INLINE_STATIC State& state()
+  {
+    static State state;
+    return state;
+  }
+
+  inline const Kernels& kernels()
+  {
+    return *state().kernels.load(std::memory_order_relaxed);
+  }
+}
+
+namespace simd
+{
+  inline Level detectLevel()
+  {
+#if PNT_SIMD_X86
+    unsigned int regs[4];
+
+    _Simd::cpuid(0, 0, regs);
+    unsigned int maxLeaf = regs[0];
+
+    _Simd::cpuid(1, 0, regs);
+    unsigned int ecx1 = regs[2], edx1 = regs[3];
+
+    if (!(edx1 & (1u << 26)))
+      return Scalar;
+    // SSE4.2 kernels also use SSSE3 instructions
+    if (!(ecx1 & (1u << 20)) || !(ecx1 & (1u << 9)))
+      return Sse2;
+
+    // AVX needs the OS to save the YMM registers
+    bool osxsave = (ecx1 & (1u << 27)) && (ecx1 & (1u << 28));
+    if (!osxsave || maxLeaf < 7)
+      return Sse42;
+    unsigned long long xcr0 = _Simd::xgetbv();
+
+    _Simd::cpuid(7, 0, regs);
+    unsigned int ebx7 = regs[1];
+
+    if ((xcr0 & 0x6) != 0x6 || !(ebx7 & (1u << 5)))
+      return Sse42;
+    // AVX-512F and AVX-512BW with the opmask and ZMM states enabled
+    if ((xcr0 & 0xe6) != 0xe6 ||
+        !(ebx7 & (1u << 16)) || !(ebx7 & (1u << 30)))
+      return Avx2;
+    return Avx512;
+#else
+    return Scalar;
+#endif
+  }
+
+  inline Level level()
+  {
+    return static_cast<Level>(
+        _Simd::state().level.load(std::memory_order_relaxed));
+  }
+
+  // Not meant to be called while other threads are formatting, this is
+  // intended for tests and benchmarks. Returns the level actually selected,
+  // which is never higher than what the CPU supports.
+  inline Level setLevel(Level level)
+  {
+    if (level > detectLevel())
+      level = detectLevel();
+
+    _Simd::state().kernels.store(&_Simd::kernelsFor(level));
+    _Simd::state().level.store(level);
+
+    return level;
+  }
+
+  inline const char* levelName(Level level)
+  {
+    switch (level)
+    {
+      case Scalar: return "scalar";
+      case Sse2: return "sse2";
+      case Sse42: return "sse4.2";
+      case Avx2: return "avx2";
+      case Avx512: return "avx512";
+      default: return "unknown";
+    }
+  }
+
+  inline bool parseLevel(const char* name, Level& level)
+  {
+    for (int i = Scalar; i <= Avx512; ++i)
+    {
+      const char* expected = levelName(static_cast<Level>(i));
+      const char* iter = name;
+      while (*iter && *iter == *expected)
+      {
+        ++iter;
+        ++expected;
+      }
+
+      if (!*iter && !*expected)
+      {
+        level = static_cast<Level>(i);
+        return true;
+      }
+    }
+
+    return false;
+  }
+}
+
+namespace _Formatter
+{
+  template <typename T>
+  struct isIntegral
+  {
+    static constexpr bool value =
+      std::is_integral<T>::value &&
+      !std::is_same<T, bool>::value;
+  };
+
+  // next '%' or terminating '\0' of a format string
+  inline const char* findSpecial(const char* iter)
+  {
+    return _Simd::kernels().scan(iter, '%');
+  }
+
+  inline const wchar_t* findSpecial(const wchar_t* iter)
+  {
+    return _Simd::kernels().wscan(iter, L'%');
+  }
+
+  template <typename CharT>
+  inline const CharT* findSpecial(const CharT* iter)
+  {
+    while (*iter && *iter != '%')
+      ++iter;
+    return iter;
+  }
+
+  inline std::size_t length(const char* str)
+  {
+    return _Simd::kernels().scan(str, '\0') - str;
+  }
+
+  inline std::size_t length(const wchar_t* str)
+  {
+    return _Simd::kernels().wscan(str, L'\0') - str;
+  }
+
+  template <typename CharT>
+  inline std::size_t length(const CharT* str)
+  {
+    const CharT* iter;
+    for (iter = str; *iter; ++iter)
+      ;
+    return iter - str;
+  }
+
+  inline void digits8(std::uint32_t value, char* out)
+  {
+    _Simd::kernels().digits8(value, out);
+  }
+
+  // "00" to "99", the numbers below 10^8 are written two digits at a time
+  PNT_INLINE_STATIC const char* digitPairs()
+  {
+    static const char pairs[] =
+      "00010203040506070809101112131415161718192021222324"
+      "25262728293031323334353637383940414243444546474849"
+      "50515253545556575859606162636465666768697071727374"
+      "75767778798081828384858687888990919293949596979899";
+    return pairs;
+  }
+
+  inline char* base64(const unsigned char* in, std::size_t size, char* out,
+      bool url)
+  {
+    return _Simd::kernels().base64(in, size, out, url);
+  }
+
+  template <typename CharT>
+  inline CharT* base64(const unsigned char* in, std::size_t size,
+      CharT* out, bool url)
+  {
+    char chars[256];
+    while (size)
+    {
+      std::size_t chunk = size < 192 ? size : 192;
+      char* end = _Simd::kernels().base64(in, chunk, chars, url);
+      for (const char* iter = chars; iter != end; ++iter)
+        *out++ = *iter;
+      in += chunk;
+      size -= chunk;
+    }
+    return out;
+  }
+
+  // Writes size ASCII characters to a streambuf of any character type. The
+  // numbers are converted to narrow digits, which wide streambufs get
+  // widened in blocks rather than one sputc per character.
+  template <typename Streambuf>
+  inline typename std::enable_if<
+      sizeof(typename Streambuf::char_type) == 1>::type
+    writeNarrow(Streambuf& streambuf, const char* str, std::size_t size)
+  {
+    streambuf.sputn(reinterpret_cast<const typename Streambuf::char_type*>(
+          str), size);
+  }
+
+  template <typename Streambuf>
+  inline typename std::enable_if<
+      sizeof(typename Streambuf::char_type) != 1>::type
+    writeNarrow(Streambuf& streambuf, const char* str, std::size_t size)
+  {
+    typename Streambuf::char_type wide[64];
+    while (size)
+    {
+      std::size_t chunk = size < 64 ? size : 64;
+      for (std::size_t i = 0; i < chunk; ++i)
+        wide[i] = static_cast<unsigned char>(str[i]);
+      streambuf.sputn(wide, chunk);
+      str += chunk;
+      size -= chunk;
+    }
+  }
+
+  // Writes an ASCII string to a streambuf of any character type.
+  PNT_EXPORT template <typename Streambuf>
+  inline typename std::enable_if<
+      sizeof(typename Streambuf::char_type) == 1>::type
+    writeAscii(Streambuf& streambuf, const char* str)
+  {
+    streambuf.sputn(reinterpret_cast<const typename Streambuf::char_type*>(
+          str), length(str));
+  }
+
+  PNT_EXPORT template <typename Streambuf>
+  inline typename std::enable_if<
+      sizeof(typename Streambuf::char_type) != 1>::type
+    writeAscii(Streambuf& streambuf, const char* str)
+  {
+    writeNarrow(streambuf, str, length(str));
+  }
+
+  // Counts the characters written to it.
+  template <typename CharT, typename Traits>
+  class CountingStreambuf
+  {
+    public:
+      typedef CharT char_type;
+      typedef Traits traits_type;
+
+      CountingStreambuf() :
+        m_size(0)
+      {}
+
+      typename traits_type::int_type sputc(char_type c)
+      {
+        ++m_size;
+        return traits_type::to_int_type(c);
+      }
+
+      std::streamsize sputn(const char_type*, std::streamsize count)
+      {
+        m_size += count;
+        return count;
+      }
+
+      std::size_t size() const
+      {
+        return m_size;
+      }
+
+    private:
+      std::size_t m_size;
+  };
+
+  // Printer<T> prints with %s the types Formatter does not know about. It
+  // is specialized with:
+  //   static const bool printable = true;
+  //   template <typename Formatter>
+  //   static void print(Formatter& formatter, const T& arg);
+  // print writes to formatter.streambuf() and prints the parts of arg with
+  // formatter.printItem. See pnt/std.hpp.
+  PNT_EXPORT template <typename T, typename Enable = void>
+  struct Printer
+  {
+    static const bool printable = false;
+  };
+
+  // 64-bit FNV-1a hash of a format string, used to bind a format string to
+  // the code generated for it by pntc. It is a loop where constexpr
+  // functions may have one, the recursion otherwise goes as deep as the
+  // string is long, and long formats reach the limit of the compiler.
+#if __cpp_constexpr >= 201304L
+  template <typename CharT>
+  constexpr std::uint64_t formatId(const CharT* format,
+      std::uint64_t hash = 14695981039346656037ull)
+  {
+    for (; *format; ++format)
+      hash = (hash ^ static_cast<
+          typename std::make_unsigned<CharT>::type>(*format)) *
+        1099511628211ull;
+    return hash;
+  }
+#else
+  template <typename CharT>
+  constexpr std::uint64_t formatId(const CharT* format,
+      std::uint64_t hash = 14695981039346656037ull)
+  {
+    return *format ?
+      formatId(format + 1, (hash ^ static_cast<
+          typename std::make_unsigned<CharT>::type>(*format)) *
+        1099511628211ull) :
+      hash;
+  }
+#endif
+
+  PNT_EXPORT class FormatterItem
+  {
+    public:
+      static constexpr unsigned int POSITION_NONE = -1;
+
+      static constexpr unsigned int FLAG_LEFT_JUSTIFY  =  0x1;
+      static constexpr unsigned int FLAG_SHOW_SIGN     =  0x2;
+      static constexpr unsigned int FLAG_EXPLICIT_BASE =  0x4;
+      static constexpr unsigned int FLAG_FILL_ZERO     =  0x8;
+      static constexpr unsigned int FLAG_ADD_SPACE     = 0x10;
+
+      static constexpr unsigned int WIDTH_EMPTY = -1;
+      static constexpr unsigned int WIDTH_ARG = -2;
+
+      unsigned int position;
+      unsigned char flags;
+      unsigned int width;
+      unsigned int precision;
+      char formatChar;
+
+    protected:
+      void fixFlags();
+  };
+
+  inline void FormatterItem::fixFlags()
+  {
+    // no sign or space for non decimal and non binary and non %s
+    if (formatChar != 'd' && formatChar != 'b' && formatChar != 's')
+      flags &= ~(FLAG_SHOW_SIGN | FLAG_ADD_SPACE);
+    // no explicit base for decimal or binary
+    else
+      flags &= ~FLAG_EXPLICIT_BASE;
+
+    // no space if sign
+    if (flags & FLAG_SHOW_SIGN)
+      flags &= ~FLAG_ADD_SPACE;
+
+    // fill only with space on left justify
+    if (flags & FLAG_LEFT_JUSTIFY)
+      flags &= ~FLAG_FILL_ZERO;
+  }
+
+  // %s without width nor precision, for the parts of composite arguments
+  PNT_EXPORT PNT_INLINE_STATIC const FormatterItem& stringItem()
+  {
+    static const FormatterItem item = {0,
+      0,
+      FormatterItem::WIDTH_EMPTY,
+      FormatterItem::WIDTH_EMPTY,
+      's'};
+    return item;
+  }
+
+  PNT_EXPORT template <typename Iterator>
+  class StringFormatterItem : public FormatterItem
+  {
+    public:
+      void handleFormatter(Iterator& iter);
+
+    private:
+      Iterator findIntegerEnd(Iterator iter);
+      unsigned int parseInt(Iterator iter);
+
+      void handlePosition(Iterator& iter);
+      void handleFlags(Iterator& iter);
+      void handleWidth(Iterator& iter);
+      void handlePrecision(Iterator& iter);
+      void handleFormatChar(Iterator& iter);
+  };
+
+  template <typename Iterator>
+  inline Iterator StringFormatterItem<Iterator>::findIntegerEnd(
+      Iterator iter)
+  {
+    auto end = iter;
+    while (*end >= '0' && *end <= '9')
+      ++end;
+    return end;
+  }
+
+  template <typename Iterator>
+  inline unsigned int StringFormatterItem<Iterator>::parseInt(Iterator iter)
+  {
+    unsigned int out = 0;
+    for (; *iter >= '0' && *iter <= '9'; ++iter)
+      out = out * 10 + (*iter - '0');
+    return out;
+  }
+
+  template <typename Iterator>
+  inline void StringFormatterItem<Iterator>::handlePosition(Iterator& iter)
+  {
+    auto end = findIntegerEnd(iter);
+
+    if (iter == end || *end != '$')
+    {
+      position = POSITION_NONE;
+      return;
+    }
+
+    position = parseInt(iter);
+
+    iter = end+1;
+  }
+
+  template <typename Iterator>
+  inline void StringFormatterItem<Iterator>::handleFlags(Iterator& iter)
+  {
+    flags = 0;
+    while (true)
+    {
+      switch (*iter)
+      {
+        case '-': flags |= FLAG_LEFT_JUSTIFY; break;
+        case '+': flags |= FLAG_SHOW_SIGN; break;
+        case '#': flags |= FLAG_EXPLICIT_BASE; break;
+        case '0': flags |= FLAG_FILL_ZERO; break;
+        case ' ': flags |= FLAG_ADD_SPACE; break;
+        default:
+          return;
+      }
+
+      ++iter;
+    }
+  }
+
+  template <typename Iterator>
+  inline void StringFormatterItem<Iterator>::handleWidth(Iterator& iter)
+  {
+    if (*iter == '*')
+    {
+      width = WIDTH_ARG;
+      ++iter;
+      return;
+    }
+
+    auto end = findIntegerEnd(iter);
+
+    if (iter == end)
+    {
+      width = WIDTH_EMPTY;
+      return;
+    }
+
+    width = parseInt(iter);
+
+    iter = end;
+  }
+
+  template <typename Iterator>
+  inline void StringFormatterItem<Iterator>::handlePrecision(Iterator& iter)
+  {
+    if (*iter != '.')
+    {
+      precision = WIDTH_EMPTY;
+      return;
+    }
+
+    ++iter;
+
+    if (*iter == '*')
+    {
+      precision = WIDTH_ARG;
+      ++iter;
+      return;
+    }
+
+    auto end = findIntegerEnd(iter);
+    if (end == iter)
+    {
+      precision = 0;
+      return;
+    }
+
+    precision = parseInt(iter);
+
+    iter = end;
+  }
+
+  template <typename Iterator>
+  inline void StringFormatterItem<Iterator>::handleFormatChar(Iterator& iter)
+  {
+    switch (*iter)
+    {
+      case 's':
+      case 'c':
+      case 'b':
+      case 'd':
+      case 'o':
+      case 'x':
+      case 'X':
+      case 'p':
+      case 'e':
+      case 'E':
+      case 'f':
+      case 'F':
+      case 'g':
+      case 'G':
+      case 'a':
+      case 'A':
+        formatChar = *iter;
+        break;
+      default:
+        FORMAT_ERROR(FormatError::InvalidFormatter);
+    }
+
+    ++iter;
+  }
+
+  template <typename Iterator>
+  inline void StringFormatterItem<Iterator>::handleFormatter(Iterator& iter)
+  {
+    handlePosition(iter);
+    handleFlags(iter);
+    handleWidth(iter);
+    handlePrecision(iter);
+    handleFormatChar(iter);
+
+    fixFlags();
+  }
+}
+
+// Binary data printed in Base64 by %s, see base64 and base64url.
+PNT_EXPORT struct Base64
+{
+  const unsigned char* data;
+  std::size_t size;
+  bool url;
+};
+
+// RFC 4648 Base64, padded with '='
+PNT_EXPORT inline Base64 base64(const void* data, std::size_t size)
+{
+  Base64 arg = {static_cast<const unsigned char*>(data), size, false};
+  return arg;
+}
+
+// RFC 4648 base64url, without padding
+PNT_EXPORT inline Base64 base64url(const void* data, std::size_t size)
+{
+  Base64 arg = {static_cast<const unsigned char*>(data), size, true};
+  return arg;
+}
+
+// Arbitrary precision integer stored as 64 bit limbs, least significant
+// first, with a separate sign, printed by %d, %x, %X, %o and %b. x, o and b
+// print the magnitude. Decimal conversion needs bigintScratchSize(size)
+// limbs of scratch memory, taken from the stack up to 1024 limbs, that is
+// for integers up to 8000 bits or so, or from the scratch buffer given to
+// bigint for larger ones.
+PNT_EXPORT struct BigIntView
+{
+  const std::uint64_t* limbs;
+  std::size_t size;
+  bool negative;
+  std::uint64_t* scratch;
+  std::size_t scratchSize;
+};
+
+PNT_EXPORT inline BigIntView bigint(const std::uint64_t* limbs,
+    std::size_t size, bool negative = false)
+{
+  BigIntView arg = {limbs, size, negative, nullptr, 0};
+  return arg;
+}
+
+PNT_EXPORT inline BigIntView bigint(const std::uint64_t* limbs,
+    std::size_t size, bool negative, std::uint64_t* scratch,
+    std::size_t scratchSize)
+{
+  BigIntView arg = {limbs, size, negative, scratch, scratchSize};
+  return arg;
+}
+
+PNT_EXPORT inline std::size_t bigintScratchSize(std::size_t size)
+{
+  return 8 * size + 160;
+}
+
+namespace _BigInt
+{
+  typedef std::uint64_t Limb;
+
+  // The constants are enumerators rather than const variables, which have
+  // internal linkage and so cannot be used by Formatter when it is exported
+  // by the module.
+  enum Base : Limb
+  {
+    // 10^19, the largest power of 10 in a limb
+    BASE = 10000000000000000000ull
+  };
+
+  enum Sizes : std::size_t
+  {
+    BASE_DIGITS = 19,
+    // below this size, conversion divides by 10^19 repeatedly
+    THRESHOLD = 32,
+    STACK_SCRATCH = 1024
+  };
+
+  inline std::size_t normalize(const Limb* u, std::size_t size)
+  {
+    while (size && !u[size-1])
+      --size;
+    return size;
+  }
+
+  inline unsigned int countLeadingZeros(Limb value)
+  {
+#if defined(__GNUC__) || defined(__clang__)
+    return __builtin_clzll(value);
+#else
+    unsigned int count = 0;
+    for (Limb bit = 1ull << 63; !(value & bit); bit >>= 1)
+      ++count;
+    return count;
+#endif
+  }
+
+#ifdef __SIZEOF_INT128__
+  __extension__ typedef unsigned __int128 DoubleLimb;
+
+  // low limb of a * b + c + d, the high one in high
+  inline Limb mulAdd(Limb a, Limb b, Limb c, Limb d, Limb& high)
+  {
+    DoubleLimb product = static_cast<DoubleLimb>(a) * b + c + d;
+    high = static_cast<Limb>(product >> 64);
+    return static_cast<Limb>(product);
+  }
+
+  // (high:low) / d, high must be lower than d
+  inline Limb div(Limb high, Limb low, Limb d, Limb& remainder)
+  {
+    DoubleLimb n = static_cast<DoubleLimb>(high) << 64 | low;
+    remainder = static_cast<Limb>(n % d);
+    return static_cast<Limb>(n / d);
+  }
+#else
+  inline Limb mulAdd(Limb a, Limb b, Limb c, Limb d, Limb& high)
+  {
+    Limb a0 = a & 0xffffffff, a1 = a >> 32;
+    Limb b0 = b & 0xffffffff, b1 = b >> 32;
+    Limb p00 = a0 * b0, p01 = a0 * b1, p10 = a1 * b0, p11 = a1 * b1;
+
+    Limb middle = (p00 >> 32) + (p01 & 0xffffffff) + (p10 & 0xffffffff);
+    Limb low = (p00 & 0xffffffff) | middle << 32;
+    high = p11 + (p01 >> 32) + (p10 >> 32) + (middle >> 32);
+
+    low += c;
+    high += low < c;
+    low += d;
+    high += low < d;
+    return low;
+  }
+
+  inline Limb div(Limb high, Limb low, Limb d, Limb& remainder)
+  {
+    Limb quotient = 0;
+    for (int i = 0; i < 64; ++i)
+    {
+      Limb carry = high >> 63;
+      high = high << 1 | low >> 63;
+      low <<= 1;
+      quotient <<= 1;
+      if (carry || high >= d)
+      {
+        high -= d;
+        quotient |= 1;
+      }
+    }
+    remainder = high;
+    return quotient;
+  }
+#endif
+
+  // u /= d in place, returns the remainder and updates size
+  inline Limb divSmall(Limb* u, std::size_t& size, Limb d)
+  {
+    Limb remainder = 0;
+    for (std::size_t i = size; i--; )
+      u[i] = div(remainder, u[i], d, remainder);
+    size = normalize(u, size);
+    return remainder;
+  }
+
+  // out = a * b, out has size + size limbs
+  inline void square(const Limb* a, std::size_t size, Limb* out)
+  {
+    for (std::size_t i = 0; i < 2 * size; ++i)
+      out[i] = 0;
+
+    for (std::size_t i = 0; i < size; ++i)
+    {
+      Limb carry = 0;
+      for (std::size_t j = 0; j < size; ++j)
+        out[i+j] = mulAdd(a[i], a[j], out[i+j], carry, carry);
+      out[i+size] = carry;
+    }
+  }
+
+  // Knuth's algorithm D: q = u / v and u[0, m) = u % v. u has size limbs,
+  // v has m >= 2 limbs with a non zero top one and size >= m. scratch needs
+  // size + m + 1 limbs.
+  inline void divmod(Limb* u, std::size_t size, const Limb* v,
+      std::size_t m, Limb* q, Limb* scratch)
+  {
+    unsigned int shift = countLeadingZeros(v[m-1]);
+
+    Limb* vn = scratch;
+    Limb* un = scratch + m;
+    if (shift)
+    {
+      for (std::size_t i = m - 1; i > 0; --i)
+        vn[i] = v[i] << shift | v[i-1] >> (64 - shift);
+      vn[0] = v[0] << shift;
+
+      un[size] = u[size-1] >> (64 - shift);
+      for (std::size_t i = size - 1; i > 0; --i)
+        un[i] = u[i] << shift | u[i-1] >> (64 - shift);
+      un[0] = u[0] << shift;
+    }
+    else
+    {
+      for (std::size_t i = 0; i < m; ++i)
+        vn[i] = v[i];
+      for (std::size_t i = 0; i < size; ++i)
+        un[i] = u[i];
+      un[size] = 0;
+    }
+
+    for (std::size_t j = size - m + 1; j--; )
+    {
+      // estimate the quotient digit from the top limbs, it is at most 2 too
+      // large
+      Limb qhat, rhat;
+      bool overflow = false;
+      if (un[j+m] == vn[m-1])
+      {
+        qhat = ~Limb(0);
+        rhat = un[j+m-1] + vn[m-1];
+        overflow = rhat < vn[m-1];
+      }
+      else
+        qhat = div(un[j+m], un[j+m-1], vn[m-1], rhat);
+
+      while (!overflow)
+      {
+        Limb high, low = mulAdd(qhat, vn[m-2], 0, 0, high);
+        if (high < rhat || (high == rhat && low <= un[j+m-2]))
+          break;
+        --qhat;
+        rhat += vn[m-1];
+        overflow = rhat < vn[m-1];
+      }
+
+      // un[j, j+m] -= qhat * vn
+      Limb borrow = 0, carry = 0;
+      for (std::size_t i = 0; i < m; ++i)
+      {
+        Limb product = mulAdd(qhat, vn[i], carry, 0, carry);
+        Limb t = un[i+j] - product;
+        Limb b = un[i+j] < product;
+        un[i+j] = t - borrow;
+        borrow = b + (t < borrow);
+      }
+      Limb t = un[j+m] - carry;
+      Limb b = un[j+m] < carry;
+      un[j+m] = t - borrow;
+      b += t < borrow;
+
+      // qhat was one too large, add vn back
+      if (b)
+      {
+        --qhat;
+        Limb c = 0;
+        for (std::size_t i = 0; i < m; ++i)
+        {
+          Limb sum = un[i+j] + vn[i];
+          Limb c1 = sum < vn[i];
+          un[i+j] = sum + c;
+          c = c1 + (un[i+j] < c);
+        }
+        un[j+m] += c;
+      }
+
+      q[j] = qhat;
+    }
+
+    if (shift)
+      for (std::size_t i = 0; i < m; ++i)
+        u[i] = un[i] >> shift | un[i+1] << (64 - shift);
+    else
+      for (std::size_t i = 0; i < m; ++i)
+        u[i] = un[i];
+  }
+
+  struct Power
+  {
+    const Limb* limbs;
+    std::size_t size;
+  };
+
+  // Writes u, which must be lower than 10^(19*count), as exactly count base
+  // 10^19 digits, least significant first. u is destroyed. Above THRESHOLD,
+  // u is split in q * 10^(19*half) + r, half being the largest power of two
+  // lower than count, and both halves are converted recursively.
+  inline void toChunks(Limb* u, std::size_t size, Limb* out,
+      std::size_t count, const Power* powers, Limb* scratch)
+  {
+    size = normalize(u, size);
+    if (size <= THRESHOLD)
+    {
+      for (std::size_t i = 0; i < count; ++i)
+        out[i] = size ? divSmall(u, size, BASE) : 0;
+      return;
+    }
+
+    std::size_t half = 1;
+    unsigned int k = 0;
+    while (half * 2 < count)
+    {
+      half *= 2;
+      ++k;
+    }
+    const Power& power = powers[k];
+
+    if (size < power.size)
+    {
+      toChunks(u, size, out, half, powers, scratch);
+      for (std::size_t i = half; i < count; ++i)
+        out[i] = 0;
+      return;
+    }
+
+    Limb* q = scratch;
+    std::size_t qsize = size - power.size + 1;
+    if (power.size == 1)
+    {
+      for (std::size_t i = 0; i < size; ++i)
+        q[i] = u[i];
+      std::size_t length = size;
+      u[0] = divSmall(q, length, power.limbs[0]);
+    }
+    else
+      divmod(u, size, power.limbs, power.size, q, scratch + qsize);
+
+    toChunks(u, power.size, out, half, powers, scratch + qsize);
+    toChunks(q, qsize, out + half, count - half, powers, scratch + qsize);
+  }
+
+  // Converts [limbs, limbs+size), normalized, to base 10^19 digits, least
+  // significant first, in scratch, which must have bigintScratchSize(size)
+  // limbs. Returns the number of digits, without leading zeros.
+  inline std::size_t toChunks(const Limb* limbs, std::size_t size,
+      Limb* scratch, const Limb*& chunks)
+  {
+    // 64 * log(2) / log(10^19) < 1 + 1/64
+    std::size_t count = size + size / 64 + 1;
+
+    Limb* out = scratch;
+    Limb* u = out + count;
+    for (std::size_t i = 0; i < size; ++i)
+      u[i] = limbs[i];
+    scratch = u + size;
+
+    if (size <= THRESHOLD)
+    {
+      toChunks(u, size, out, count, nullptr, scratch);
+      chunks = out;
+      return normalize(out, count);
+    }
+
+    // 10^(19*2^k), as long as 2^k is lower than count
+    Power powers[64] = {};
+    scratch[0] = BASE;
+    powers[0].limbs = scratch;
+    powers[0].size = 1;
+    scratch += 1;
+
+    for (unsigned int k = 0; (std::size_t(2) << k) < count; ++k)
+    {
+      square(powers[k].limbs, powers[k].size, scratch);
+      powers[k+1].limbs = scratch;
+      powers[k+1].size = normalize(scratch, 2 * powers[k].size);
+      scratch += powers[k+1].size;
+    }
+
+    toChunks(u, size, out, count, powers, scratch);
+
+    chunks = out;
+    return normalize(out, count);
+  }
+
+  inline unsigned int bitLength(Limb value)
+  {
+    return 64 - countLeadingZeros(value);
+  }
+}
+
+PNT_EXPORT template <typename Streambuf>
+class Formatter
+{
+  public:
+    typedef typename std::remove_reference<Streambuf>::type streambuf_type;
+    typedef typename streambuf_type::char_type char_type;
+    typedef typename streambuf_type::traits_type traits_type;
+
+    Formatter(Streambuf& stream);
+
+    template <typename... Args>
+    void print(const char_type* format, const Args&... args);
+
+    // prints a single argument according to an already parsed format item
+    template <typename T>
+    void printItem(const _Formatter::FormatterItem& fmt, const T& arg);
+
+    Streambuf& streambuf();
+
+  private:
+    Streambuf& m_streambuf;
+
+    template <typename... Args>
+    void printArg(const _Formatter::FormatterItem& fmt, const Args&... args);
+    template <typename Arg1, typename... Args>
+    void printArg(unsigned int item, const _Formatter::FormatterItem& fmt,
+        const Arg1& arg1, const Args&... args);
+    void printArg(unsigned int item, const _Formatter::FormatterItem& fmt);
+
+    void printPreFill(
+        const _Formatter::FormatterItem& fmt, unsigned int size);
+    void printPostFill(
+        const _Formatter::FormatterItem& fmt, unsigned int size);
+
+    void printByType(const _Formatter::FormatterItem&, bool arg);
+    void printByType(const _Formatter::FormatterItem&, char_type arg);
+    void printByType(const _Formatter::FormatterItem&, const char_type* arg);
+    void printByType(const _Formatter::FormatterItem& fmt, Base64 arg);
+    template <typename T>
+    typename std::enable_if<
+        !std::is_integral<T>::value &&
+        !std::is_floating_point<T>::value &&
+        !std::is_convertible<T,
+          std::basic_string<char_type, traits_type>>::value &&
+        !std::is_pointer<T>::value &&
+        !_Formatter::Printer<T>::printable
+      >::type printByType(const _Formatter::FormatterItem& fmt, const T& arg);
+    template <typename T>
+    typename std::enable_if<_Formatter::Printer<T>::printable>::type
+      printByType(const _Formatter::FormatterItem& fmt, const T& arg);
+    template <typename T>
+    typename std::enable_if<std::is_integral<T>::value>::type
+      printByType(const _Formatter::FormatterItem& fmt, T arg);
+    template <typename T>
+    typename std::enable_if<std::is_pointer<T>::value>::type
+      printByType(const _Formatter::FormatterItem& fmt, T arg);
+    template <typename T>
+    typename std::enable_if<std::is_floating_point<T>::value>::type
+      printByType(const _Formatter::FormatterItem& fmt, T arg);
+    template <typename T>
+    typename std::enable_if<
+        !std::is_floating_point<T>::value &&
+        !std::is_integral<T>::value &&
+        std::is_convertible<T, std::basic_string<typename Formatter::char_type,
+      typename Formatter::traits_type>>::value
+      >::type printByType(const _Formatter::FormatterItem& fmt, const T& arg);
+    template <typename Alloc>
+    void printByType(const _Formatter::FormatterItem& fmt,
+        const std::basic_string<char_type, traits_type, Alloc>& arg);
+
+    template <typename T>
+    typename std::enable_if<std::is_convertible<T, char_type>::value>::type
+      printChar(const _Formatter::FormatterItem& fmt, T arg);
+    template <typename T>
+    typename std::enable_if<!std::is_convertible<T, char_type>::value>::type
+      printChar(const _Formatter::FormatterItem& fmt, const T& arg);
+
+    template <typename T>
+    typename std::enable_if<std::is_pointer<T>::value>::type
+      printPointer(const _Formatter::FormatterItem& fmt, T arg);
+    template <typename T>
+    typename std::enable_if<
+        !std::is_pointer<T>::value && !std::is_array<T>::value
+      >::type printPointer(const _Formatter::FormatterItem& fmt,
+          const T& arg);
+
+    template <unsigned int base, typename T>
+    typename std::enable_if<
+        _Formatter::isIntegral<T>::value
+      >::type printIntegral(const _Formatter::FormatterItem& fmt, T value);
+    // writes the digits of value backwards from str, returns their count
+    template <unsigned int Tbase, typename T>
+    std::size_t printIntegral(char* str,
+        const _Formatter::FormatterItem& fmt, T value);
+    template <unsigned int base, typename T>
+    typename std::enable_if<
+        !_Formatter::isIntegral<T>::value
+      >::type printIntegral(const _Formatter::FormatterItem& fmt,
+          const T& value);
+
+    template <unsigned int base, typename T>
+    typename std::enable_if<
+        _Formatter::isIntegral<T>::value
+      >::type printUnsigned(const _Formatter::FormatterItem& fmt, T value);
+    template <unsigned int base, typename T>
+    typename std::enable_if<
+        !_Formatter::isIntegral<T>::value
+      >::type printUnsigned(const _Formatter::FormatterItem&, const T&);
+
+    template <unsigned int base>
+    void printIntegral(const _Formatter::FormatterItem& fmt,
+        BigIntView value);
+    template <unsigned int base>
+    void printUnsigned(const _Formatter::FormatterItem& fmt,
+        BigIntView value);
+    template <unsigned int base>
+    void printBigInt(const _Formatter::FormatterItem& fmt, BigIntView value,
+        bool negative);
+
+    // prints the padding, the sign or the base prefix and the numsize
+    // digits written by printDigits
+    template <typename DigitPrinter>
+    void printNumber(const _Formatter::FormatterItem& fmt, bool negative,
+        bool zero, std::size_t numsize, DigitPrinter printDigits);
+};
+
+template <typename Streambuf>
+inline Formatter<Streambuf>::Formatter(Streambuf& stream) :
+  m_streambuf(stream)
+{
+}
+
+template <typename Streambuf>
+template <typename... Args>
+void Formatter<Streambuf>::print(const char_type* format,
+    const Args&... args)
+{
+  bool positional = false;
+  unsigned int position = 0;
+  const char_type* last = format;
+  auto iter = format;
+  while (true)
+  {
+    switch (*iter)
+    {
+      case '\0':
+        m_streambuf.sputn(last, iter-last);
+        last = iter;
+        return;
+      case '%':
+        m_streambuf.sputn(last, iter-last);
+        ++iter;
+        switch (*iter)
+        {
+          case '%':
+            ++iter;
+            m_streambuf.sputc('%');
+            break;
+          case '(':
+            FORMAT_ERROR(FormatError::NotImplemented);
+            break;
+          default:
+            {
+              _Formatter::StringFormatterItem<decltype(iter)> fmt;
+              fmt.handleFormatter(iter);
+              if (fmt.position == _Formatter::FormatterItem::POSITION_NONE)
+                fmt.position = position;
+              else
+              {
+                positional = true;
+                position = fmt.position;
+              }
+
+              if (!positional)
+                ++position;
+
+              printArg(fmt, args...);
+            }
+            break;
+        }
+        last = iter;
+        break;
+      default:
+        iter = _Formatter::findSpecial(iter);
+    }
+  }
+}
+
+template <typename Streambuf>
+template <typename T>
+inline
+void Formatter<Streambuf>::printItem(const _Formatter::FormatterItem& fmt,
+    const T& arg)
+{
+  printArg(0, fmt, arg);
+}
+
+template <typename Streambuf>
+inline Streambuf& Formatter<Streambuf>::streambuf()
+{
+  return m_streambuf;
+}
+
+template <typename Streambuf>
+template <typename... Args>
+inline
+void Formatter<Streambuf>::printArg(const _Formatter::FormatterItem& fmt,
+    const Args&... args)
+{
+  printArg(fmt.position, fmt, args...);
+}
+
+template <typename Streambuf>
+template <typename Arg1, typename... Args>
+inline
+void Formatter<Streambuf>::printArg(unsigned int item,
+    const _Formatter::FormatterItem& fmt, const Arg1& arg1,
+    const Args&... args)
+{
+  if (item)
+    return printArg(item-1, fmt, args...);
+
+  switch (fmt.formatChar)
+  {
+    case 's':
+      printByType(fmt, arg1);
+      break;
+    case 'c':
+      printChar(fmt, arg1);
+      break;
+    case 'b':
+      printUnsigned<2>(fmt, arg1);
+      break;
+    case 'd':
+      printIntegral<10>(fmt, arg1);
+      break;
+    case 'o':
+      printUnsigned<8>(fmt, arg1);
+      break;
+    case 'x':
+    case 'X':
+      printUnsigned<16>(fmt, arg1);
+      break;
+    case 'p':
+      printPointer(fmt, arg1);
+      break;
+    case 'e':
+    case 'E':
+    case 'f':
+    case 'F':
+    case 'g':
+    case 'G':
+    case 'a':
+    case 'A':
+      FORMAT_ERROR(FormatError::NotImplemented);
+      break;
+    default:
+      // should not be here
+      assert(false);
+      break;
+  }
+}
+
+template <typename Streambuf>
+inline
+void Formatter<Streambuf>::printArg(unsigned int,
+    const _Formatter::FormatterItem&)
+{
+  FORMAT_ERROR(FormatError::TooFewArguments);
+}
+
+template <typename Streambuf>
+inline
+void Formatter<Streambuf>::printPreFill(
+    const _Formatter::FormatterItem& fmt, unsigned int size)
+{
+  if (fmt.width == _Formatter::FormatterItem::WIDTH_ARG)
+  {
+    FORMAT_ERROR(FormatError::NotImplemented);
+    return;
+  }
+
+  if (fmt.width == _Formatter::FormatterItem::WIDTH_EMPTY ||
+      fmt.width <= size)
+    return;
+
+  size = fmt.width - size;
+  if (!(fmt.flags & _Formatter::FormatterItem::FLAG_LEFT_JUSTIFY))
+    while (size--)
+      m_streambuf.sputc(' ');
+}
+
+template <typename Streambuf>
+inline
+void Formatter<Streambuf>::printPostFill(
+    const _Formatter::FormatterItem& fmt, unsigned int size)
+{
+  if (fmt.width == _Formatter::FormatterItem::WIDTH_ARG)
+  {
+    FORMAT_ERROR(FormatError::NotImplemented);
+    return;
+  }
+
+  if (fmt.width == _Formatter::FormatterItem::WIDTH_EMPTY ||
+      fmt.width <= size)
+    return;
+
+  size = fmt.width - size;
+  if (fmt.flags & _Formatter::FormatterItem::FLAG_LEFT_JUSTIFY)
+    while (size--)
+      m_streambuf.sputc(' ');
+}
+
+template <typename Streambuf>
+template <typename T>
+inline
+typename std::enable_if<
+    !std::is_integral<T>::value &&
+    !std::is_floating_point<T>::value &&
+    !std::is_convertible<T,
+      std::basic_string<typename Formatter<Streambuf>::char_type,
+        typename Formatter<Streambuf>::traits_type>>::value &&
+    !std::is_pointer<T>::value &&
+    !_Formatter::Printer<T>::printable
+  >::type Formatter<Streambuf>::printByType(
+      const _Formatter::FormatterItem&, const T&)
+{
+  FORMAT_ERROR(FormatError::IncompatibleType);
+}
+
+// The width is applied to the whole text, which is measured by printing it a
+// first time in a streambuf which only counts characters.
+template <typename Streambuf>
+template <typename T>
+typename std::enable_if<_Formatter::Printer<T>::printable>::type
+  Formatter<Streambuf>::printByType(const _Formatter::FormatterItem& fmt,
+      const T& arg)
+{
+  if (fmt.width == _Formatter::FormatterItem::WIDTH_EMPTY)
+  {
+    _Formatter::Printer<T>::print(*this, arg);
+    return;
+  }
+
+  typedef _Formatter::CountingStreambuf<char_type, traits_type> Counter;
+  Counter counter;
+  Formatter<Counter> counting(counter);
+  _Formatter::Printer<T>::print(counting, arg);
+
+  printPreFill(fmt, counter.size());
+  _Formatter::Printer<T>::print(*this, arg);
+  printPostFill(fmt, counter.size());
+}
+
+template <typename Streambuf>
+inline
+void Formatter<Streambuf>::printByType(
+    const _Formatter::FormatterItem& fmt, bool arg)
+{
+  static const char_type t[] =
+    {'t', 'r', 'u', 'e'};
+  static const char_type f[] =
+    {'f', 'a', 'l', 's', 'e'};
+
+  printPreFill(fmt, arg ? sizeof(t)/sizeof(*t) : sizeof(f)/sizeof(*f));
+
+  if (arg)
+    m_streambuf.sputn(t, sizeof(t)/sizeof(*t));
+  else
+    m_streambuf.sputn(f, sizeof(f)/sizeof(*f));
+
+  printPostFill(fmt, arg ? sizeof(t)/sizeof(*t) : sizeof(f)/sizeof(*f));
+}
+
+template <typename Streambuf>
+inline
+void Formatter<Streambuf>::printByType(
+    const _Formatter::FormatterItem& fmt, char_type arg)
+{
+  printChar(fmt, arg);
+}
+
+template <typename Streambuf>
+inline
+void Formatter<Streambuf>::printByType(
+    const _Formatter::FormatterItem& fmt, const char_type* arg)
+{
+  std::size_t size = _Formatter::length(arg);
+
+  // print
+  printPreFill(fmt, size);
+
+  m_streambuf.sputn(arg, size);
+
+  printPostFill(fmt, size);
+}
+
+template <typename Streambuf>
+void Formatter<Streambuf>::printByType(
+    const _Formatter::FormatterItem& fmt, Base64 arg)
+{
+  std::size_t full = arg.size - arg.size % 3;
+  std::size_t rest = arg.size - full;
+  std::size_t size = full / 3 * 4 + (rest ? (arg.url ? rest + 1 : 4) : 0);
+
+  printPreFill(fmt, size);
+
+  // encoded in blocks on the stack and written as they are produced
+  char_type buf[1024];
+  const unsigned char* data = arg.data;
+  for (const unsigned char* end = data + full; data != end; )
+  {
+    std::size_t chunk = end - data < 768 ? end - data : 768;
+    m_streambuf.sputn(buf,
+        _Formatter::base64(data, chunk, buf, arg.url) - buf);
+    data += chunk;
+  }
+
+  if (rest)
+  {
+    const unsigned char last[3] =
+      {data[0], static_cast<unsigned char>(rest == 2 ? data[1] : 0), 0};
+    _Formatter::base64(last, 3, buf, arg.url);
+    if (rest == 1)
+      buf[2] = '=';
+    buf[3] = '=';
+    m_streambuf.sputn(buf, arg.url ? rest + 1 : 4);
+  }
+
+  printPostFill(fmt, size);
+}
+
+template <typename Streambuf>
+template <typename T>
+inline
+typename std::enable_if<std::is_integral<T>::value>::type
+  Formatter<Streambuf>::printByType(
+      const _Formatter::FormatterItem& fmt, T arg)
+{
+  printIntegral<10>(fmt, arg);
+}
+
+template <typename Streambuf>
+template <typename T>
+inline
+typename std::enable_if<std::is_pointer<T>::value>::type
+  Formatter<Streambuf>::printByType(
+      const _Formatter::FormatterItem& fmt, T arg)
+{
+  printPointer(fmt, arg);
+}
+
+template <typename Streambuf>
+template <typename T>
+inline
+typename std::enable_if<std::is_floating_point<T>::value>::type
+  Formatter<Streambuf>::printByType(const _Formatter::FormatterItem&, T)
+{
+  FORMAT_ERROR(FormatError::NotImplemented);
+}
+
+template <typename Streambuf>
+template <typename T>
+inline
+typename std::enable_if<
+  !std::is_floating_point<T>::value &&
+  !std::is_integral<T>::value &&
+  std::is_convertible<T,
+    std::basic_string<
+      typename Formatter<Streambuf>::char_type,
+      typename Formatter<Streambuf>::traits_type>>::value
+  >::type Formatter<Streambuf>::printByType(
+      const _Formatter::FormatterItem& fmt, const T& arg)
+{
+  std::basic_string<
+      typename Formatter<Streambuf>::char_type,
+      typename Formatter<Streambuf>::traits_type> str(arg);
+
+  printPreFill(fmt, str.length());
+
+  m_streambuf.sputn(str.c_str(), str.length());
+
+  printPostFill(fmt, str.length());
+}
+
+// strings with any allocator are printed in place, only the types which
+// convert to a string go through a temporary one
+template <typename Streambuf>
+template <typename Alloc>
+inline
+void Formatter<Streambuf>::printByType(const _Formatter::FormatterItem& fmt,
+    const std::basic_string<char_type, traits_type, Alloc>& arg)
+{
+  printPreFill(fmt, arg.length());
+
+  m_streambuf.sputn(arg.data(), arg.length());
+
+  printPostFill(fmt, arg.length());
+}
+
+template <typename Streambuf>
+template <typename T>
+inline
+typename std::enable_if<std::is_convertible<T,
+    typename Formatter<Streambuf>::char_type>::value>::type
+  Formatter<Streambuf>::printChar(const _Formatter::FormatterItem& fmt, T arg)
+{
+  printPreFill(fmt, 1);
+
+  m_streambuf.sputc(arg);
+
+  printPostFill(fmt, 1);
+}
+
+template <typename Streambuf>
+template <typename T>
+inline
+typename std::enable_if<!std::is_convertible<T,
+    typename Formatter<Streambuf>::char_type>::value>::type
+  Formatter<Streambuf>::printChar(const _Formatter::FormatterItem&, const T&)
+{
+  FORMAT_ERROR(FormatError::IncompatibleType);
+}
+
+template <typename Streambuf>
+template <typename T>
+inline
+typename std::enable_if<std::is_pointer<T>::value>::type
+  Formatter<Streambuf>::printPointer(const _Formatter::FormatterItem& fmt, T arg)
+{
+  _Formatter::FormatterItem fmt2 = fmt;
+
+  fmt2.flags = _Formatter::FormatterItem::FLAG_EXPLICIT_BASE;
+  fmt2.precision = sizeof(void*) * 2;
+  fmt2.formatChar = 'x';
+
+  printIntegral<16>(fmt2, reinterpret_cast<uintptr_t>(arg));
+}
+
+template <typename Streambuf>
+template <typename T>
+inline
+typename std::enable_if<
+    !std::is_pointer<T>::value && !std::is_array<T>::value
+  >::type Formatter<Streambuf>::printPointer(
+      const _Formatter::FormatterItem&, const T&)
+{
+  FORMAT_ERROR(FormatError::IncompatibleType);
+}
+
+namespace _Formatter
+{
+  template <typename T>
+  inline
+  typename std::enable_if<std::is_signed<T>::value, bool>::type
+    isNegative(T value)
+  {
+    return value < 0;
+  }
+
+  template <typename T>
+  inline
+  typename std::enable_if<!std::is_signed<T>::value, bool>::type
+    isNegative(T)
+  {
+    return false;
+  }
+}
+
+template <typename Streambuf>
+template <unsigned int Tbase, typename T>
+typename std::enable_if<
+    _Formatter::isIntegral<T>::value
+  >::type Formatter<Streambuf>::printIntegral(
+      const _Formatter::FormatterItem& fmt, T value)
+{
+  // convert the number, to narrow digits whatever the character type
+
+  char buf[64];
+  std::size_t numsize = printIntegral<Tbase>(buf + sizeof(buf), fmt, value);
+
+  printNumber(fmt, _Formatter::isNegative(value), value == 0, numsize,
+      [&]()
+      {
+        _Formatter::writeNarrow(m_streambuf, buf + sizeof(buf) - numsize,
+            numsize);
+      });
+}
+
+template <typename Streambuf>
+template <typename DigitPrinter>
+void Formatter<Streambuf>::printNumber(const _Formatter::FormatterItem& fmt,
+    bool negative, bool zero, std::size_t numsize, DigitPrinter printDigits)
+{
+  std::size_t size = numsize;
+
+  unsigned int zerofill;
+
+  if (fmt.precision == _Formatter::FormatterItem::WIDTH_ARG)
+  {
+    FORMAT_ERROR(FormatError::NotImplemented);
+  }
+  else if (fmt.precision == _Formatter::FormatterItem::WIDTH_EMPTY)
+    zerofill = 1;
+  else
+    zerofill = fmt.precision;
+
+  if (zerofill > size)
+    zerofill = zerofill - size;
+  else
+    zerofill = 0;
+
+  // calculate size
+
+  if ((negative && fmt.formatChar == 'd') ||
+      (fmt.flags & _Formatter::FormatterItem::FLAG_SHOW_SIGN) ||
+      (fmt.flags & _Formatter::FormatterItem::FLAG_ADD_SPACE))
+    ++size;
+  else if (fmt.flags & _Formatter::FormatterItem::FLAG_EXPLICIT_BASE)
+    switch (fmt.formatChar)
+    {
+      case 'x': 
+      case 'X':
+        if (!zero)
+          size += 2;
+        break;
+      case 'o': 
+        ++size;
+        break;
+      default:
+        // should not be here
+        assert(false);
+    }
+
+  // get width and calculate needed fill size
+
+  unsigned int fill;
+  if (fmt.width == _Formatter::FormatterItem::WIDTH_ARG)
+  {
+    FORMAT_ERROR(FormatError::NotImplemented);
+  }
+  else if (fmt.width == _Formatter::FormatterItem::WIDTH_EMPTY)
+    fill = 0;
+  else
+    fill = fmt.width;
+
+  if (static_cast<int>(fill) - static_cast<int>(size) -
+        static_cast<int>(zerofill) >= 0)
+    fill = fill - size - zerofill;
+  else
+    fill = 0;
+
+  // fill before sign (with spaces)
+
+  if (!(fmt.flags & _Formatter::FormatterItem::FLAG_FILL_ZERO) &&
+      !(fmt.flags & _Formatter::FormatterItem::FLAG_LEFT_JUSTIFY))
+    for (unsigned int i = 0; i < fill; ++i)
+      m_streambuf.sputc(' ');
+
+  // show sign or base
+
+  if (fmt.flags & _Formatter::FormatterItem::FLAG_EXPLICIT_BASE)
+    switch (fmt.formatChar)
+    {
+      case 'x':
+        if (!zero)
+        {
+          m_streambuf.sputc('0');
+          m_streambuf.sputc('x');
+        }
+        break;
+      case 'X':
+        if (!zero)
+        {
+          m_streambuf.sputc('0');
+          m_streambuf.sputc('X');
+        }
+        break;
+      case 'o':
+        m_streambuf.sputc('0');
+        break;
+      default:
+        // should not be here
+        assert(false);
+    }
+  else if (negative)
+    m_streambuf.sputc('-');
+  else if (fmt.flags & _Formatter::FormatterItem::FLAG_SHOW_SIGN)
+    m_streambuf.sputc('+');
+  else if (fmt.flags & _Formatter::FormatterItem::FLAG_ADD_SPACE)
+    m_streambuf.sputc(' ');
+
+  // fill after sign (with zeros)
+  if (fmt.flags & _Formatter::FormatterItem::FLAG_FILL_ZERO)
+    zerofill += fill;
+
+  for (unsigned int i = 0; i < zerofill; ++i)
+    m_streambuf.sputc('0');
+
+  // print number
+
+  printDigits();
+
+  if (fmt.flags & _Formatter::FormatterItem::FLAG_LEFT_JUSTIFY)
+    for (unsigned int i = 0; i < fill; ++i)
+      m_streambuf.sputc(' ');
+}
+
+template <typename Streambuf>
+template <unsigned int Tbase, typename T>
+std::size_t Formatter<Streambuf>::printIntegral(char* str,
+    const _Formatter::FormatterItem& fmt, T value)
+{
+  static_assert(Tbase == 2 || Tbase == 8 || Tbase == 10 || Tbase == 16,
+      "unsupported base");
+
+  // cast base to same type as T to avoid forcing unsigned cast later
+  const T base = Tbase;
+
+  char baseLetter;
+  if (fmt.formatChar == 'X')
+    baseLetter = 'A';
+  else
+    baseLetter = 'a';
+
+  char* ptr = str-1;
+
+  // convert 8 digits at a time while we can
+  if (Tbase == 10 && sizeof(T) >= 4)
+    while (value / 100000000)
+    {
+      T high = value / 100000000;
+      T low = value - high * 100000000;
+
+      ptr -= 8;
+      _Formatter::digits8(_Formatter::isNegative(low) ? -low : low, ptr+1);
+
+      value = high;
+    }
+
+  if (Tbase == 10)
+  {
+    // what is left is below 10^8, or a short, its magnitude fits 32 bits
+    std::uint32_t rest = _Formatter::isNegative(value) ?
+      0u - static_cast<std::uint32_t>(value) :
+      static_cast<std::uint32_t>(value);
+    const char* pairs = _Formatter::digitPairs();
+
+    while (rest >= 100)
+    {
+      const char* pair = pairs + rest % 100 * 2;
+      rest /= 100;
+      ptr[-1] = pair[0];
+      ptr[0] = pair[1];
+      ptr -= 2;
+    }
+    if (rest >= 10)
+    {
+      ptr[-1] = pairs[rest * 2];
+      ptr[0] = pairs[rest * 2 + 1];
+      ptr -= 2;
+    }
+    else if (rest)
+      *ptr-- = '0' + rest;
+
+    return str-ptr-1;
+  }
+
+  while (value)
+  {
+    int digit = value % base;
+
+    value /= base;
+
+    if (digit < 0)
+    {
+      digit = -digit;
+      // we can invert here without losing precision since we /= 10 above
+      value = -value;
+    }
+
+    if (digit >= 10)
+      digit += baseLetter - 10;
+    else
+      digit += '0';
+
+    *ptr = digit;
+
+    --ptr;
+  }
+
+  return str-ptr-1;
+}
+
+template <typename Streambuf>
+template <unsigned int base, typename T>
+inline
+typename std::enable_if<
+    !_Formatter::isIntegral<T>::value
+  >::type Formatter<Streambuf>::printIntegral(
+      const _Formatter::FormatterItem&, const T&)
+{
+  FORMAT_ERROR(FormatError::IncompatibleType);
+}
+
+template <typename Streambuf>
+template <unsigned int base, typename T>
+inline
+typename std::enable_if<
+    _Formatter::isIntegral<T>::value
+  >::type Formatter<Streambuf>::printUnsigned(
+      const _Formatter::FormatterItem& fmt, T value)
+{
+  printIntegral<base, typename std::make_unsigned<T>::type>(fmt, value);
+}
+
+template <typename Streambuf>
+template <unsigned int base, typename T>
+inline
+typename std::enable_if<
+    !_Formatter::isIntegral<T>::value
+  >::type Formatter<Streambuf>::printUnsigned(
+      const _Formatter::FormatterItem&, const T&)
+{
+  FORMAT_ERROR(FormatError::IncompatibleType);
+}
+
+template <typename Streambuf>
+template <unsigned int base>
+inline
+void Formatter<Streambuf>::printIntegral(
+    const _Formatter::FormatterItem& fmt, BigIntView value)
+{
+  printBigInt<base>(fmt, value, value.negative);
+}
+
+template <typename Streambuf>
+template <unsigned int base>
+inline
+void Formatter<Streambuf>::printUnsigned(
+    const _Formatter::FormatterItem& fmt, BigIntView value)
+{
+  printBigInt<base>(fmt, value, false);
+}
+
+template <typename Streambuf>
+template <unsigned int Tbase>
+void Formatter<Streambuf>::printBigInt(const _Formatter::FormatterItem& fmt,
+    BigIntView value, bool negative)
+{
+  static_assert(Tbase == 2 || Tbase == 8 || Tbase == 10 || Tbase == 16,
+      "unsupported base");
+
+  const _BigInt::Limb* limbs = value.limbs;
+  std::size_t size = _BigInt::normalize(limbs, value.size);
+  negative = negative && size;
+
+  // narrow digits, widened when written
+  char buf[256];
+
+  if (Tbase == 10)
+  {
+    _BigInt::Limb stack[_BigInt::STACK_SCRATCH];
+    _BigInt::Limb* scratch = stack;
+    std::size_t scratchSize = _BigInt::STACK_SCRATCH;
+    if (value.scratch && value.scratchSize > scratchSize)
+    {
+      scratch = value.scratch;
+      scratchSize = value.scratchSize;
+    }
+    if (scratchSize < bigintScratchSize(size))
+    {
+      FORMAT_ERROR(FormatError::BufferTooSmall);
+      return;
+    }
+
+    const _BigInt::Limb* chunks;
+    std::size_t count = _BigInt::toChunks(limbs, size, scratch, chunks);
+
+    // the most significant chunk without its leading zeros, the other ones
+    // with all their 19 digits
+    char top[20];
+    std::size_t topsize = count ?
+      printIntegral<10>(top + 20, fmt, chunks[count-1]) : 0;
+    std::size_t numsize = topsize + (count ? count - 1 : 0) *
+      _BigInt::BASE_DIGITS;
+
+    printNumber(fmt, negative, !size, numsize,
+        [&]()
+        {
+          _Formatter::writeNarrow(m_streambuf, top + 20 - topsize, topsize);
+
+          const std::size_t perBuffer = sizeof(buf) / _BigInt::BASE_DIGITS;
+          char* ptr = buf;
+          for (std::size_t i = count ? count - 1 : 0; i-- > 0; )
+          {
+            _BigInt::Limb chunk = chunks[i];
+            unsigned int high = chunk / 10000000000000000ull;
+            chunk -= high * 10000000000000000ull;
+            ptr[0] = '0' + high / 100;
+            ptr[1] = '0' + high / 10 % 10;
+            ptr[2] = '0' + high % 10;
+            _Formatter::digits8(chunk / 100000000, ptr + 3);
+            _Formatter::digits8(chunk % 100000000, ptr + 11);
+            ptr += _BigInt::BASE_DIGITS;
+
+            if (ptr == buf + perBuffer * _BigInt::BASE_DIGITS)
+            {
+              _Formatter::writeNarrow(m_streambuf, buf, ptr - buf);
+              ptr = buf;
+            }
+          }
+          _Formatter::writeNarrow(m_streambuf, buf, ptr - buf);
+        });
+  }
+  else
+  {
+    // one digit per group of bits, from the most significant one
+    const unsigned int shift = Tbase == 2 ? 1 : Tbase == 8 ? 3 : 4;
+    std::size_t bits = size ?
+      64 * (size - 1) + _BigInt::bitLength(limbs[size-1]) : 0;
+    std::size_t numsize = (bits + shift - 1) / shift;
+
+    const char baseLetter = fmt.formatChar == 'X' ? 'A' : 'a';
+
+    printNumber(fmt, negative, !size, numsize,
+        [&]()
+        {
+          char* ptr = buf;
+          for (std::size_t digit = numsize; digit-- > 0; )
+          {
+            std::size_t position = digit * shift;
+            std::size_t index = position / 64;
+            unsigned int offset = position % 64;
+
+            _BigInt::Limb word = limbs[index] >> offset;
+            if (offset + shift > 64 && index + 1 < size)
+              word |= limbs[index+1] << (64 - offset);
+            unsigned int digitValue = word & (Tbase - 1);
+
+            *ptr++ = digitValue < 10 ?
+              '0' + digitValue : baseLetter + digitValue - 10;
+            if (ptr == buf + sizeof(buf))
+            {
+              _Formatter::writeNarrow(m_streambuf, buf, ptr - buf);
+              ptr = buf;
+            }
+          }
+          _Formatter::writeNarrow(m_streambuf, buf, ptr - buf);
+        });
+  }
+}
+
+PNT_EXPORT template <typename Streambuf, typename... Args>
+inline void writef(Streambuf& streambuf,
+    const typename Streambuf::char_type* format, const Args&... args)
+{
+  Formatter<Streambuf>(streambuf).print(format, args...);
+}
+
+namespace _Formatter
+{
+  // Appends to a std::basic_string, whatever its allocator.
+  template <typename String>
+  class StringStreambuf
+  {
+    public:
+      typedef typename String::value_type char_type;
+      typedef typename String::traits_type traits_type;
+
+      StringStreambuf(String& str) :
+        m_str(str)
+      {}
+
+      typename traits_type::int_type sputc(char_type c)
+      {
+        m_str.push_back(c);
+        return traits_type::to_int_type(c);
+      }
+
+      std::streamsize sputn(const char_type* s, std::streamsize count)
+      {
+        m_str.append(s, count);
+        return count;
+      }
+
+    private:
+      String& m_str;
+  };
+
+  // Output size learned for a format string, keyed by its address. The
+  // hint follows the largest recent output: it jumps up to any larger one
+  // and decays by 1/16 of the difference toward smaller ones.
+  struct SizeHint
+  {
+    std::atomic<const void*> format;
+    std::atomic<std::uint32_t> size;
+    // set when the entry is used, cleared by the formats looking for a slot
+    std::atomic<bool> used;
+
+    void update(std::size_t value)
+    {
+      std::uint32_t old = size.load(std::memory_order_relaxed);
+      std::uint32_t next = value > old ?
+        static_cast<std::uint32_t>(std::min<std::size_t>(value, 0xffffffff)) :
+        old - (old - static_cast<std::uint32_t>(value)) / 16;
+      if (next != old)
+        size.store(next, std::memory_order_relaxed);
+    }
+  };
+
+  // Fixed size open addressing table, lock free. A format which finds its
+  // first PROBES slots taken gets no hint, but clears their used flags, and
+  // takes the first of them not used since on a later call: the entries of
+  // format strings which are not used anymore, built at runtime or freed,
+  // are replaced by the formats which are.
+  //
+  // A format string allocated at the address of a former one may get its
+  // hint, and a thread still updating an entry which is replaced may set
+  // the hint of the new format. Hints only size the reservations, such a
+  // hint is corrected by the following outputs.
+  struct SizeHints
+  {
+    static const std::size_t SIZE = 1024;
+    static const std::size_t PROBES = 8;
+
+    SizeHint entries[SIZE];
+
+    SizeHint* find(const void* format)
+    {
+      std::size_t hash = static_cast<std::size_t>(
+          (reinterpret_cast<std::uintptr_t>(format) >> 3) *
+          0x9e3779b97f4a7c15ull >> 32);
+
+      for (std::size_t i = 0; i < PROBES; ++i)
+      {
+        SizeHint& entry = entries[(hash + i) & (SIZE - 1)];
+        const void* key = entry.format.load(std::memory_order_acquire);
+        if ((!key && entry.format.compare_exchange_strong(key, format)) ||
+            key == format)
+        {
+          if (!entry.used.load(std::memory_order_relaxed))
+            entry.used.store(true, std::memory_order_relaxed);
+          return &entry;
+        }
+      }
+
+      for (std::size_t i = 0; i < PROBES; ++i)
+      {
+        SizeHint& entry = entries[(hash + i) & (SIZE - 1)];
+        if (entry.used.exchange(false, std::memory_order_relaxed))
+          continue;
+        const void* key = entry.format.load(std::memory_order_acquire);
+        if (key && entry.format.compare_exchange_strong(key, format))
+        {
+          entry.size.store(0, std::memory_order_relaxed);
+          entry.used.store(true, std::memory_order_relaxed);
+          return &entry;
+        }
+      }
+      return nullptr;
+    }
+  };
+
+  // zero initialized, without a guard
+  PNT_INLINE_STATIC SizeHints& sizeHints()
+  {
+    static SizeHints hints;
+    return hints;
+  }
+}
+
+// Size learned for the output of format, 0 if none.
+PNT_EXPORT inline std::size_t sizeHint(const void* format)
+{
+  _Formatter::SizeHints& hints = _Formatter::sizeHints();
+  for (const _Formatter::SizeHint& entry : hints.entries)
+    if (entry.format.load(std::memory_order_acquire) == format)
+      return entry.size.load(std::memory_order_relaxed);
+  return 0;
+}
+
+// Calls callback(format, size) for each format string appendf and format
+// learned an output size for. format is only the address the size is
+// learned for, to be compared with format strings: the string may have
+// been freed, or be a const char* or a const wchar_t*, and must not be
+// read.
+PNT_EXPORT template <typename Callback>
+inline void forEachSizeHint(Callback callback)
+{
+  for (const _Formatter::SizeHint& entry : _Formatter::sizeHints().entries)
+  {
+    const void* format = entry.format.load(std::memory_order_acquire);
+    if (format)
+      callback(format,
+          static_cast<std::size_t>(entry.size.load(std::memory_order_relaxed)));
+  }
+}
+
+// Forgets the sizes learned, not to be called while formatting.
+PNT_EXPORT inline void clearSizeHints()
+{
+  for (_Formatter::SizeHint& entry : _Formatter::sizeHints().entries)
+  {
+    entry.size.store(0, std::memory_order_relaxed);
+    entry.used.store(false, std::memory_order_relaxed);
+    entry.format.store(nullptr, std::memory_order_release);
+  }
+}
+
+namespace _Formatter
+{
+  // Appends to str what print writes to the StringStreambuf it is given.
+  // The capacity for the output of format is reserved up front, from the
+  // size of its previous outputs, unless PNT_NO_SIZE_HINTS is defined.
+  template <typename String, typename Print>
+  inline void appendHinted(String& str, const void* format, Print print)
+  {
+#ifndef PNT_NO_SIZE_HINTS
+    std::size_t start = str.size();
+    SizeHint* hint = sizeHints().find(format);
+    if (hint)
+      str.reserve(start + hint->size.load(std::memory_order_relaxed));
+#else
+    (void)format;
+#endif
+
+    StringStreambuf<String> sb(str);
+    print(sb);
+
+#ifndef PNT_NO_SIZE_HINTS
+    if (hint)
+      hint->update(str.size() - start);
+#endif
+  }
+}
+
+// Appends the formatted text to str, which can use any allocator.
+PNT_EXPORT template <typename CharT, typename Traits, typename Alloc,
+  typename... Args>
+inline void appendf(std::basic_string<CharT, Traits, Alloc>& str,
+    const CharT* format, const Args&... args)
+{
+  typedef _Formatter::StringStreambuf<
+    std::basic_string<CharT, Traits, Alloc>> Streambuf;
+
+  _Formatter::appendHinted(str, format, [&](Streambuf& sb)
+      {
+        Formatter<Streambuf>(sb).print(format, args...);
+      });
+}
+
+PNT_EXPORT template <typename... Args>
+inline std::string format(const char* format, const Args&... args)
+{
+  std::string str;
+  appendf(str, format, args...);
+  return str;
+}
+
+PNT_EXPORT template <typename... Args>
+inline std::wstring format(const wchar_t* format, const Args&... args)
+{
+  std::wstring str;
+  appendf(str, format, args...);
+  return str;
+}
+
+// Explicit instantiations of a Formatter and of its conversions of the
+// common integer types, see PNT_INSTANTIATE_COMMON in pnt.hpp. The member
+// templates of Formatter, print, printItem and printByType, are not
+// covered and are instantiated by each translation unit using them.
+
+#define PNT_INSTANTIATE_INTEGRAL(prefix, streambuf, base, type) \
+  prefix template void Formatter<streambuf>::printIntegral<base, type>( \
+      const _Formatter::FormatterItem&, type); \
+  prefix template std::size_t \
+    Formatter<streambuf>::printIntegral<base, type>( \
+      char*, const _Formatter::FormatterItem&, type);
+
+#define PNT_INSTANTIATE_UNSIGNED(prefix, streambuf, base) \
+  PNT_INSTANTIATE_INTEGRAL(prefix, streambuf, base, unsigned int) \
+  PNT_INSTANTIATE_INTEGRAL(prefix, streambuf, base, unsigned long) \
+  PNT_INSTANTIATE_INTEGRAL(prefix, streambuf, base, unsigned long long)
+
+#define PNT_INSTANTIATE_STREAMBUF(prefix, streambuf) \
+  prefix template class Formatter<streambuf>; \
+  PNT_INSTANTIATE_INTEGRAL(prefix, streambuf, 10, int) \
+  PNT_INSTANTIATE_INTEGRAL(prefix, streambuf, 10, long) \
+  PNT_INSTANTIATE_INTEGRAL(prefix, streambuf, 10, long long) \
+  PNT_INSTANTIATE_UNSIGNED(prefix, streambuf, 2) \
+  PNT_INSTANTIATE_UNSIGNED(prefix, streambuf, 8) \
+  PNT_INSTANTIATE_UNSIGNED(prefix, streambuf, 10) \
+  PNT_INSTANTIATE_UNSIGNED(prefix, streambuf, 16)
+
+}
+
+#endif
+// vim: ts=2:sw=2:sts=2:expandtab
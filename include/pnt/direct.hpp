@@ -0,0 +1,377 @@
+// Copyright (c) 2013, Philippe Daouadi <p.daouadi@free.fr>
+// All rights reserved.
+//
+// This file is distributed under the same license as pnt.hpp, see the
+// COPYING file.
+
+#ifndef PNT_DIRECT_HPP
+#define PNT_DIRECT_HPP
+
+#include <pnt/core.hpp>
+
+#include <atomic>
+#include <cerrno>
+#include <condition_variable>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <new>
+#include <thread>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+// File sink for large one-shot exports, which bypasses the page cache so
+// that writing gigabytes does not evict the data of the other processes of
+// the machine.
+//
+// Output is formatted into one of two aligned buffers while the other one
+// is written to the file by a background thread. The file is opened with
+// O_DIRECT where the system and the filesystem support it, otherwise it is
+// written normally and the pages written are dropped from the cache with
+// posix_fadvise(POSIX_FADV_DONTNEED), every SYNC_INTERVAL bytes since the
+// pages must be synced first. A write which O_DIRECT refuses, or which is
+// cut short at an offset it can't continue from, makes the sink drop
+// O_DIRECT and go on with the page cache. On close, the last buffer is
+// padded to the alignment, written, and the file truncated to its actual
+// size.
+//
+//   pnt::DirectFileSink sink("export.csv");
+//   for (const Row& row : rows)
+//     pnt::writef(sink, "%d,%s\n", row.id, row.name);
+//   if (!sink.close())
+//     ... sink.error() ...
+
+namespace pnt
+{
+
+class DirectFileSink
+{
+  public:
+    typedef char char_type;
+    typedef std::char_traits<char> traits_type;
+    typedef traits_type::int_type int_type;
+
+    // O_DIRECT requires buffers, offsets and sizes aligned on the logical
+    // block size of the device, 4096 covers the usual ones
+    static const std::size_t ALIGNMENT = 4096;
+    // without O_DIRECT, bytes written between two syncs of the file after
+    // which the pages are dropped
+    static const std::size_t SYNC_INTERVAL = 16 * 1024 * 1024;
+
+    // bufferSize is rounded up to a multiple of ALIGNMENT. The file is
+    // created, or truncated, with the given mode.
+    explicit DirectFileSink(const char* path,
+        std::size_t bufferSize = 1024 * 1024, mode_t mode = 0644);
+    ~DirectFileSink();
+
+    DirectFileSink(const DirectFileSink&) = delete;
+    DirectFileSink& operator=(const DirectFileSink&) = delete;
+
+    int_type sputc(char_type c);
+    std::streamsize sputn(const char_type* s, std::streamsize count);
+
+    // writes what is left and closes the file. Returns false when the file
+    // could not be opened or written, error() tells why.
+    bool close();
+
+    // errno of the first failure, 0 if none
+    int error() const;
+    // whether the file is written with O_DIRECT
+    bool direct() const;
+    // bytes written so far
+    std::size_t size() const;
+
+  private:
+    int m_fd;
+    // changed by the writer thread if it has to fall back
+    std::atomic<bool> m_direct;
+    std::size_t m_bufferSize;
+    char* m_buffers[2];
+    std::size_t m_current;
+    char* m_ptr;
+    char* m_end;
+    std::atomic<std::size_t> m_size;
+    int m_error;
+    // without O_DIRECT, end of the pages already dropped, only used by
+    // whoever writes
+    std::size_t m_dropped;
+
+    // handed to the writer thread, protected by m_mutex
+    std::mutex m_mutex;
+    std::condition_variable m_condition;
+    char* m_pending;
+    std::size_t m_pendingSize;
+    std::size_t m_offset;
+    bool m_stop;
+    std::thread m_writer;
+
+    void handOff();
+    void wait();
+    void writeLoop();
+    bool writeData(const char* data, std::size_t size, std::size_t offset);
+    bool dropDirect();
+    void dropPages(std::size_t end, bool all);
+};
+
+inline DirectFileSink::DirectFileSink(const char* path,
+    std::size_t bufferSize, mode_t mode) :
+  m_fd(-1),
+  m_direct(false),
+  m_current(0),
+  m_size(0),
+  m_error(0),
+  m_dropped(0),
+  m_pending(nullptr),
+  m_pendingSize(0),
+  m_offset(0),
+  m_stop(false)
+{
+  if (bufferSize < ALIGNMENT)
+    bufferSize = ALIGNMENT;
+  m_bufferSize = (bufferSize + ALIGNMENT - 1) / ALIGNMENT * ALIGNMENT;
+
+  for (int i = 0; i < 2; ++i)
+  {
+    void* buffer;
+    if (::posix_memalign(&buffer, ALIGNMENT, m_bufferSize))
+    {
+      if (i)
+        std::free(m_buffers[0]);
+      throw std::bad_alloc();
+    }
+    m_buffers[i] = static_cast<char*>(buffer);
+  }
+
+  m_ptr = m_buffers[0];
+  m_end = m_ptr + m_bufferSize;
+
+  int flags = O_WRONLY | O_CREAT | O_TRUNC;
+#ifdef O_DIRECT
+  m_fd = ::open(path, flags | O_DIRECT, mode);
+  m_direct = m_fd >= 0;
+  // tmpfs and some network filesystems refuse O_DIRECT
+  if (m_fd < 0 && errno == EINVAL)
+#endif
+    m_fd = ::open(path, flags, mode);
+
+  if (m_fd < 0)
+    m_error = errno;
+  else
+    m_writer = std::thread(&DirectFileSink::writeLoop, this);
+}
+
+inline DirectFileSink::~DirectFileSink()
+{
+  close();
+  std::free(m_buffers[0]);
+  std::free(m_buffers[1]);
+}
+
+inline DirectFileSink::int_type DirectFileSink::sputc(char_type c)
+{
+  if (m_ptr == m_end)
+    handOff();
+  *m_ptr++ = c;
+  return traits_type::to_int_type(c);
+}
+
+inline std::streamsize DirectFileSink::sputn(const char_type* s,
+    std::streamsize count)
+{
+  std::size_t left = count;
+  while (left)
+  {
+    if (m_ptr == m_end)
+      handOff();
+
+    std::size_t size = m_end - m_ptr;
+    if (size > left)
+      size = left;
+    std::memcpy(m_ptr, s, size);
+    m_ptr += size;
+    s += size;
+    left -= size;
+  }
+  return count;
+}
+
+inline bool DirectFileSink::close()
+{
+  if (m_fd < 0)
+    return !m_error;
+
+  wait();
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_stop = true;
+  }
+  m_condition.notify_one();
+  m_writer.join();
+
+  // the tail is padded to the alignment, then cut off by ftruncate
+  char* start = m_buffers[m_current];
+  std::size_t tail = m_ptr - start;
+  bool padded = false;
+  if (tail && !m_error)
+  {
+    std::size_t size = tail;
+    if (m_direct)
+    {
+      size = (tail + ALIGNMENT - 1) / ALIGNMENT * ALIGNMENT;
+      padded = size != tail;
+    }
+    std::memset(m_ptr, 0, size - tail);
+    if (!writeData(start, size, m_offset))
+      m_error = errno;
+    else
+      m_size += tail;
+  }
+  if (!m_error && !m_direct)
+    dropPages(m_offset + tail, true);
+
+  if (!m_error && padded && ::ftruncate(m_fd, m_size) < 0)
+    m_error = errno;
+  if (::close(m_fd) < 0 && !m_error)
+    m_error = errno;
+  m_fd = -1;
+  m_ptr = start;
+
+  return !m_error;
+}
+
+inline int DirectFileSink::error() const
+{
+  return m_error;
+}
+
+inline bool DirectFileSink::direct() const
+{
+  return m_direct;
+}
+
+inline std::size_t DirectFileSink::size() const
+{
+  return m_size;
+}
+
+inline void DirectFileSink::handOff()
+{
+  // the other buffer must have been written before being reused
+  wait();
+
+  if (m_fd >= 0)
+  {
+    {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      m_pending = m_buffers[m_current];
+      m_pendingSize = m_bufferSize;
+    }
+    m_condition.notify_one();
+  }
+
+  m_current ^= 1;
+  m_ptr = m_buffers[m_current];
+  m_end = m_ptr + m_bufferSize;
+}
+
+inline void DirectFileSink::wait()
+{
+  std::unique_lock<std::mutex> lock(m_mutex);
+  m_condition.wait(lock, [this] { return !m_pending; });
+}
+
+inline void DirectFileSink::writeLoop()
+{
+  std::unique_lock<std::mutex> lock(m_mutex);
+  for (;;)
+  {
+    m_condition.wait(lock, [this] { return m_pending || m_stop; });
+    if (!m_pending)
+      return;
+
+    const char* data = m_pending;
+    std::size_t size = m_pendingSize;
+    std::size_t offset = m_offset;
+    bool failed = m_error;
+
+    lock.unlock();
+    int error = 0;
+    if (!failed && !writeData(data, size, offset))
+      error = errno;
+    lock.lock();
+
+    if (error)
+      m_error = error;
+    else if (!failed)
+      m_size += size;
+    m_offset += size;
+    m_pending = nullptr;
+    m_condition.notify_one();
+  }
+}
+
+inline bool DirectFileSink::writeData(const char* data, std::size_t size,
+    std::size_t offset)
+{
+  std::size_t written = 0;
+  while (written < size)
+  {
+    ssize_t result = ::pwrite(m_fd, data + written, size - written,
+        offset + written);
+    if (result < 0)
+    {
+      if (errno == EINTR)
+        continue;
+      // the filesystem accepted the open but not the write
+      if (errno == EINVAL && m_direct && dropDirect())
+        continue;
+      return false;
+    }
+    written += result;
+
+    // a short write leaves the rest at an offset O_DIRECT may refuse
+    if (m_direct && written < size && written % ALIGNMENT && !dropDirect())
+      return false;
+  }
+
+  if (!m_direct)
+    dropPages(offset + size, false);
+
+  return true;
+}
+
+// Goes on with the page cache, false with errno set if the flag can't be
+// cleared.
+inline bool DirectFileSink::dropDirect()
+{
+#ifdef O_DIRECT
+  int flags = ::fcntl(m_fd, F_GETFL);
+  if (flags < 0 || ::fcntl(m_fd, F_SETFL, flags & ~O_DIRECT) < 0)
+    return false;
+#endif
+  m_direct = false;
+  return true;
+}
+
+// Drops the pages written up to end once SYNC_INTERVAL bytes are pending,
+// or all of them. They must be clean to be dropped, hence the sync.
+inline void DirectFileSink::dropPages(std::size_t end, bool all)
+{
+#ifdef POSIX_FADV_DONTNEED
+  if (end <= m_dropped || (!all && end - m_dropped < SYNC_INTERVAL))
+    return;
+
+  ::fdatasync(m_fd);
+  ::posix_fadvise(m_fd, m_dropped, end - m_dropped, POSIX_FADV_DONTNEED);
+  m_dropped = end;
+#else
+  (void)end;
+  (void)all;
+#endif
+}
+
+}
+
+#endif
+// vim: ts=2:sw=2:sts=2:expandtab
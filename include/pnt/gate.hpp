@@ -0,0 +1,305 @@
+// Copyright (c) 2013, Philippe Daouadi <p.daouadi@free.fr>
+// All rights reserved.
+//
+// This file is distributed under the same license as pnt.hpp, see the
+// COPYING file.
+
+#ifndef PNT_GATE_HPP
+#define PNT_GATE_HPP
+
+#include <pnt/core.hpp>
+#include <pnt/hash.hpp>
+
+#include <chrono>
+#include <mutex>
+#include <vector>
+
+#if defined(__linux__)
+#include <time.h>
+#endif
+
+// Suppression of repeated log records before they are formatted.
+//
+//   pnt::LogGate gate(std::chrono::seconds(10), 3);
+//
+//   gate.print(filebuf, "write to %s failed: %d\n", path, errno);
+//
+// A record is identified by the address of its format string and the bytes
+// of its arguments, hashed without formatting anything. Within a window
+// starting at the first record of its kind, the first burst ones are
+// printed and the others are only counted: a burst of 1 drops all the
+// duplicates, a larger one limits their rate. Suppressed records never
+// reach Formatter::print.
+//
+// The number of records suppressed is written before the format string
+// once their window is over:
+//
+//   [suppressed 1234] write to %s failed: %d
+//
+// either before the next record of the kind, or by the summary print()
+// makes of all the kinds once per window, or by flush().
+//
+// Arguments are hashed with their types as described in pnt/hash.hpp,
+// strings, Base64 and BigIntView by content. Other pointers are hashed as
+// addresses: records given a pointer to a buffer reused for different text
+// are taken as repeats and suppressed. Such text must be passed as a
+// string, and other types which are not trivially copyable need an
+// _Hash::ArgHash.
+//
+// A gate may be shared by threads, its table is protected by a mutex which
+// is not held while formatting. Times are read from CLOCK_MONOTONIC_COARSE
+// where available, steady_clock otherwise, or from the Clock given.
+
+namespace pnt
+{
+
+namespace _Gate
+{
+#ifdef CLOCK_MONOTONIC_COARSE
+  // Monotonic clock at the resolution of the kernel tick, a few
+  // milliseconds, which is enough for the windows and cheaper to read than
+  // steady_clock.
+  struct CoarseClock
+  {
+    typedef std::chrono::nanoseconds duration;
+    typedef duration::rep rep;
+    typedef duration::period period;
+    typedef std::chrono::time_point<CoarseClock> time_point;
+    static const bool is_steady = true;
+
+    static time_point now()
+    {
+      timespec ts;
+      clock_gettime(CLOCK_MONOTONIC_COARSE, &ts);
+      return time_point(duration(
+            static_cast<rep>(ts.tv_sec) * 1000000000 + ts.tv_nsec));
+    }
+  };
+
+  typedef CoarseClock DefaultClock;
+#else
+  typedef std::chrono::steady_clock DefaultClock;
+#endif
+}
+
+template <typename CharT, typename Clock = _Gate::DefaultClock>
+class BasicLogGate
+{
+  public:
+    // records of a kind printed per window, the others are suppressed
+    explicit BasicLogGate(
+        typename Clock::duration window = std::chrono::seconds(10),
+        std::size_t burst = 1);
+
+    BasicLogGate(const BasicLogGate&) = delete;
+    BasicLogGate& operator=(const BasicLogGate&) = delete;
+
+    // prints the record unless it is suppressed, returns false if it is
+    template <typename Streambuf, typename... Args>
+    bool print(Streambuf& streambuf, const CharT* format,
+        const Args&... args);
+
+    // writes the counts of all the records suppressed so far, whether
+    // their window is over or not, and returns how many were written
+    template <typename Streambuf>
+    std::size_t flush(Streambuf& streambuf);
+
+    // records suppressed since the gate was created
+    std::size_t suppressed() const;
+
+  private:
+    typedef typename Clock::time_point TimePoint;
+
+    static const std::size_t SIZE = 1024;
+    static const std::size_t PROBES = 4;
+
+    struct Entry
+    {
+      std::uint64_t hash;
+      // nullptr if the entry is free
+      const CharT* format;
+      TimePoint start;
+      std::size_t count;
+      std::size_t suppressed;
+    };
+
+    struct Summary
+    {
+      const CharT* format;
+      std::size_t count;
+    };
+
+    typename Clock::duration m_window;
+    std::size_t m_burst;
+    mutable std::mutex m_mutex;
+    std::vector<Entry> m_entries;
+    TimePoint m_nextSweep;
+    std::size_t m_suppressed;
+
+    Entry& find(std::uint64_t hash, const CharT* format,
+        std::vector<Summary>& summaries);
+    void sweep(TimePoint now, bool all, std::vector<Summary>& summaries);
+    template <typename Streambuf>
+    static void writeSummary(Streambuf& streambuf, const Summary& summary);
+};
+
+typedef BasicLogGate<char> LogGate;
+typedef BasicLogGate<wchar_t> WLogGate;
+
+template <typename CharT, typename Clock>
+inline BasicLogGate<CharT, Clock>::BasicLogGate(
+    typename Clock::duration window, std::size_t burst) :
+  m_window(window),
+  m_burst(burst),
+  m_entries(SIZE),
+  m_nextSweep(Clock::now() + window),
+  m_suppressed(0)
+{
+}
+
+template <typename CharT, typename Clock>
+template <typename Streambuf, typename... Args>
+bool BasicLogGate<CharT, Clock>::print(Streambuf& streambuf,
+    const CharT* format, const Args&... args)
+{
+  _Hash::Hasher hasher;
+  hasher.add(reinterpret_cast<std::uintptr_t>(format));
+  _Hash::addArgs(hasher, args...);
+  std::uint64_t hash = hasher.hash();
+
+  TimePoint now = Clock::now();
+  std::vector<Summary> summaries;
+  bool pass = true;
+
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    if (now >= m_nextSweep)
+    {
+      sweep(now, false, summaries);
+      m_nextSweep = now + m_window;
+    }
+
+    Entry& entry = find(hash, format, summaries);
+    if (!entry.format || now - entry.start >= m_window)
+    {
+      if (entry.suppressed)
+        summaries.push_back(Summary{entry.format, entry.suppressed});
+      entry = Entry{hash, format, now, 1, 0};
+    }
+    else if (entry.count < m_burst)
+      ++entry.count;
+    else
+    {
+      ++entry.suppressed;
+      ++m_suppressed;
+      pass = false;
+    }
+  }
+
+  for (const Summary& summary : summaries)
+    writeSummary(streambuf, summary);
+
+  if (pass)
+    Formatter<Streambuf>(streambuf).print(format, args...);
+  return pass;
+}
+
+template <typename CharT, typename Clock>
+template <typename Streambuf>
+std::size_t BasicLogGate<CharT, Clock>::flush(Streambuf& streambuf)
+{
+  std::vector<Summary> summaries;
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    sweep(Clock::now(), true, summaries);
+  }
+
+  for (const Summary& summary : summaries)
+    writeSummary(streambuf, summary);
+  return summaries.size();
+}
+
+template <typename CharT, typename Clock>
+inline std::size_t BasicLogGate<CharT, Clock>::suppressed() const
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  return m_suppressed;
+}
+
+// The entry of the record, or a free one, or else the oldest of the
+// probed ones, whose count is then summarized. Sweeps free entries in
+// place, so the entry of the record may come after a free one: all the
+// probed entries are looked at before a free one is taken.
+template <typename CharT, typename Clock>
+typename BasicLogGate<CharT, Clock>::Entry&
+  BasicLogGate<CharT, Clock>::find(std::uint64_t hash, const CharT* format,
+      std::vector<Summary>& summaries)
+{
+  Entry* free = nullptr;
+  Entry* oldest = nullptr;
+  for (std::size_t i = 0; i < PROBES; ++i)
+  {
+    Entry& entry = m_entries[(hash + i) & (SIZE - 1)];
+    if (!entry.format)
+    {
+      if (!free)
+        free = &entry;
+    }
+    else if (entry.hash == hash && entry.format == format)
+      return entry;
+    else if (!oldest || entry.start < oldest->start)
+      oldest = &entry;
+  }
+  if (free)
+    return *free;
+
+  if (oldest->suppressed)
+    summaries.push_back(Summary{oldest->format, oldest->suppressed});
+  oldest->format = nullptr;
+  oldest->suppressed = 0;
+  return *oldest;
+}
+
+// Summarizes the entries whose window is over, or all of them, and frees
+// the former.
+template <typename CharT, typename Clock>
+void BasicLogGate<CharT, Clock>::sweep(TimePoint now, bool all,
+    std::vector<Summary>& summaries)
+{
+  for (Entry& entry : m_entries)
+  {
+    if (!entry.format)
+      continue;
+
+    bool over = now - entry.start >= m_window;
+    if (entry.suppressed && (over || all))
+    {
+      summaries.push_back(Summary{entry.format, entry.suppressed});
+      entry.suppressed = 0;
+    }
+    if (over)
+      entry.format = nullptr;
+  }
+}
+
+template <typename CharT, typename Clock>
+template <typename Streambuf>
+void BasicLogGate<CharT, Clock>::writeSummary(Streambuf& streambuf,
+    const Summary& summary)
+{
+  _Formatter::writeAscii(streambuf, "[suppressed ");
+  Formatter<Streambuf>(streambuf).printItem(_Formatter::stringItem(),
+      summary.count);
+  _Formatter::writeAscii(streambuf, "] ");
+
+  std::size_t size = _Formatter::length(summary.format);
+  streambuf.sputn(summary.format, size);
+  if (!size || summary.format[size-1] != '\n')
+    streambuf.sputc('\n');
+}
+
+}
+
+#endif
+// vim: ts=2:sw=2:sts=2:expandtab
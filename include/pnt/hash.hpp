@@ -0,0 +1,255 @@
+// Copyright (c) 2013, Philippe Daouadi <p.daouadi@free.fr>
+// All rights reserved.
+//
+// This file is distributed under the same license as pnt.hpp, see the
+// COPYING file.
+
+#ifndef PNT_HASH_HPP
+#define PNT_HASH_HPP
+
+#include <pnt/core.hpp>
+
+#include <cstring>
+#include <string>
+#include <type_traits>
+
+#if __cplusplus >= 201703L && defined(__has_include)
+#if __has_include(<string_view>)
+#include <string_view>
+#define PNT_HAS_STRING_VIEW 1
+#endif
+#endif
+
+// Identity of the arguments of a record, without formatting them, for
+// LogGate (pnt/gate.hpp) and Memo (pnt/memo.hpp).
+//
+// Each argument is taken with a tag of its type, so that the same bytes in
+// arguments of different types, 'A' and 65 or (short)-1 and
+// (unsigned short)65535, make different keys even when the format string
+// is the same. Arguments are taken by their object representation, except
+// C strings, std::basic_string, std::basic_string_view, Base64 and
+// BigIntView which are taken by content. Other pointers are taken as
+// addresses: a pointer to a buffer reused for another content makes the
+// same key. Other types which are not trivially copyable need a
+// specialization of _Hash::ArgHash, as for _Formatter::Printer:
+//
+//   template <>
+//   struct ArgHash<MyType>
+//   {
+//     template <typename Hasher>
+//     static void add(Hasher& hasher, const MyType& arg);
+//   };
+//
+// where hasher has add(std::uint64_t) and add(const void*, std::size_t).
+
+namespace pnt
+{
+
+namespace _Hash
+{
+  class Hasher
+  {
+    public:
+      Hasher() :
+        m_hash(0x84222325cbf29ce4ull)
+      {}
+
+      void add(std::uint64_t value)
+      {
+        m_hash = (m_hash ^ value) * 0x9e3779b97f4a7c15ull;
+        m_hash ^= m_hash >> 29;
+      }
+
+      void add(const void* data, std::size_t size)
+      {
+        const unsigned char* bytes = static_cast<const unsigned char*>(data);
+        std::uint64_t word;
+        add(size);
+
+        if (size < 8)
+        {
+          word = 0;
+          for (std::size_t i = 0; i < size; ++i)
+            word |= static_cast<std::uint64_t>(bytes[i]) << i * 8;
+          add(word);
+          return;
+        }
+
+        // the last word overlaps the previous one
+        for (; size > 8; size -= 8, bytes += 8)
+        {
+          std::memcpy(&word, bytes, 8);
+          add(word);
+        }
+        std::memcpy(&word, bytes + size - 8, 8);
+        add(word);
+      }
+
+      std::uint64_t hash() const
+      {
+        return m_hash ^ m_hash >> 32;
+      }
+
+    private:
+      std::uint64_t m_hash;
+  };
+
+  template <typename T>
+  struct ArgHash
+  {
+    static_assert(std::is_trivially_copyable<T>::value,
+        "ArgHash must be specialized for this type");
+
+    template <typename Hasher>
+    static void add(Hasher& hasher, const T& arg)
+    {
+      add(hasher, arg, std::integral_constant<bool, sizeof(T) <= 8>());
+    }
+
+    // the size is given by the type, small values take a single word
+    template <typename Hasher>
+    static void add(Hasher& hasher, const T& arg, std::true_type)
+    {
+      std::uint64_t word = 0;
+      std::memcpy(&word, &arg, sizeof(T));
+      hasher.add(word);
+    }
+
+    template <typename Hasher>
+    static void add(Hasher& hasher, const T& arg, std::false_type)
+    {
+      hasher.add(&arg, sizeof(T));
+    }
+  };
+
+  template <typename CharT>
+  struct StringHash
+  {
+    template <typename Hasher>
+    static void add(Hasher& hasher, const CharT* arg)
+    {
+      if (arg)
+        hasher.add(arg, _Formatter::length(arg) * sizeof(CharT));
+      else
+        hasher.add(0);
+    }
+  };
+
+  template <>
+  struct ArgHash<const char*> : StringHash<char> {};
+  template <>
+  struct ArgHash<char*> : StringHash<char> {};
+  template <>
+  struct ArgHash<const wchar_t*> : StringHash<wchar_t> {};
+  template <>
+  struct ArgHash<wchar_t*> : StringHash<wchar_t> {};
+  template <std::size_t N>
+  struct ArgHash<char[N]> : StringHash<char> {};
+  template <std::size_t N>
+  struct ArgHash<wchar_t[N]> : StringHash<wchar_t> {};
+
+  template <typename CharT, typename Traits, typename Alloc>
+  struct ArgHash<std::basic_string<CharT, Traits, Alloc>>
+  {
+    template <typename Hasher>
+    static void add(Hasher& hasher,
+        const std::basic_string<CharT, Traits, Alloc>& arg)
+    {
+      hasher.add(arg.data(), arg.size() * sizeof(CharT));
+    }
+  };
+
+  // The address of id is distinct for each type. It is not const, so that
+  // it is not merged with other constants.
+  template <typename T>
+  struct TypeTag
+  {
+    static char id;
+  };
+
+  template <typename T>
+  char TypeTag<T>::id = 0;
+
+  // the type whose tag is taken, the strings of a character type, which
+  // print the same for the same content, share theirs
+  template <typename T>
+  struct TagOf
+  {
+    typedef T type;
+  };
+
+  template <>
+  struct TagOf<char*> : TagOf<const char*> {};
+  template <>
+  struct TagOf<wchar_t*> : TagOf<const wchar_t*> {};
+  template <std::size_t N>
+  struct TagOf<char[N]> : TagOf<const char*> {};
+  template <std::size_t N>
+  struct TagOf<wchar_t[N]> : TagOf<const wchar_t*> {};
+  template <typename CharT, typename Traits, typename Alloc>
+  struct TagOf<std::basic_string<CharT, Traits, Alloc>> :
+    TagOf<const CharT*> {};
+
+  // user space addresses leave the high bits to the size and signedness
+  template <typename T>
+  inline std::uint64_t typeTag()
+  {
+    return reinterpret_cast<std::uintptr_t>(&TypeTag<T>::id) ^
+      static_cast<std::uint64_t>(sizeof(T)) << 48 ^
+      static_cast<std::uint64_t>(std::is_signed<T>::value) << 47;
+  }
+
+#ifdef PNT_HAS_STRING_VIEW
+  template <typename CharT, typename Traits>
+  struct ArgHash<std::basic_string_view<CharT, Traits>>
+  {
+    template <typename Hasher>
+    static void add(Hasher& hasher,
+        const std::basic_string_view<CharT, Traits>& arg)
+    {
+      hasher.add(arg.data(), arg.size() * sizeof(CharT));
+    }
+  };
+#endif
+
+  template <>
+  struct ArgHash<Base64>
+  {
+    template <typename Hasher>
+    static void add(Hasher& hasher, const Base64& arg)
+    {
+      hasher.add(arg.url);
+      hasher.add(arg.data, arg.size);
+    }
+  };
+
+  // the scratch space does not change the output
+  template <>
+  struct ArgHash<BigIntView>
+  {
+    template <typename Hasher>
+    static void add(Hasher& hasher, const BigIntView& arg)
+    {
+      hasher.add(arg.negative);
+      hasher.add(arg.limbs, arg.size * sizeof(*arg.limbs));
+    }
+  };
+
+  template <typename Hasher>
+  inline void addArgs(Hasher&)
+  {
+  }
+
+  template <typename Hasher, typename Arg1, typename... Args>
+  inline void addArgs(Hasher& hasher, const Arg1& arg1, const Args&... args)
+  {
+    hasher.add(typeTag<typename TagOf<Arg1>::type>());
+    ArgHash<Arg1>::add(hasher, arg1);
+    addArgs(hasher, args...);
+  }
+}
+
+}
+
+#endif
+// vim: ts=2:sw=2:sts=2:expandtab
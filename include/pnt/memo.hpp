@@ -0,0 +1,289 @@
+// Copyright (c) 2013, Philippe Daouadi <p.daouadi@free.fr>
+// All rights reserved.
+//
+// This file is distributed under the same license as pnt.hpp, see the
+// COPYING file.
+
+#ifndef PNT_MEMO_HPP
+#define PNT_MEMO_HPP
+
+#include <pnt/core.hpp>
+#include <pnt/compiled.hpp>
+#include <pnt/hash.hpp>
+
+#include <algorithm>
+#include <cstring>
+#include <iterator>
+#include <list>
+#include <string>
+#include <unordered_map>
+#include <utility>
+
+// Cache of the outputs of records repeated with the same arguments, such
+// as constant headers and status lines:
+//
+//   thread_local pnt::Memo memo;
+//
+//   memo.print(filebuf, PNT_COMPILED("%s: %d jobs running\n"), name, count);
+//   memo.print(filebuf, "uptime %s\n", uptime);
+//
+// A record is keyed by its format, the Id of a compiled one or the address
+// of the format string otherwise, and by the types and the bytes of its
+// arguments as described in pnt/hash.hpp, without formatting. The outputs
+// of the most recently used keys are kept, up to a number of entries and of
+// bytes, and a hit is written with a single sputn. Keys are compared in
+// full, not only by their hash.
+//
+// Only arguments which always print the same way for the same bytes must
+// be given: a pointer to a buffer whose content changes, for instance,
+// would print the former content again.
+//
+// A Memo is not locked, each thread must use its own.
+
+namespace pnt
+{
+
+namespace _Memo
+{
+  // Serializes the key of a record at the beginning of a buffer, which
+  // only grows, and hashes it, with the interface of _Hash::Hasher.
+  class KeyBuilder
+  {
+    public:
+      KeyBuilder(std::string& buffer) :
+        m_buffer(buffer),
+        m_size(0)
+      {}
+
+      void add(std::uint64_t value)
+      {
+        m_hasher.add(value);
+        write(&value, sizeof(value));
+      }
+
+      void add(const void* data, std::size_t size)
+      {
+        m_hasher.add(data, size);
+        write(&size, sizeof(size));
+        write(data, size);
+      }
+
+      std::uint64_t hash() const
+      {
+        return m_hasher.hash();
+      }
+
+      std::size_t size() const
+      {
+        return m_size;
+      }
+
+    private:
+      std::string& m_buffer;
+      std::size_t m_size;
+      _Hash::Hasher m_hasher;
+
+      void write(const void* data, std::size_t size)
+      {
+        if (m_buffer.size() < m_size + size)
+          m_buffer.resize(std::max(m_buffer.size() * 2, m_size + size));
+        std::memcpy(&m_buffer[m_size], data, size);
+        m_size += size;
+      }
+  };
+}
+
+template <typename CharT>
+class BasicMemo
+{
+  public:
+    typedef std::basic_string<CharT> String;
+
+    // keeps at most maxEntries outputs, and maxBytes of keys and outputs
+    explicit BasicMemo(std::size_t maxEntries = 256,
+        std::size_t maxBytes = 64 * 1024);
+
+    BasicMemo(const BasicMemo&) = delete;
+    BasicMemo& operator=(const BasicMemo&) = delete;
+
+    template <typename Streambuf, typename... Args>
+    void print(Streambuf& streambuf, const CharT* format,
+        const Args&... args);
+    template <typename Streambuf, std::uint64_t Id, typename... Args>
+    void print(Streambuf& streambuf, CompiledFormat<CharT, Id> format,
+        const Args&... args);
+
+    std::size_t hits() const;
+    std::size_t misses() const;
+    // number of outputs kept, and bytes used by them and their keys
+    std::size_t size() const;
+    std::size_t bytes() const;
+
+    void clear();
+
+  private:
+    struct Entry
+    {
+      std::uint64_t hash;
+      std::string key;
+      String output;
+
+      std::size_t bytes() const
+      {
+        return key.size() + output.size() * sizeof(CharT);
+      }
+    };
+
+    typedef std::list<Entry> Entries;
+    // where the outputs are rendered
+    typedef _Formatter::StringStreambuf<String> Output;
+
+    std::size_t m_maxEntries;
+    std::size_t m_maxBytes;
+    // most recently used first
+    Entries m_entries;
+    std::unordered_map<std::uint64_t, typename Entries::iterator> m_index;
+    std::size_t m_bytes;
+    std::size_t m_hits;
+    std::size_t m_misses;
+    // the key of the current record is built at its beginning
+    std::string m_key;
+
+    template <typename Streambuf, typename Render>
+    void printKeyed(Streambuf& streambuf, std::uint64_t hash,
+        std::size_t keySize, Render render);
+    void erase(typename Entries::iterator entry);
+};
+
+typedef BasicMemo<char> Memo;
+typedef BasicMemo<wchar_t> WMemo;
+
+template <typename CharT>
+inline BasicMemo<CharT>::BasicMemo(std::size_t maxEntries,
+    std::size_t maxBytes) :
+  m_maxEntries(maxEntries),
+  m_maxBytes(maxBytes),
+  m_bytes(0),
+  m_hits(0),
+  m_misses(0)
+{
+}
+
+template <typename CharT>
+template <typename Streambuf, typename... Args>
+inline void BasicMemo<CharT>::print(Streambuf& streambuf,
+    const CharT* format, const Args&... args)
+{
+  _Memo::KeyBuilder key(m_key);
+  key.add(reinterpret_cast<std::uintptr_t>(format));
+  _Hash::addArgs(key, args...);
+
+  printKeyed(streambuf, key.hash(), key.size(), [&](Output& sb)
+      {
+        Formatter<Output>(sb).print(format, args...);
+      });
+}
+
+// Compiled formats are keyed by their Id, a hash of their content, so the
+// same format string at several call sites shares its entries.
+template <typename CharT>
+template <typename Streambuf, std::uint64_t Id, typename... Args>
+inline void BasicMemo<CharT>::print(Streambuf& streambuf,
+    CompiledFormat<CharT, Id> format, const Args&... args)
+{
+  _Memo::KeyBuilder key(m_key);
+  key.add(Id);
+  _Hash::addArgs(key, args...);
+
+  printKeyed(streambuf, key.hash(), key.size(), [&](Output& sb)
+      {
+        _Formatter::CompiledPrinter<Id>::print(sb, format.format, args...);
+      });
+}
+
+template <typename CharT>
+inline std::size_t BasicMemo<CharT>::hits() const
+{
+  return m_hits;
+}
+
+template <typename CharT>
+inline std::size_t BasicMemo<CharT>::misses() const
+{
+  return m_misses;
+}
+
+template <typename CharT>
+inline std::size_t BasicMemo<CharT>::size() const
+{
+  return m_entries.size();
+}
+
+template <typename CharT>
+inline std::size_t BasicMemo<CharT>::bytes() const
+{
+  return m_bytes;
+}
+
+template <typename CharT>
+inline void BasicMemo<CharT>::clear()
+{
+  m_entries.clear();
+  m_index.clear();
+  m_bytes = 0;
+}
+
+// Looks the key at the beginning of m_key up, and on a miss, renders the
+// output and keeps it. The output is written with a single sputn in both
+// cases.
+template <typename CharT>
+template <typename Streambuf, typename Render>
+void BasicMemo<CharT>::printKeyed(Streambuf& streambuf,
+    std::uint64_t hash, std::size_t keySize, Render render)
+{
+  auto found = m_index.find(hash);
+  if (found != m_index.end())
+  {
+    typename Entries::iterator entry = found->second;
+    if (entry->key.size() == keySize &&
+        !std::memcmp(entry->key.data(), m_key.data(), keySize))
+    {
+      ++m_hits;
+      m_entries.splice(m_entries.begin(), m_entries, entry);
+      streambuf.sputn(entry->output.data(), entry->output.size());
+      return;
+    }
+    // another key with the same hash, replaced
+    erase(entry);
+  }
+
+  ++m_misses;
+
+  Entry entry = {hash, std::string(m_key.data(), keySize), String()};
+  Output output(entry.output);
+  render(output);
+  streambuf.sputn(entry.output.data(), entry.output.size());
+
+  if (entry.bytes() > m_maxBytes || !m_maxEntries)
+    return;
+
+  m_entries.push_front(std::move(entry));
+  m_index[hash] = m_entries.begin();
+  m_bytes += m_entries.front().bytes();
+
+  while (m_entries.size() > m_maxEntries || m_bytes > m_maxBytes)
+    erase(std::prev(m_entries.end()));
+}
+
+template <typename CharT>
+inline void BasicMemo<CharT>::erase(typename Entries::iterator entry)
+{
+  m_bytes -= entry->bytes();
+  m_index.erase(entry->hash);
+  m_entries.erase(entry);
+}
+
+}
+
+#endif
+// vim: ts=2:sw=2:sts=2:expandtab
@@ -0,0 +1,436 @@
+// Copyright (c) 2013, Philippe Daouadi <p.daouadi@free.fr>
+// All rights reserved.
+//
+// This file is distributed under the same license as pnt.hpp, see the
+// COPYING file.
+
+#ifndef PNT_MERGE_HPP
+#define PNT_MERGE_HPP
+
+#include <pnt/core.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <functional>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+// Per-thread log queues merged by timestamp.
+//
+// Each thread formats its records into its own single producer, single
+// consumer queue, with the time at which it started them, and without any
+// lock shared with the other threads. A consumer merges the queues by
+// timestamp, so that the output is globally ordered:
+//
+//   pnt::MergeLog log;
+//
+//   // each thread
+//   pnt::MergeLog::Producer producer(log);
+//   producer.print("%s %d\n", name, value);
+//
+//   // consumer thread
+//   log.drain(filebuf);
+//
+// A record may only be written once no thread can still produce an older
+// one. Before taking a timestamp, a producer publishes the timestamp of its
+// previous record, which bounds the one it is about to take. The consumer
+// takes the current time, then the minimum of these bounds over the
+// producers in the middle of a record: this watermark is older than any
+// record not in the queues yet, and the records older than it are written.
+// The others wait for the next drain.
+
+namespace pnt
+{
+
+namespace _Merge
+{
+  typedef std::uint64_t Timestamp;
+
+  const Timestamp IDLE = std::numeric_limits<Timestamp>::max();
+
+  inline Timestamp now()
+  {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+  }
+
+  // Records are a header and the text, aligned on the header size so that
+  // a header always fits before the end of the ring.
+  struct Header
+  {
+    Timestamp timestamp;
+    // WRAP for the filler at the end of the ring
+    std::uint32_t size;
+    std::uint32_t unused;
+  };
+
+  const std::uint32_t WRAP = 0xffffffff;
+
+  inline std::size_t recordSize(std::size_t size)
+  {
+    return (sizeof(Header) + size + sizeof(Header) - 1) /
+      sizeof(Header) * sizeof(Header);
+  }
+
+  // Writes in place into a slot of the ring, what does not fit is dropped.
+  class SlotStreambuf
+  {
+    public:
+      typedef char char_type;
+      typedef std::char_traits<char> traits_type;
+      typedef traits_type::int_type int_type;
+
+      SlotStreambuf(char* begin, std::size_t size) :
+        m_ptr(begin),
+        m_begin(begin),
+        m_end(begin + size)
+      {}
+
+      int_type sputc(char_type c)
+      {
+        if (m_ptr == m_end)
+          return traits_type::eof();
+        *m_ptr++ = c;
+        return traits_type::to_int_type(c);
+      }
+
+      std::streamsize sputn(const char_type* s, std::streamsize count)
+      {
+        if (count > m_end - m_ptr)
+          count = m_end - m_ptr;
+        std::memcpy(m_ptr, s, count);
+        m_ptr += count;
+        return count;
+      }
+
+      std::size_t size() const
+      {
+        return m_ptr - m_begin;
+      }
+
+    private:
+      char* m_ptr;
+      char* m_begin;
+      char* m_end;
+  };
+
+  struct Queue
+  {
+    Queue(std::size_t capacity) :
+      data(new char[capacity]),
+      mask(capacity - 1),
+      head(0),
+      tail(0),
+      pending(IDLE),
+      lastTimestamp(0),
+      closed(false)
+    {}
+
+    std::unique_ptr<char[]> data;
+    std::size_t mask;
+    // written by the consumer
+    std::atomic<std::uint64_t> head;
+    // written by the producer
+    std::atomic<std::uint64_t> tail;
+    // lower bound of the timestamp of the record being written, IDLE if
+    // none
+    std::atomic<Timestamp> pending;
+    Timestamp lastTimestamp;
+    std::atomic<bool> closed;
+
+    Header* header(std::uint64_t position)
+    {
+      return reinterpret_cast<Header*>(data.get() + (position & mask));
+    }
+  };
+
+  // Clears the bound published by a producer when its record is done, or
+  // given up because formatting it threw: the consumer would otherwise hold
+  // back the records of all the queues behind it.
+  class PendingGuard
+  {
+    public:
+      PendingGuard(Queue& queue) :
+        m_queue(queue)
+      {
+        m_queue.pending.store(m_queue.lastTimestamp);
+      }
+
+      ~PendingGuard()
+      {
+        m_queue.pending.store(IDLE);
+      }
+
+      PendingGuard(const PendingGuard&) = delete;
+      PendingGuard& operator=(const PendingGuard&) = delete;
+
+    private:
+      Queue& m_queue;
+  };
+}
+
+class MergeLog
+{
+  public:
+    class Producer;
+
+    // capacity is the size of the queue of each producer, rounded up to a
+    // power of two. Records longer than maxRecordSize are truncated.
+    explicit MergeLog(std::size_t capacity = 256 * 1024,
+        std::size_t maxRecordSize = 1024);
+
+    MergeLog(const MergeLog&) = delete;
+    MergeLog& operator=(const MergeLog&) = delete;
+
+    // writes the records older than the watermark to streambuf, in
+    // timestamp order, and returns how many were written. Drains must not
+    // run concurrently.
+    template <typename Streambuf>
+    std::size_t drain(Streambuf& streambuf);
+    // writes all the records, once the producers are done
+    template <typename Streambuf>
+    std::size_t drainAll(Streambuf& streambuf);
+
+    // records dropped because a queue was full
+    std::size_t dropped() const;
+
+  private:
+    typedef _Merge::Queue Queue;
+
+    std::size_t m_capacity;
+    std::size_t m_maxRecordSize;
+    // only locked to add or remove a producer, never while writing
+    std::mutex m_mutex;
+    std::vector<std::unique_ptr<Queue>> m_queues;
+    std::atomic<std::size_t> m_dropped;
+
+    Queue* addQueue();
+    // the queues are only removed by the consumer, those taken stay valid
+    // until it removes them
+    std::vector<Queue*> queues();
+    void removeClosed();
+    template <typename Streambuf>
+    std::size_t merge(Streambuf& streambuf, const std::vector<Queue*>& queues,
+        _Merge::Timestamp watermark);
+};
+
+// Handle of a thread on a MergeLog, to be used by that thread only, and
+// destroyed before the log. Its queue is drained after it is destroyed.
+class MergeLog::Producer
+{
+  public:
+    explicit Producer(MergeLog& log);
+    ~Producer();
+
+    Producer(const Producer&) = delete;
+    Producer& operator=(const Producer&) = delete;
+
+    // formats a record into the queue, returns false if the queue was full
+    template <typename... Args>
+    bool print(const char* format, const Args&... args);
+
+  private:
+    MergeLog& m_log;
+    Queue* m_queue;
+};
+
+inline MergeLog::MergeLog(std::size_t capacity, std::size_t maxRecordSize) :
+  m_capacity(1),
+  m_maxRecordSize(maxRecordSize),
+  m_dropped(0)
+{
+  while (m_capacity < capacity ||
+      m_capacity < 2 * _Merge::recordSize(maxRecordSize))
+    m_capacity *= 2;
+}
+
+inline std::size_t MergeLog::dropped() const
+{
+  return m_dropped.load(std::memory_order_relaxed);
+}
+
+inline MergeLog::Queue* MergeLog::addQueue()
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  m_queues.push_back(std::unique_ptr<Queue>(new Queue(m_capacity)));
+  return m_queues.back().get();
+}
+
+template <typename Streambuf>
+inline std::size_t MergeLog::drain(Streambuf& streambuf)
+{
+  // the time is taken before reading the bounds, a producer publishing a
+  // bound after that takes a later timestamp
+  _Merge::Timestamp watermark = _Merge::now();
+
+  // a producer added after the time was taken has no older record
+  std::vector<Queue*> queues = this->queues();
+  for (Queue* queue : queues)
+    watermark = std::min(watermark, queue->pending.load());
+
+  return merge(streambuf, queues, watermark);
+}
+
+template <typename Streambuf>
+inline std::size_t MergeLog::drainAll(Streambuf& streambuf)
+{
+  return merge(streambuf, queues(), _Merge::IDLE);
+}
+
+inline std::vector<MergeLog::Queue*> MergeLog::queues()
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  std::vector<Queue*> queues;
+  queues.reserve(m_queues.size());
+  for (const std::unique_ptr<Queue>& queue : m_queues)
+    queues.push_back(queue.get());
+  return queues;
+}
+
+// the queues of the producers which are gone are removed once empty
+inline void MergeLog::removeClosed()
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  m_queues.erase(std::remove_if(m_queues.begin(), m_queues.end(),
+        [](const std::unique_ptr<Queue>& queue)
+        {
+          return queue->closed.load(std::memory_order_acquire) &&
+            queue->head.load(std::memory_order_relaxed) ==
+            queue->tail.load(std::memory_order_relaxed);
+        }), m_queues.end());
+}
+
+// Writes the records without holding m_mutex, a slow streambuf does not
+// block the threads creating producers.
+template <typename Streambuf>
+std::size_t MergeLog::merge(Streambuf& streambuf,
+    const std::vector<Queue*>& queues, _Merge::Timestamp watermark)
+{
+  struct Cursor
+  {
+    Queue* queue;
+    std::uint64_t position;
+    std::uint64_t tail;
+    const _Merge::Header* header;
+
+    // next record, skipping the filler at the end of the ring
+    bool next()
+    {
+      while (position != tail)
+      {
+        header = queue->header(position);
+        if (header->size != _Merge::WRAP)
+          return true;
+        position += queue->mask + 1 - (position & queue->mask);
+      }
+      return false;
+    }
+  };
+
+  // cursors whose next record is older than the watermark, as a min heap
+  std::vector<Cursor> cursors;
+  cursors.reserve(queues.size());
+  for (Queue* queue : queues)
+  {
+    Cursor cursor = {queue, queue->head.load(std::memory_order_relaxed),
+      queue->tail.load(std::memory_order_acquire), nullptr};
+    if (cursor.next() && cursor.header->timestamp < watermark)
+      cursors.push_back(cursor);
+    else
+      queue->head.store(cursor.position, std::memory_order_release);
+  }
+
+  auto later = [](const Cursor& a, const Cursor& b)
+    {
+      return a.header->timestamp > b.header->timestamp;
+    };
+  std::make_heap(cursors.begin(), cursors.end(), later);
+
+  std::size_t count = 0;
+  while (!cursors.empty())
+  {
+    std::pop_heap(cursors.begin(), cursors.end(), later);
+    Cursor& cursor = cursors.back();
+
+    streambuf.sputn(reinterpret_cast<const char*>(cursor.header + 1),
+        cursor.header->size);
+    ++count;
+
+    cursor.position += _Merge::recordSize(cursor.header->size);
+    if (cursor.next() && cursor.header->timestamp < watermark)
+      std::push_heap(cursors.begin(), cursors.end(), later);
+    else
+    {
+      cursor.queue->head.store(cursor.position, std::memory_order_release);
+      cursors.pop_back();
+    }
+  }
+
+  removeClosed();
+  return count;
+}
+
+inline MergeLog::Producer::Producer(MergeLog& log) :
+  m_log(log),
+  m_queue(log.addQueue())
+{
+}
+
+inline MergeLog::Producer::~Producer()
+{
+  m_queue->closed.store(true, std::memory_order_release);
+}
+
+template <typename... Args>
+inline bool MergeLog::Producer::print(const char* format,
+    const Args&... args)
+{
+  Queue& queue = *m_queue;
+
+  _Merge::PendingGuard guard(queue);
+  _Merge::Timestamp timestamp = _Merge::now();
+
+  std::uint64_t tail = queue.tail.load(std::memory_order_relaxed);
+  std::uint64_t head = queue.head.load(std::memory_order_acquire);
+  std::size_t capacity = queue.mask + 1;
+  std::size_t needed = _Merge::recordSize(m_log.m_maxRecordSize);
+
+  // a record does not wrap around the end of the ring
+  std::size_t contiguous = capacity - (tail & queue.mask);
+  std::size_t filler = contiguous < needed ? contiguous : 0;
+  if (capacity - (tail - head) < filler + needed)
+  {
+    m_log.m_dropped.fetch_add(1, std::memory_order_relaxed);
+    return false;
+  }
+
+  if (filler)
+  {
+    queue.header(tail)->size = _Merge::WRAP;
+    tail += filler;
+  }
+
+  _Merge::Header* header = queue.header(tail);
+  _Merge::SlotStreambuf slot(reinterpret_cast<char*>(header + 1),
+      m_log.m_maxRecordSize);
+  Formatter<_Merge::SlotStreambuf> formatter(slot);
+  formatter.print(format, args...);
+
+  header->timestamp = timestamp;
+  header->size = static_cast<std::uint32_t>(slot.size());
+
+  queue.tail.store(tail + _Merge::recordSize(slot.size()),
+      std::memory_order_release);
+  queue.lastTimestamp = timestamp;
+
+  return true;
+}
+
+}
+
+#endif
+// vim: ts=2:sw=2:sts=2:expandtab
@@ -0,0 +1,507 @@
+// Copyright (c) 2013, Philippe Daouadi <p.daouadi@free.fr>
+// All rights reserved.
+//
+// This file is distributed under the same license as pnt.hpp, see the
+// COPYING file.
+
+#ifndef PNT_METRICS_HPP
+#define PNT_METRICS_HPP
+
+#include <pnt/core.hpp>
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <initializer_list>
+#include <string>
+
+#if __cplusplus >= 201703L
+#include <charconv>
+#endif
+
+// Writers for the Prometheus text exposition format and the InfluxDB line
+// protocol.
+//
+// The metric name and the constant labels of a series are escaped and
+// rendered once when the series is built, writing a sample then only appends
+// that prefix, the labels given with the sample, the value and the
+// timestamp. Label values are escaped with the SIMD escaping scan and values
+// are converted with Formatter, typically into a pnt::Buffer reused from one
+// scrape to the next.
+//
+//   pnt::PrometheusSeries requests("http_requests_total");
+//   requests.label("method", "get");
+//
+//   pnt::Buffer buffer;
+//   pnt::PrometheusWriter<pnt::Buffer> writer(buffer);
+//   writer.sample(requests, {{"code", "200"}}, 1027, 1395066363000);
+
+namespace pnt
+{
+
+struct MetricLabel
+{
+  const char* name;
+  const char* value;
+};
+
+namespace _Metrics
+{
+  // Copies [str, str+size) escaping a, b and c with a backslash, a new line
+  // being escaped as \n.
+  template <typename Streambuf>
+  void writeEscaped(Streambuf& streambuf, const char* str, std::size_t size,
+      char a, char b, char c)
+  {
+    static_assert(sizeof(typename Streambuf::char_type) == 1,
+        "metrics are written in bytes");
+
+    const char* end = str + size;
+    while (true)
+    {
+      const char* special = _Simd::kernels().findAny(str, end, a, b, c);
+      streambuf.sputn(str, special - str);
+      if (special == end)
+        return;
+
+      streambuf.sputc('\\');
+      streambuf.sputc(*special == '\n' ? 'n' : *special);
+      str = special + 1;
+    }
+  }
+
+  template <typename Streambuf>
+  void writeEscaped(Streambuf& streambuf, const std::string& str,
+      char a, char b, char c)
+  {
+    writeEscaped(streambuf, str.data(), str.size(), a, b, c);
+  }
+
+  template <typename Streambuf>
+  void writeEscaped(Streambuf& streambuf, const char* str,
+      char a, char b, char c)
+  {
+    writeEscaped(streambuf, str, _Formatter::length(str), a, b, c);
+  }
+
+  // Copies [str, str+size) escaping a, b and c with a backslash and
+  // dropping the new lines, which the line protocol can't escape.
+  template <typename Streambuf>
+  void writeInfluxEscaped(Streambuf& streambuf, const char* str,
+      std::size_t size, char a, char b, char c)
+  {
+    static_assert(sizeof(typename Streambuf::char_type) == 1,
+        "metrics are written in bytes");
+
+    const char* end = str + size;
+    while (true)
+    {
+      const char* special = _Simd::kernels().findAny(str, end, a, b, c);
+      const char* newline;
+      while ((newline = static_cast<const char*>(
+              std::memchr(str, '\n', special - str))))
+      {
+        streambuf.sputn(str, newline - str);
+        str = newline + 1;
+      }
+      streambuf.sputn(str, special - str);
+      if (special == end)
+        return;
+
+      streambuf.sputc('\\');
+      streambuf.sputc(*special);
+      str = special + 1;
+    }
+  }
+
+  template <typename Streambuf>
+  void writeInfluxEscaped(Streambuf& streambuf, const std::string& str,
+      char a, char b, char c)
+  {
+    writeInfluxEscaped(streambuf, str.data(), str.size(), a, b, c);
+  }
+
+  template <typename Streambuf>
+  void writeInfluxEscaped(Streambuf& streambuf, const char* str,
+      char a, char b, char c)
+  {
+    writeInfluxEscaped(streambuf, str, _Formatter::length(str), a, b, c);
+  }
+
+  inline const _Formatter::FormatterItem& decimalItem()
+  {
+    static const _Formatter::FormatterItem item = {0,
+      0,
+      _Formatter::FormatterItem::WIDTH_EMPTY,
+      _Formatter::FormatterItem::WIDTH_EMPTY,
+      'd'};
+    return item;
+  }
+
+  template <typename Streambuf, typename T>
+  typename std::enable_if<_Formatter::isIntegral<T>::value>::type
+    writeValue(Formatter<Streambuf>& formatter, Streambuf&, T value)
+  {
+    formatter.printItem(decimalItem(), value);
+  }
+
+  template <typename Streambuf>
+  void writeValue(Formatter<Streambuf>& formatter, Streambuf&, bool value)
+  {
+    formatter.printItem(decimalItem(), static_cast<int>(value));
+  }
+
+  // Finite doubles only. Integral values, the most common ones for counters
+  // and gauges, go through the integer conversion, the other ones use the
+  // shortest representation that round-trips.
+  template <typename Streambuf, typename T>
+  typename std::enable_if<std::is_floating_point<T>::value>::type
+    writeValue(Formatter<Streambuf>& formatter, Streambuf& streambuf,
+        T value)
+  {
+    double d = value;
+    if (d == std::floor(d) && std::fabs(d) < 9007199254740992.0)
+    {
+      formatter.printItem(decimalItem(), static_cast<long long>(d));
+      return;
+    }
+
+    char buf[32];
+#if __cplusplus >= 201703L
+    std::size_t size = std::to_chars(buf, buf + sizeof(buf), d).ptr - buf;
+#else
+    std::size_t size = std::snprintf(buf, sizeof(buf), "%.15g", d);
+    if (std::strtod(buf, 0) != d)
+      size = std::snprintf(buf, sizeof(buf), "%.17g", d);
+#endif
+    streambuf.sputn(buf, size);
+  }
+}
+
+// Metric name and constant labels of a Prometheus series, rendered once.
+class PrometheusSeries
+{
+  public:
+    explicit PrometheusSeries(const std::string& name);
+
+    PrometheusSeries& label(const std::string& name,
+        const std::string& value);
+
+    // name, or name{label="value",... without the closing brace
+    const std::string& prefix() const;
+    bool hasLabels() const;
+
+  private:
+    std::string m_prefix;
+    bool m_hasLabels;
+};
+
+inline PrometheusSeries::PrometheusSeries(const std::string& name) :
+  m_prefix(name),
+  m_hasLabels(false)
+{
+}
+
+inline PrometheusSeries& PrometheusSeries::label(const std::string& name,
+    const std::string& value)
+{
+  m_prefix += m_hasLabels ? ',' : '{';
+  m_prefix += name;
+  m_prefix += "=\"";
+  _Formatter::StringStreambuf<std::string> sb(m_prefix);
+  _Metrics::writeEscaped(sb, value, '\\', '"', '\n');
+  m_prefix += '"';
+
+  m_hasLabels = true;
+  return *this;
+}
+
+inline const std::string& PrometheusSeries::prefix() const
+{
+  return m_prefix;
+}
+
+inline bool PrometheusSeries::hasLabels() const
+{
+  return m_hasLabels;
+}
+
+// Writes samples in the Prometheus text exposition format:
+//   name{label="value",...} value [timestamp]
+template <typename Streambuf>
+class PrometheusWriter
+{
+  public:
+    PrometheusWriter(Streambuf& streambuf);
+
+    // # TYPE name type
+    void type(const char* name, const char* type);
+
+    template <typename T>
+    void sample(const PrometheusSeries& series, T value);
+    template <typename T>
+    void sample(const PrometheusSeries& series, T value,
+        std::int64_t timestamp);
+    template <typename T>
+    void sample(const PrometheusSeries& series,
+        std::initializer_list<MetricLabel> labels, T value);
+    template <typename T>
+    void sample(const PrometheusSeries& series,
+        std::initializer_list<MetricLabel> labels, T value,
+        std::int64_t timestamp);
+
+  private:
+    Streambuf& m_streambuf;
+    Formatter<Streambuf> m_formatter;
+
+    void writeSeries(const PrometheusSeries& series,
+        std::initializer_list<MetricLabel> labels);
+    template <typename T>
+    void writeValue(T value);
+};
+
+template <typename Streambuf>
+inline PrometheusWriter<Streambuf>::PrometheusWriter(Streambuf& streambuf) :
+  m_streambuf(streambuf),
+  m_formatter(streambuf)
+{
+}
+
+template <typename Streambuf>
+inline void PrometheusWriter<Streambuf>::type(const char* name,
+    const char* type)
+{
+  m_formatter.print("# TYPE %s %s\n", name, type);
+}
+
+template <typename Streambuf>
+template <typename T>
+inline void PrometheusWriter<Streambuf>::sample(
+    const PrometheusSeries& series, T value)
+{
+  writeSeries(series, {});
+  writeValue(value);
+  m_streambuf.sputc('\n');
+}
+
+template <typename Streambuf>
+template <typename T>
+inline void PrometheusWriter<Streambuf>::sample(
+    const PrometheusSeries& series, T value, std::int64_t timestamp)
+{
+  writeSeries(series, {});
+  writeValue(value);
+  m_streambuf.sputc(' ');
+  m_formatter.printItem(_Metrics::decimalItem(), timestamp);
+  m_streambuf.sputc('\n');
+}
+
+template <typename Streambuf>
+template <typename T>
+inline void PrometheusWriter<Streambuf>::sample(
+    const PrometheusSeries& series,
+    std::initializer_list<MetricLabel> labels, T value)
+{
+  writeSeries(series, labels);
+  writeValue(value);
+  m_streambuf.sputc('\n');
+}
+
+template <typename Streambuf>
+template <typename T>
+inline void PrometheusWriter<Streambuf>::sample(
+    const PrometheusSeries& series,
+    std::initializer_list<MetricLabel> labels, T value,
+    std::int64_t timestamp)
+{
+  writeSeries(series, labels);
+  writeValue(value);
+  m_streambuf.sputc(' ');
+  m_formatter.printItem(_Metrics::decimalItem(), timestamp);
+  m_streambuf.sputc('\n');
+}
+
+template <typename Streambuf>
+void PrometheusWriter<Streambuf>::writeSeries(
+    const PrometheusSeries& series,
+    std::initializer_list<MetricLabel> labels)
+{
+  m_streambuf.sputn(series.prefix().data(), series.prefix().size());
+
+  bool first = !series.hasLabels();
+  for (auto& label : labels)
+  {
+    m_streambuf.sputc(first ? '{' : ',');
+    m_streambuf.sputn(label.name, _Formatter::length(label.name));
+    m_streambuf.sputc('=');
+    m_streambuf.sputc('"');
+    _Metrics::writeEscaped(m_streambuf, label.value, '\\', '"', '\n');
+    m_streambuf.sputc('"');
+    first = false;
+  }
+
+  if (!first)
+    m_streambuf.sputc('}');
+  m_streambuf.sputc(' ');
+}
+
+template <typename Streambuf>
+template <typename T>
+inline void PrometheusWriter<Streambuf>::writeValue(T value)
+{
+  if (std::is_floating_point<T>::value)
+  {
+    double d = value;
+    if (d != d)
+    {
+      m_streambuf.sputn("NaN", 3);
+      return;
+    }
+    if (std::isinf(d))
+    {
+      m_streambuf.sputn(d > 0 ? "+Inf" : "-Inf", 4);
+      return;
+    }
+  }
+
+  _Metrics::writeValue(m_formatter, m_streambuf, value);
+}
+
+// Measurement and tags of an InfluxDB series, rendered once.
+class InfluxSeries
+{
+  public:
+    explicit InfluxSeries(const std::string& measurement);
+
+    InfluxSeries& tag(const std::string& key, const std::string& value);
+
+    // measurement,tag=value,...
+    const std::string& prefix() const;
+
+  private:
+    std::string m_prefix;
+};
+
+inline InfluxSeries::InfluxSeries(const std::string& measurement)
+{
+  _Formatter::StringStreambuf<std::string> sb(m_prefix);
+  _Metrics::writeInfluxEscaped(sb, measurement, ',', ' ', ' ');
+}
+
+inline InfluxSeries& InfluxSeries::tag(const std::string& key,
+    const std::string& value)
+{
+  _Formatter::StringStreambuf<std::string> sb(m_prefix);
+  m_prefix += ',';
+  _Metrics::writeInfluxEscaped(sb, key, ',', '=', ' ');
+  m_prefix += '=';
+  _Metrics::writeInfluxEscaped(sb, value, ',', '=', ' ');
+  return *this;
+}
+
+inline const std::string& InfluxSeries::prefix() const
+{
+  return m_prefix;
+}
+
+// Writes points in the InfluxDB line protocol:
+//   measurement,tag=value,... field=value [timestamp]
+// Integer fields get the i suffix, or u for unsigned types, and booleans
+// are written as true or false. The line protocol has no representation
+// for NaN and infinities, such points are not written and sample returns
+// false. It has no escape for new lines either, they are dropped from the
+// measurement, the tags and the field names.
+template <typename Streambuf>
+class InfluxWriter
+{
+  public:
+    InfluxWriter(Streambuf& streambuf);
+
+    template <typename T>
+    bool sample(const InfluxSeries& series, const char* field, T value);
+    template <typename T>
+    bool sample(const InfluxSeries& series, const char* field, T value,
+        std::int64_t timestamp);
+
+  private:
+    Streambuf& m_streambuf;
+    Formatter<Streambuf> m_formatter;
+
+    template <typename T>
+    bool writePoint(const InfluxSeries& series, const char* field, T value);
+    template <typename T>
+    void writeValue(T value);
+    void writeValue(bool value);
+};
+
+template <typename Streambuf>
+inline InfluxWriter<Streambuf>::InfluxWriter(Streambuf& streambuf) :
+  m_streambuf(streambuf),
+  m_formatter(streambuf)
+{
+}
+
+template <typename Streambuf>
+template <typename T>
+inline bool InfluxWriter<Streambuf>::sample(const InfluxSeries& series,
+    const char* field, T value)
+{
+  if (!writePoint(series, field, value))
+    return false;
+  m_streambuf.sputc('\n');
+  return true;
+}
+
+template <typename Streambuf>
+template <typename T>
+inline bool InfluxWriter<Streambuf>::sample(const InfluxSeries& series,
+    const char* field, T value, std::int64_t timestamp)
+{
+  if (!writePoint(series, field, value))
+    return false;
+  m_streambuf.sputc(' ');
+  m_formatter.printItem(_Metrics::decimalItem(), timestamp);
+  m_streambuf.sputc('\n');
+  return true;
+}
+
+template <typename Streambuf>
+template <typename T>
+bool InfluxWriter<Streambuf>::writePoint(const InfluxSeries& series,
+    const char* field, T value)
+{
+  if (std::is_floating_point<T>::value && !std::isfinite(value))
+    return false;
+
+  m_streambuf.sputn(series.prefix().data(), series.prefix().size());
+  m_streambuf.sputc(' ');
+  _Metrics::writeInfluxEscaped(m_streambuf, field, ',', '=', ' ');
+  m_streambuf.sputc('=');
+  writeValue(value);
+  return true;
+}
+
+template <typename Streambuf>
+template <typename T>
+inline void InfluxWriter<Streambuf>::writeValue(T value)
+{
+  _Metrics::writeValue(m_formatter, m_streambuf, value);
+
+  if (_Formatter::isIntegral<T>::value)
+    m_streambuf.sputc(std::is_signed<T>::value ? 'i' : 'u');
+}
+
+template <typename Streambuf>
+inline void InfluxWriter<Streambuf>::writeValue(bool value)
+{
+  if (value)
+    m_streambuf.sputn("true", 4);
+  else
+    m_streambuf.sputn("false", 5);
+}
+
+}
+
+#endif
+// vim: ts=2:sw=2:sts=2:expandtab
@@ -0,0 +1,234 @@
+// Copyright (c) 2013, Philippe Daouadi <p.daouadi@free.fr>
+// All rights reserved.
+//
+// This file is distributed under the same license as pnt.hpp, see the
+// COPYING file.
+
+#ifndef PNT_PERCPU_HPP
+#define PNT_PERCPU_HPP
+
+#include <pnt/core.hpp>
+#include <pnt/buffer.hpp>
+
+#include <cstdlib>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <thread>
+
+#include <unistd.h>
+
+#if defined(__linux__)
+#include <sched.h>
+#endif
+
+#if defined(__linux__) && defined(__GLIBC__) && \
+  (__GLIBC__ > 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ >= 35)) && \
+  (defined(__clang__) || __GNUC__ >= 11)
+#include <sys/rseq.h>
+#define PNT_HAS_RSEQ 1
+#endif
+
+// Log buffers shared by the threads running on the same CPU.
+//
+// With thousands of threads, one buffer per thread wastes memory, one per
+// CPU scales with the machine instead. Each record is formatted into the
+// buffer of the CPU the thread runs on, and an aggregator drains them all:
+//
+//   pnt::PerCpuSink sink;
+//
+//   // any thread
+//   sink.print("%s %d\n", name, value);
+//
+//   // aggregator thread
+//   sink.drain([&](const char* data, std::size_t size)
+//       {
+//         ::write(fd, data, size);
+//       });
+//
+// The CPU is read from the rseq area glibc registers for each thread, or
+// from sched_getcpu. A thread can be preempted, or moved to another CPU,
+// in the middle of a record, so each buffer still has a lock, which is
+// contended only in these cases: a restartable sequence cannot span the
+// formatting of a record.
+
+namespace pnt
+{
+
+namespace _PerCpu
+{
+  inline unsigned int currentCpu()
+  {
+#ifdef PNT_HAS_RSEQ
+    // kept up to date by the kernel on each return to user space
+    if (__rseq_size)
+    {
+      const volatile struct rseq* area =
+        reinterpret_cast<const volatile struct rseq*>(
+            static_cast<char*>(__builtin_thread_pointer()) + __rseq_offset);
+      int cpu = static_cast<int>(area->cpu_id);
+      if (cpu >= 0)
+        return cpu;
+    }
+#endif
+
+#if defined(__linux__)
+    int cpu = ::sched_getcpu();
+    if (cpu >= 0)
+      return cpu;
+#endif
+
+    // spreads the threads over the buffers
+    return static_cast<unsigned int>(
+        std::hash<std::thread::id>()(std::this_thread::get_id()));
+  }
+
+  inline unsigned int cpuCount()
+  {
+    long count = ::sysconf(_SC_NPROCESSORS_CONF);
+    return count > 0 ? count : 1;
+  }
+
+  // Drops the part of a record already written to a buffer shared with
+  // other records when formatting it throws, so that the next drain does
+  // not glue it to the following record.
+  class RecordGuard
+  {
+    public:
+      RecordGuard(Buffer& buffer) :
+        m_buffer(buffer),
+        m_size(buffer.size()),
+        m_done(false)
+      {}
+
+      ~RecordGuard()
+      {
+        if (!m_done)
+          m_buffer.truncate(m_size);
+      }
+
+      RecordGuard(const RecordGuard&) = delete;
+      RecordGuard& operator=(const RecordGuard&) = delete;
+
+      void done()
+      {
+        m_done = true;
+      }
+
+    private:
+      Buffer& m_buffer;
+      std::size_t m_size;
+      bool m_done;
+  };
+}
+
+class PerCpuSink
+{
+  public:
+    // cpus is the number of buffers, the number of configured CPUs by
+    // default. Each buffer starts with bufferSize bytes and grows as needed
+    // until it is drained.
+    explicit PerCpuSink(std::size_t bufferSize = 64 * 1024,
+        unsigned int cpus = 0);
+
+    PerCpuSink(const PerCpuSink&) = delete;
+    PerCpuSink& operator=(const PerCpuSink&) = delete;
+
+    // formats a record into the buffer of the current CPU
+    template <typename... Args>
+    void print(const char* format, const Args&... args);
+
+    // calls consumer(data, size) with the content of each non empty
+    // buffer, and returns the number of bytes drained. The buffers are
+    // swapped with spare ones under their lock, records keep going to them
+    // while the consumer runs. Drains must not run concurrently.
+    template <typename Consumer>
+    std::size_t drain(Consumer consumer);
+
+    unsigned int cpuCount() const;
+
+  private:
+    // allocated separately, and aligned on a cache line, which also pads
+    // them to a multiple of its size, to keep the slots of different CPUs
+    // on different cache lines
+    struct alignas(64) Slot
+    {
+      explicit Slot(std::size_t bufferSize) :
+        buffer(new Buffer(bufferSize)),
+        spare(new Buffer(bufferSize))
+      {}
+
+      // new only honors extended alignments from C++17
+      static void* operator new(std::size_t size)
+      {
+        void* slot;
+        if (::posix_memalign(&slot, alignof(Slot), size))
+          throw std::bad_alloc();
+        return slot;
+      }
+
+      static void operator delete(void* slot)
+      {
+        std::free(slot);
+      }
+
+      std::mutex mutex;
+      std::unique_ptr<Buffer> buffer;
+      // only touched by drain
+      std::unique_ptr<Buffer> spare;
+    };
+
+    std::unique_ptr<std::unique_ptr<Slot>[]> m_slots;
+    unsigned int m_cpuCount;
+};
+
+inline PerCpuSink::PerCpuSink(std::size_t bufferSize, unsigned int cpus) :
+  m_cpuCount(cpus ? cpus : _PerCpu::cpuCount())
+{
+  m_slots.reset(new std::unique_ptr<Slot>[m_cpuCount]);
+  for (unsigned int i = 0; i < m_cpuCount; ++i)
+    m_slots[i].reset(new Slot(bufferSize));
+}
+
+template <typename... Args>
+inline void PerCpuSink::print(const char* format, const Args&... args)
+{
+  Slot& slot = *m_slots[_PerCpu::currentCpu() % m_cpuCount];
+  std::lock_guard<std::mutex> lock(slot.mutex);
+  _PerCpu::RecordGuard guard(*slot.buffer);
+  Formatter<Buffer> formatter(*slot.buffer);
+  formatter.print(format, args...);
+  guard.done();
+}
+
+template <typename Consumer>
+inline std::size_t PerCpuSink::drain(Consumer consumer)
+{
+  std::size_t drained = 0;
+  for (unsigned int i = 0; i < m_cpuCount; ++i)
+  {
+    Slot& slot = *m_slots[i];
+    {
+      std::lock_guard<std::mutex> lock(slot.mutex);
+      if (!slot.buffer->size())
+        continue;
+      slot.buffer.swap(slot.spare);
+    }
+
+    consumer(slot.spare->data(), slot.spare->size());
+    drained += slot.spare->size();
+    slot.spare->clear();
+  }
+  return drained;
+}
+
+inline unsigned int PerCpuSink::cpuCount() const
+{
+  return m_cpuCount;
+}
+
+}
+
+#endif
+// vim: ts=2:sw=2:sts=2:expandtab
@@ -0,0 +1,271 @@
+// Copyright (c) 2013, Philippe Daouadi <p.daouadi@free.fr>
+// All rights reserved.
+//
+// This file is distributed under the same license as pnt.hpp, see the
+// COPYING file.
+
+#ifndef PNT_PIPE_HPP
+#define PNT_PIPE_HPP
+
+#include <pnt/core.hpp>
+
+#include <cerrno>
+#include <cstring>
+#include <new>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#if defined(__linux__) && defined(SPLICE_F_GIFT)
+#define PNT_HAS_VMSPLICE 1
+#endif
+
+// Sink for a pipe, typically read by a sidecar process, which gives its
+// pages to the pipe instead of copying them.
+//
+// Output is formatted into page aligned buffers. Each full buffer is handed
+// to the pipe with vmsplice(SPLICE_F_GIFT), and the sink moves on to the
+// next buffer of a pool large enough for the pipe to be unable to hold any
+// page of a buffer by the time the sink comes back to it: a pipe holds at
+// most F_GETPIPE_SZ / page size pages, and the pool has one more buffer
+// than needed to cover them. The capacity is read when the sink is created,
+// it must not be enlarged afterwards. The reader must read() the pipe,
+// splicing the pages further would keep references to them.
+//
+// flush() writes the partial buffer with write(), which copies it, so that
+// the buffer can be filled again right away. When the descriptor is not a
+// pipe, or vmsplice is not available, full buffers are written with write()
+// as well.
+//
+//   pnt::PipeSink sink(fd);
+//   pnt::writef(sink, "%s %d\n", name, value);
+//   ...
+//   sink.flush();
+
+namespace pnt
+{
+
+class PipeSink
+{
+  public:
+    typedef char char_type;
+    typedef std::char_traits<char> traits_type;
+    typedef traits_type::int_type int_type;
+
+    // bufferSize is rounded up to a multiple of the page size
+    explicit PipeSink(int fd, std::size_t bufferSize = 64 * 1024);
+    ~PipeSink();
+
+    PipeSink(const PipeSink&) = delete;
+    PipeSink& operator=(const PipeSink&) = delete;
+
+    int_type sputc(char_type c);
+    std::streamsize sputn(const char_type* s, std::streamsize count);
+
+    // writes the pending output. Returns false, and drops it, when the pipe
+    // failed, error() tells why.
+    bool flush();
+
+    // errno of the last failure, 0 if none
+    int error() const;
+    // whether full buffers are given to the pipe with vmsplice
+    bool splicing() const;
+    std::size_t bufferSize() const;
+    std::size_t bufferCount() const;
+
+  private:
+    int m_fd;
+    std::size_t m_bufferSize;
+    std::size_t m_bufferCount;
+    char* m_pool;
+    std::size_t m_current;
+    char* m_ptr;
+    char* m_end;
+    bool m_splice;
+    int m_error;
+
+    char* buffer(std::size_t index);
+    void handOff();
+    bool spliceBuffer(char* data, std::size_t size);
+    bool writeData(const char* data, std::size_t size);
+};
+
+inline PipeSink::PipeSink(int fd, std::size_t bufferSize) :
+  m_fd(fd),
+  m_bufferCount(1),
+  m_pool(nullptr),
+  m_current(0),
+  m_splice(false),
+  m_error(0)
+{
+  std::size_t pageSize = ::sysconf(_SC_PAGESIZE);
+  if (bufferSize < pageSize)
+    bufferSize = pageSize;
+  m_bufferSize = (bufferSize + pageSize - 1) / pageSize * pageSize;
+
+#ifdef PNT_HAS_VMSPLICE
+  struct stat status;
+  if (::fstat(fd, &status) == 0 && S_ISFIFO(status.st_mode))
+  {
+    int pipeSize = ::fcntl(fd, F_GETPIPE_SZ);
+    std::size_t pipePages = pipeSize > 0 ? pipeSize / pageSize : 16;
+    std::size_t bufferPages = m_bufferSize / pageSize;
+    m_bufferCount = (pipePages + bufferPages - 1) / bufferPages + 1;
+    m_splice = true;
+  }
+#endif
+
+  void* pool = ::mmap(nullptr, m_bufferSize * m_bufferCount,
+      PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (pool == MAP_FAILED)
+    throw std::bad_alloc();
+  m_pool = static_cast<char*>(pool);
+
+  m_ptr = m_pool;
+  m_end = m_pool + m_bufferSize;
+}
+
+inline PipeSink::~PipeSink()
+{
+  flush();
+  ::munmap(m_pool, m_bufferSize * m_bufferCount);
+}
+
+inline PipeSink::int_type PipeSink::sputc(char_type c)
+{
+  if (m_ptr == m_end)
+    handOff();
+  *m_ptr++ = c;
+  return traits_type::to_int_type(c);
+}
+
+inline std::streamsize PipeSink::sputn(const char_type* s,
+    std::streamsize count)
+{
+  std::size_t left = count;
+  while (left)
+  {
+    if (m_ptr == m_end)
+      handOff();
+
+    std::size_t size = m_end - m_ptr;
+    if (size > left)
+      size = left;
+    std::memcpy(m_ptr, s, size);
+    m_ptr += size;
+    s += size;
+    left -= size;
+  }
+  return count;
+}
+
+inline bool PipeSink::flush()
+{
+  char* start = buffer(m_current);
+  bool written = writeData(start, m_ptr - start);
+  m_ptr = start;
+  return written;
+}
+
+inline int PipeSink::error() const
+{
+  return m_error;
+}
+
+inline bool PipeSink::splicing() const
+{
+  return m_splice;
+}
+
+inline std::size_t PipeSink::bufferSize() const
+{
+  return m_bufferSize;
+}
+
+inline std::size_t PipeSink::bufferCount() const
+{
+  return m_bufferCount;
+}
+
+inline char* PipeSink::buffer(std::size_t index)
+{
+  return m_pool + index * m_bufferSize;
+}
+
+inline void PipeSink::handOff()
+{
+  char* start = buffer(m_current);
+
+  if (!m_splice)
+  {
+    writeData(start, m_bufferSize);
+    m_ptr = start;
+    return;
+  }
+
+  spliceBuffer(start, m_bufferSize);
+
+  // the pages given to the pipe are left alone until the whole pool has
+  // been used
+  m_current = (m_current + 1) % m_bufferCount;
+  m_ptr = buffer(m_current);
+  m_end = m_ptr + m_bufferSize;
+}
+
+inline bool PipeSink::spliceBuffer(char* data, std::size_t size)
+{
+#ifdef PNT_HAS_VMSPLICE
+  while (size)
+  {
+    iovec iov;
+    iov.iov_base = data;
+    iov.iov_len = size;
+
+    ssize_t result = ::vmsplice(m_fd, &iov, 1, SPLICE_F_GIFT);
+    if (result < 0)
+    {
+      if (errno == EINTR)
+        continue;
+      // from now on, and for this buffer, the pipe gets copies
+      if (errno == EINVAL || errno == ENOSYS || errno == EBADF)
+      {
+        m_splice = false;
+        return writeData(data, size);
+      }
+      m_error = errno;
+      return false;
+    }
+    data += result;
+    size -= result;
+  }
+  return true;
+#else
+  return writeData(data, size);
+#endif
+}
+
+inline bool PipeSink::writeData(const char* data, std::size_t size)
+{
+  while (size)
+  {
+    ssize_t result = ::write(m_fd, data, size);
+    if (result < 0)
+    {
+      if (errno == EINTR)
+        continue;
+      m_error = errno;
+      return false;
+    }
+    data += result;
+    size -= result;
+  }
+  return true;
+}
+
+}
+
+#endif
+// vim: ts=2:sw=2:sts=2:expandtab
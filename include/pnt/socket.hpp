@@ -0,0 +1,350 @@
+// Copyright (c) 2013, Philippe Daouadi <p.daouadi@free.fr>
+// All rights reserved.
+//
+// This file is distributed under the same license as pnt.hpp, see the
+// COPYING file.
+
+#ifndef PNT_SOCKET_HPP
+#define PNT_SOCKET_HPP
+
+#include <pnt/core.hpp>
+
+#include <chrono>
+#include <cerrno>
+#include <cstring>
+#include <vector>
+
+#include <sys/socket.h>
+#include <sys/types.h>
+#include <sys/uio.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#if defined(__linux__) && defined(MSG_WAITFORONE)
+#define PNT_HAS_SENDMMSG 1
+#endif
+
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL 0
+#endif
+
+// Batched sink for a local socket, typically a Unix domain socket to a
+// syslog daemon or a log collector.
+//
+// Records are formatted into a buffer, endRecord() marks the end of each of
+// them, and they are sent together once enough of them are pending or the
+// oldest one has waited long enough:
+//
+//   pnt::SocketSink sink(pnt::connectUnix("/run/collector.sock", SOCK_DGRAM),
+//       pnt::SocketSink::Datagram);
+//   sink.record("%s %d\n", name, value);
+//   ...
+//   sink.flush();
+//
+// On a datagram socket, each record is sent as its own datagram, all of the
+// batch with a single sendmmsg call on Linux. On a stream socket, the batch
+// is written with as few send calls as the socket accepts.
+//
+// There is no timer: maxDelay is only checked by endRecord() and poll(). A
+// batch whose records stop coming waits until the next record, poll() or
+// flush(), so a thread which may stop logging must call poll() from time to
+// time.
+
+namespace pnt
+{
+
+// Socket of the given type connected to the Unix domain socket at path, or
+// -1 with errno set.
+inline int connectUnix(const char* path, int type = SOCK_DGRAM)
+{
+  sockaddr_un address;
+  std::size_t length = std::strlen(path);
+  if (length >= sizeof(address.sun_path))
+  {
+    errno = ENAMETOOLONG;
+    return -1;
+  }
+
+  std::memset(&address, 0, sizeof(address));
+  address.sun_family = AF_UNIX;
+  std::memcpy(address.sun_path, path, length);
+
+  int fd = ::socket(AF_UNIX, type, 0);
+  if (fd < 0)
+    return -1;
+
+  if (::connect(fd, reinterpret_cast<sockaddr*>(&address),
+        sizeof(address)) < 0)
+  {
+    int error = errno;
+    ::close(fd);
+    errno = error;
+    return -1;
+  }
+
+  return fd;
+}
+
+class SocketSink
+{
+  public:
+    typedef char char_type;
+    typedef std::char_traits<char> traits_type;
+    typedef traits_type::int_type int_type;
+
+    enum Mode
+    {
+      Datagram,
+      Stream,
+    };
+
+    struct Options
+    {
+      Options() :
+        maxRecords(64),
+        maxBytes(64 * 1024),
+        maxDelay(std::chrono::milliseconds(10))
+      {}
+
+      // the batch is sent once it has maxRecords records, or maxBytes
+      // bytes...
+      std::size_t maxRecords;
+      std::size_t maxBytes;
+      // ...or when a record ends maxDelay after the first one of the batch
+      std::chrono::steady_clock::duration maxDelay;
+    };
+
+    // the socket is not closed by the sink
+    SocketSink(int fd, Mode mode, const Options& options = Options());
+    ~SocketSink();
+
+    SocketSink(const SocketSink&) = delete;
+    SocketSink& operator=(const SocketSink&) = delete;
+
+    int_type sputc(char_type c);
+    std::streamsize sputn(const char_type* s, std::streamsize count);
+
+    // ends the current record, and sends the batch if it is due
+    void endRecord();
+    // writef followed by endRecord
+    template <typename... Args>
+    void record(const char_type* format, const Args&... args);
+
+    // sends the batch if its oldest record is older than maxDelay, to be
+    // called from time to time when records may stop coming
+    void poll();
+    // sends the pending records. Returns false, and drops them, when the
+    // socket failed, error() tells why.
+    bool flush();
+
+    // errno of the last failure, 0 if none
+    int error() const;
+    std::size_t pendingRecords() const;
+    std::size_t pendingBytes() const;
+
+  private:
+    int m_fd;
+    Mode m_mode;
+    Options m_options;
+    std::vector<char> m_data;
+    // end offset of each record in m_data
+    std::vector<std::size_t> m_ends;
+    std::size_t m_recordStart;
+    std::chrono::steady_clock::time_point m_batchStart;
+    int m_error;
+    // messages of the batch, sized to maxRecords, not reallocated per batch
+    std::vector<iovec> m_iov;
+#ifdef PNT_HAS_SENDMMSG
+    std::vector<mmsghdr> m_messages;
+#endif
+
+    bool sendDatagrams();
+    bool sendStream();
+};
+
+inline SocketSink::SocketSink(int fd, Mode mode, const Options& options) :
+  m_fd(fd),
+  m_mode(mode),
+  m_options(options),
+  m_recordStart(0),
+  m_error(0)
+{
+  m_data.reserve(m_options.maxBytes);
+  m_ends.reserve(m_options.maxRecords);
+  if (m_mode == Datagram)
+  {
+    m_iov.resize(m_options.maxRecords);
+#ifdef PNT_HAS_SENDMMSG
+    m_messages.resize(m_options.maxRecords);
+#endif
+  }
+}
+
+inline SocketSink::~SocketSink()
+{
+  endRecord();
+  flush();
+}
+
+inline SocketSink::int_type SocketSink::sputc(char_type c)
+{
+  m_data.push_back(c);
+  return traits_type::to_int_type(c);
+}
+
+inline std::streamsize SocketSink::sputn(const char_type* s,
+    std::streamsize count)
+{
+  m_data.insert(m_data.end(), s, s + count);
+  return count;
+}
+
+inline void SocketSink::endRecord()
+{
+  // an empty record would be an empty datagram
+  if (m_data.size() == m_recordStart)
+    return;
+
+  std::chrono::steady_clock::time_point now =
+    std::chrono::steady_clock::now();
+  if (m_ends.empty())
+    m_batchStart = now;
+
+  m_ends.push_back(m_data.size());
+  m_recordStart = m_data.size();
+
+  if (m_ends.size() >= m_options.maxRecords ||
+      m_data.size() >= m_options.maxBytes ||
+      now - m_batchStart >= m_options.maxDelay)
+    flush();
+}
+
+template <typename... Args>
+inline void SocketSink::record(const char_type* format, const Args&... args)
+{
+  writef(*this, format, args...);
+  endRecord();
+}
+
+inline void SocketSink::poll()
+{
+  if (!m_ends.empty() &&
+      std::chrono::steady_clock::now() - m_batchStart >= m_options.maxDelay)
+    flush();
+}
+
+inline bool SocketSink::flush()
+{
+  if (m_ends.empty())
+    return true;
+
+  bool sent = m_mode == Datagram ? sendDatagrams() : sendStream();
+
+  // keeps the record being formatted, if any
+  std::size_t sentBytes = m_ends.back();
+  m_data.erase(m_data.begin(), m_data.begin() + sentBytes);
+  m_ends.clear();
+  m_recordStart = 0;
+
+  return sent;
+}
+
+inline int SocketSink::error() const
+{
+  return m_error;
+}
+
+inline std::size_t SocketSink::pendingRecords() const
+{
+  return m_ends.size();
+}
+
+inline std::size_t SocketSink::pendingBytes() const
+{
+  return m_ends.empty() ? 0 : m_ends.back();
+}
+
+inline bool SocketSink::sendDatagrams()
+{
+  // a batch has at most maxRecords records, but at least one
+  std::size_t count = m_ends.size();
+  if (m_iov.size() < count)
+    m_iov.resize(count);
+
+  std::size_t start = 0;
+  for (std::size_t i = 0; i < count; ++i)
+  {
+    m_iov[i].iov_base = &m_data[start];
+    m_iov[i].iov_len = m_ends[i] - start;
+    start = m_ends[i];
+  }
+
+#ifdef PNT_HAS_SENDMMSG
+  if (m_messages.size() < count)
+    m_messages.resize(count);
+  mmsghdr* messages = m_messages.data();
+  for (std::size_t i = 0; i < count; ++i)
+  {
+    std::memset(&messages[i], 0, sizeof(messages[i]));
+    messages[i].msg_hdr.msg_iov = &m_iov[i];
+    messages[i].msg_hdr.msg_iovlen = 1;
+  }
+
+  // sendmmsg stops at the first failing message
+  std::size_t sent = 0;
+  while (sent < count)
+  {
+    int result = ::sendmmsg(m_fd, &messages[sent],
+        static_cast<unsigned int>(count - sent), MSG_NOSIGNAL);
+    if (result < 0)
+    {
+      if (errno == EINTR)
+        continue;
+      m_error = errno;
+      return false;
+    }
+    sent += result;
+  }
+#else
+  for (std::size_t i = 0; i < count; ++i)
+  {
+    while (::send(m_fd, m_iov[i].iov_base, m_iov[i].iov_len,
+          MSG_NOSIGNAL) < 0)
+    {
+      if (errno == EINTR)
+        continue;
+      m_error = errno;
+      return false;
+    }
+  }
+#endif
+
+  return true;
+}
+
+inline bool SocketSink::sendStream()
+{
+  const char* data = m_data.data();
+  std::size_t size = m_ends.back();
+
+  while (size)
+  {
+    ssize_t result = ::send(m_fd, data, size, MSG_NOSIGNAL);
+    if (result < 0)
+    {
+      if (errno == EINTR)
+        continue;
+      m_error = errno;
+      return false;
+    }
+    data += result;
+    size -= result;
+  }
+
+  return true;
+}
+
+}
+
+#endif
+// vim: ts=2:sw=2:sts=2:expandtab
@@ -0,0 +1,281 @@
+// Copyright (c) 2013, Philippe Daouadi <p.daouadi@free.fr>
+// All rights reserved.
+//
+// This file is distributed under the same license as pnt.hpp, see the
+// COPYING file.
+
+#ifndef PNT_STD_HPP
+#define PNT_STD_HPP
+
+#include <pnt/core.hpp>
+
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <ratio>
+#include <system_error>
+#include <thread>
+#include <tuple>
+#include <utility>
+
+#if __cplusplus >= 201703L && defined(__has_include)
+#if __has_include(<optional>) && __has_include(<variant>)
+#include <optional>
+#include <variant>
+#define PNT_HAS_OPTIONAL_VARIANT 1
+#endif
+#endif
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <pthread.h>
+#define PNT_HAS_PTHREAD 1
+#endif
+
+// %s for standard library types, written directly to the streambuf:
+//
+//   std::pair, std::tuple      (a, b, ...)
+//   std::optional              the value, or nullopt
+//   std::variant               the active alternative
+//   std::unique_ptr,
+//   std::shared_ptr            the pointer, as %s prints a void*
+//   std::error_code,
+//   std::error_condition       category:value, e.g. generic:2
+//   std::thread::id            its pthread_t, as pthread_self() gives it
+//   std::chrono::duration      the count and its unit, e.g. 15ms
+//
+// Elements are printed as by %s without width, the width applies to the
+// whole text. optional and variant need C++17. std::thread::id needs a
+// standard library whose ids are a pthread_t, as libstdc++ and libc++ on
+// POSIX systems, it is not printable otherwise.
+
+namespace pnt
+{
+
+namespace _Formatter
+{
+  template <typename A, typename B>
+  struct Printer<std::pair<A, B>>
+  {
+    static const bool printable = true;
+
+    template <typename Formatter>
+    static void print(Formatter& formatter, const std::pair<A, B>& arg)
+    {
+      writeAscii(formatter.streambuf(), "(");
+      formatter.printItem(stringItem(), arg.first);
+      writeAscii(formatter.streambuf(), ", ");
+      formatter.printItem(stringItem(), arg.second);
+      writeAscii(formatter.streambuf(), ")");
+    }
+  };
+
+  template <std::size_t Index, std::size_t Size>
+  struct TupleElements
+  {
+    template <typename Formatter, typename Tuple>
+    static void print(Formatter& formatter, const Tuple& arg)
+    {
+      if (Index)
+        writeAscii(formatter.streambuf(), ", ");
+      formatter.printItem(stringItem(), std::get<Index>(arg));
+      TupleElements<Index + 1, Size>::print(formatter, arg);
+    }
+  };
+
+  template <std::size_t Size>
+  struct TupleElements<Size, Size>
+  {
+    template <typename Formatter, typename Tuple>
+    static void print(Formatter&, const Tuple&)
+    {
+    }
+  };
+
+  template <typename... Types>
+  struct Printer<std::tuple<Types...>>
+  {
+    static const bool printable = true;
+
+    template <typename Formatter>
+    static void print(Formatter& formatter, const std::tuple<Types...>& arg)
+    {
+      writeAscii(formatter.streambuf(), "(");
+      TupleElements<0, sizeof...(Types)>::print(formatter, arg);
+      writeAscii(formatter.streambuf(), ")");
+    }
+  };
+
+  template <typename T, typename Deleter>
+  struct Printer<std::unique_ptr<T, Deleter>>
+  {
+    static const bool printable = true;
+
+    template <typename Formatter>
+    static void print(Formatter& formatter,
+        const std::unique_ptr<T, Deleter>& arg)
+    {
+      formatter.printItem(stringItem(), static_cast<const void*>(arg.get()));
+    }
+  };
+
+  template <typename T>
+  struct Printer<std::shared_ptr<T>>
+  {
+    static const bool printable = true;
+
+    template <typename Formatter>
+    static void print(Formatter& formatter, const std::shared_ptr<T>& arg)
+    {
+      formatter.printItem(stringItem(), static_cast<const void*>(arg.get()));
+    }
+  };
+
+  // message() would allocate a string, the category and the value identify
+  // the error as well
+  template <typename T>
+  struct Printer<T, typename std::enable_if<
+      std::is_same<T, std::error_code>::value ||
+      std::is_same<T, std::error_condition>::value>::type>
+  {
+    static const bool printable = true;
+
+    template <typename Formatter>
+    static void print(Formatter& formatter, const T& arg)
+    {
+      writeAscii(formatter.streambuf(), arg.category().name());
+      writeAscii(formatter.streambuf(), ":");
+      formatter.printItem(stringItem(), arg.value());
+    }
+  };
+
+#ifdef PNT_HAS_PTHREAD
+  // The id holds the pthread_t of the thread, 0 for no thread, which is
+  // printed as an integer, the number std::ostream prints for the id.
+  template <typename T>
+  struct Printer<T, typename std::enable_if<
+      std::is_same<T, std::thread::id>::value &&
+      sizeof(T) == sizeof(pthread_t) &&
+      sizeof(pthread_t) <= sizeof(std::uintptr_t)>::type>
+  {
+    static const bool printable = true;
+
+    template <typename Formatter>
+    static void print(Formatter& formatter, const T& arg)
+    {
+      pthread_t thread;
+      std::memcpy(&thread, &arg, sizeof(thread));
+      formatter.printItem(stringItem(), toInteger(thread));
+    }
+
+    // pthread_t is an integer on Linux, a pointer on BSDs and macOS
+    template <typename U>
+    static typename std::enable_if<std::is_integral<U>::value, U>::type
+      toInteger(U thread)
+    {
+      return thread;
+    }
+
+    template <typename U>
+    static std::uintptr_t toInteger(U* thread)
+    {
+      return reinterpret_cast<std::uintptr_t>(thread);
+    }
+  };
+#endif
+
+  template <typename Period>
+  struct DurationUnit
+  {
+    template <typename Streambuf>
+    static void print(Streambuf& streambuf)
+    {
+      Formatter<Streambuf> formatter(streambuf);
+      writeAscii(streambuf, "[");
+      formatter.printItem(stringItem(), Period::num);
+      if (Period::den != 1)
+      {
+        writeAscii(streambuf, "/");
+        formatter.printItem(stringItem(), Period::den);
+      }
+      writeAscii(streambuf, "]s");
+    }
+  };
+
+#define PNT_DURATION_UNIT(period, unit) \
+  template <> \
+  struct DurationUnit<period> \
+  { \
+    template <typename Streambuf> \
+    static void print(Streambuf& streambuf) \
+    { \
+      writeAscii(streambuf, unit); \
+    } \
+  };
+
+  PNT_DURATION_UNIT(std::nano, "ns")
+  PNT_DURATION_UNIT(std::micro, "us")
+  PNT_DURATION_UNIT(std::milli, "ms")
+  PNT_DURATION_UNIT(std::ratio<1>, "s")
+  PNT_DURATION_UNIT(std::ratio<60>, "min")
+  PNT_DURATION_UNIT(std::ratio<3600>, "h")
+  PNT_DURATION_UNIT(std::ratio<86400>, "d")
+
+#undef PNT_DURATION_UNIT
+
+  template <typename Rep, typename Period>
+  struct Printer<std::chrono::duration<Rep, Period>>
+  {
+    static const bool printable = true;
+
+    template <typename Formatter>
+    static void print(Formatter& formatter,
+        const std::chrono::duration<Rep, Period>& arg)
+    {
+      formatter.printItem(stringItem(), arg.count());
+      DurationUnit<typename Period::type>::print(formatter.streambuf());
+    }
+  };
+
+#ifdef PNT_HAS_OPTIONAL_VARIANT
+  template <typename T>
+  struct Printer<std::optional<T>>
+  {
+    static const bool printable = true;
+
+    template <typename Formatter>
+    static void print(Formatter& formatter, const std::optional<T>& arg)
+    {
+      if (arg)
+        formatter.printItem(stringItem(), *arg);
+      else
+        writeAscii(formatter.streambuf(), "nullopt");
+    }
+  };
+
+  template <typename... Types>
+  struct Printer<std::variant<Types...>>
+  {
+    static const bool printable = true;
+
+    template <typename Formatter>
+    static void print(Formatter& formatter,
+        const std::variant<Types...>& arg)
+    {
+      if (arg.valueless_by_exception())
+        writeAscii(formatter.streambuf(), "valueless");
+      else
+        std::visit([&](const auto& value)
+            {
+              formatter.printItem(stringItem(), value);
+            }, arg);
+    }
+  };
+#endif
+}
+
+}
+
+#endif
+// vim: ts=2:sw=2:sts=2:expandtab
@@ -0,0 +1,728 @@
+// Copyright (c) 2013, Philippe Daouadi <p.daouadi@free.fr>
+// All rights reserved.
+//
+// This file is distributed under the same license as pnt.hpp, see the
+// COPYING file.
+
+#ifndef PNT_TEMPLATE_HPP
+#define PNT_TEMPLATE_HPP
+
+#include <pnt/core.hpp>
+
+#include <cstring>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+// Text templates with named fields, sections repeated over lists and
+// conditionals, compiled once and rendered through a Formatter:
+//
+//   pnt::Template report(
+//       "Report {{title}}\n"
+//       "{{#each rows}}\n"
+//       "{{@index:%3d}}. {{name:%-12s}} {{count:%8d}}\n"
+//       "{{/each}}\n"
+//       "{{#if truncated}}\n"
+//       "...\n"
+//       "{{/if}}\n");
+//
+//   std::vector<pnt::TemplateData> rows;
+//   rows.emplace_back(report);
+//   rows.back().set("name", "disk").set("count", 42);
+//
+//   pnt::TemplateData data(report);
+//   data.set("title", "Q3").set("rows", rows).set("truncated", false);
+//   report.render(streambuf, data);
+//
+// Tags are:
+//   {{name}}                 the field, as with %s
+//   {{name:%-8d}}            the field with a pnt format item
+//   {{#each name}}...{{/each}}     the section once per item of a list
+//   {{#if name}}...{{else}}...{{/if}}, {{#unless name}}...{{/unless}}
+//                            false, 0, empty strings and lists, and unset
+//                            fields are false
+//   {{@index}}, {{@first}}, {{@last}}  position in the innermost list
+//   {{! comment}}
+//
+// Inside a section, a field which is not set in the item is looked up in
+// the enclosing items, then in the data given to render. Section and
+// comment tags alone on their line do not leave an empty line.
+//
+// The template is parsed once: rendering runs a program of literal spans
+// and fields with their parsed FormatterItem, and looks the fields up by
+// index. Syntax errors are reported by FORMAT_ERROR(InvalidFormatter), and
+// a template which failed to compile renders nothing. Strings and lists
+// given to TemplateData are referenced, not copied.
+
+namespace pnt
+{
+
+class Template;
+class TemplateData;
+
+// A field value: nothing, a boolean, an integer, a string or a list of
+// items.
+class TemplateValue
+{
+  public:
+    enum Type
+    {
+      Null,
+      Bool,
+      Int,
+      UInt,
+      String,
+      List
+    };
+
+    TemplateValue();
+    TemplateValue(bool value);
+    template <typename T>
+    TemplateValue(T value,
+        typename std::enable_if<std::is_integral<T>::value &&
+          !std::is_same<T, bool>::value>::type* = 0);
+    TemplateValue(const char* value);
+    TemplateValue(const char* value, std::size_t size);
+    TemplateValue(const std::string& value);
+    TemplateValue(const TemplateData* items, std::size_t count);
+    TemplateValue(const std::vector<TemplateData>& items);
+
+    Type type() const;
+    // false for null, false, 0 and empty strings and lists
+    bool truthy() const;
+
+  private:
+    friend class Template;
+
+    Type m_type;
+    union
+    {
+      bool m_bool;
+      long long m_int;
+      unsigned long long m_uint;
+      const char* m_data;
+      const TemplateData* m_items;
+    };
+    std::size_t m_size;
+};
+
+// The values of the fields of a template, for one render or one item of a
+// list.
+class TemplateData
+{
+  public:
+    explicit TemplateData(const Template& tpl);
+
+    // unknown names are ignored, the template does not use them
+    TemplateData& set(const char* name, const TemplateValue& value);
+    TemplateData& set(unsigned int field, const TemplateValue& value);
+
+    const TemplateValue& get(unsigned int field) const;
+    std::size_t size() const;
+
+    void clear();
+
+  private:
+    const Template* m_template;
+    std::vector<TemplateValue> m_values;
+};
+
+namespace _Template
+{
+  // arguments printed with %s by their Printer
+  struct StringRef
+  {
+    const char* data;
+    std::size_t size;
+  };
+
+  // the fields of the innermost lists
+  const unsigned int FIELD_INDEX = -1;
+  const unsigned int FIELD_FIRST = -2;
+  const unsigned int FIELD_LAST = -3;
+  // an unknown @ name
+  const unsigned int FIELD_INVALID = -4;
+
+  struct Op
+  {
+    enum Code
+    {
+      Literal,
+      Field,
+      Each,
+      If,
+      Unless,
+      Else,
+      End
+    };
+
+    Code code;
+    unsigned int field;
+    // Literal: span of the text, sections: indices of the Else, if any,
+    // and of the End ops
+    std::size_t begin;
+    std::size_t size;
+    std::size_t elseOp;
+    std::size_t endOp;
+    _Formatter::FormatterItem item;
+  };
+
+  // a list being rendered, and the enclosing ones
+  struct Scope
+  {
+    const TemplateData* data;
+    std::size_t index;
+    std::size_t count;
+    const Scope* parent;
+  };
+
+  inline bool isBlank(char c)
+  {
+    return c == ' ' || c == '\t';
+  }
+}
+
+namespace _Formatter
+{
+  template <>
+  struct Printer<_Template::StringRef>
+  {
+    static const bool printable = true;
+
+    template <typename Formatter>
+    static void print(Formatter& formatter, const _Template::StringRef& str)
+    {
+      formatter.streambuf().sputn(str.data, str.size);
+    }
+  };
+}
+
+class Template
+{
+  public:
+    explicit Template(const char* text);
+    explicit Template(const std::string& text);
+
+    // index of a field, for TemplateData::set, or -1 if the template does
+    // not use it
+    unsigned int field(const char* name) const;
+    std::size_t fieldCount() const;
+    // false if the template has a syntax error
+    bool valid() const;
+
+    template <typename Streambuf>
+    void render(Streambuf& streambuf, const TemplateData& data) const;
+
+  private:
+    typedef _Template::Op Op;
+    typedef _Template::Scope Scope;
+
+    std::string m_text;
+    std::vector<std::string> m_fields;
+    std::vector<Op> m_ops;
+    bool m_valid;
+
+    void compile();
+    bool addTag(std::size_t begin, std::size_t end,
+        std::vector<std::size_t>& sections);
+    unsigned int addField(const std::string& name, bool special);
+
+    template <typename Streambuf>
+    void renderRange(Formatter<Streambuf>& formatter, std::size_t begin,
+        std::size_t end, const Scope& scope) const;
+    TemplateValue lookup(unsigned int field, const Scope& scope) const;
+};
+
+inline TemplateValue::TemplateValue() :
+  m_type(Null),
+  m_uint(0),
+  m_size(0)
+{
+}
+
+inline TemplateValue::TemplateValue(bool value) :
+  m_type(Bool),
+  m_bool(value),
+  m_size(0)
+{
+}
+
+template <typename T>
+inline TemplateValue::TemplateValue(T value,
+    typename std::enable_if<std::is_integral<T>::value &&
+      !std::is_same<T, bool>::value>::type*) :
+  m_size(0)
+{
+  if (std::is_signed<T>::value)
+  {
+    m_type = Int;
+    m_int = value;
+  }
+  else
+  {
+    m_type = UInt;
+    m_uint = value;
+  }
+}
+
+inline TemplateValue::TemplateValue(const char* value) :
+  m_type(value ? String : Null),
+  m_data(value),
+  m_size(value ? std::strlen(value) : 0)
+{
+}
+
+inline TemplateValue::TemplateValue(const char* value, std::size_t size) :
+  m_type(String),
+  m_data(value),
+  m_size(size)
+{
+}
+
+inline TemplateValue::TemplateValue(const std::string& value) :
+  m_type(String),
+  m_data(value.data()),
+  m_size(value.size())
+{
+}
+
+inline TemplateValue::TemplateValue(const TemplateData* items,
+    std::size_t count) :
+  m_type(List),
+  m_items(items),
+  m_size(count)
+{
+}
+
+inline TemplateValue::TemplateValue(const std::vector<TemplateData>& items) :
+  m_type(List),
+  m_items(items.data()),
+  m_size(items.size())
+{
+}
+
+inline TemplateValue::Type TemplateValue::type() const
+{
+  return m_type;
+}
+
+inline bool TemplateValue::truthy() const
+{
+  switch (m_type)
+  {
+    case Bool: return m_bool;
+    case Int: return m_int != 0;
+    case UInt: return m_uint != 0;
+    case String:
+    case List:
+      return m_size != 0;
+    default: return false;
+  }
+}
+
+inline TemplateData::TemplateData(const Template& tpl) :
+  m_template(&tpl),
+  m_values(tpl.fieldCount())
+{
+}
+
+inline TemplateData& TemplateData::set(const char* name,
+    const TemplateValue& value)
+{
+  return set(m_template->field(name), value);
+}
+
+inline TemplateData& TemplateData::set(unsigned int field,
+    const TemplateValue& value)
+{
+  if (field < m_values.size())
+    m_values[field] = value;
+  return *this;
+}
+
+inline const TemplateValue& TemplateData::get(unsigned int field) const
+{
+  return m_values[field];
+}
+
+inline std::size_t TemplateData::size() const
+{
+  return m_values.size();
+}
+
+inline void TemplateData::clear()
+{
+  for (TemplateValue& value : m_values)
+    value = TemplateValue();
+}
+
+inline Template::Template(const char* text) :
+  m_text(text),
+  m_valid(false)
+{
+  compile();
+}
+
+inline Template::Template(const std::string& text) :
+  m_text(text),
+  m_valid(false)
+{
+  compile();
+}
+
+inline unsigned int Template::field(const char* name) const
+{
+  for (std::size_t i = 0; i < m_fields.size(); ++i)
+    if (m_fields[i] == name)
+      return i;
+  return -1;
+}
+
+inline std::size_t Template::fieldCount() const
+{
+  return m_fields.size();
+}
+
+inline bool Template::valid() const
+{
+  return m_valid;
+}
+
+inline void Template::compile()
+{
+  // open sections, as indices of their first op
+  std::vector<std::size_t> sections;
+  std::size_t literal = 0;
+  std::size_t pos = 0;
+
+  while (true)
+  {
+    std::size_t begin = m_text.find("{{", pos);
+    std::size_t textEnd = begin == std::string::npos ? m_text.size() : begin;
+    if (begin == std::string::npos)
+    {
+      if (textEnd > literal)
+        m_ops.push_back(Op{Op::Literal, 0, literal, textEnd - literal, 0, 0,
+            _Formatter::stringItem()});
+      break;
+    }
+
+    std::size_t end = m_text.find("}}", begin + 2);
+    if (end == std::string::npos)
+    {
+      m_ops.clear();
+      FORMAT_ERROR(FormatError::InvalidFormatter);
+      return;
+    }
+    end += 2;
+
+    // a section or comment tag alone on its line takes the line with it
+    std::size_t first = begin + 2;
+    while (first < end - 2 && _Template::isBlank(m_text[first]))
+      ++first;
+    std::size_t last = end - 2;
+    while (last > first && _Template::isBlank(m_text[last-1]))
+      --last;
+    char kind = m_text[first];
+    std::size_t lineBegin = begin;
+    std::size_t lineEnd = end;
+    if (kind == '#' || kind == '/' || kind == '!' ||
+        m_text.compare(first, last - first, "else") == 0)
+    {
+      std::size_t before = begin;
+      while (before > literal && _Template::isBlank(m_text[before-1]))
+        --before;
+      std::size_t after = end;
+      while (after < m_text.size() && _Template::isBlank(m_text[after]))
+        ++after;
+      if ((before == 0 || m_text[before-1] == '\n') &&
+          (after == m_text.size() || m_text[after] == '\n' ||
+           m_text.compare(after, 2, "\r\n") == 0))
+      {
+        lineBegin = before;
+        lineEnd = after == m_text.size() ? after :
+          after + (m_text[after] == '\r' ? 2 : 1);
+      }
+    }
+
+    if (lineBegin > literal)
+      m_ops.push_back(Op{Op::Literal, 0, literal, lineBegin - literal, 0, 0,
+          _Formatter::stringItem()});
+
+    if (!addTag(begin + 2, end - 2, sections))
+    {
+      m_ops.clear();
+      FORMAT_ERROR(FormatError::InvalidFormatter);
+      return;
+    }
+
+    literal = lineEnd;
+    pos = lineEnd;
+  }
+
+  if (!sections.empty())
+  {
+    m_ops.clear();
+    FORMAT_ERROR(FormatError::InvalidFormatter);
+    return;
+  }
+
+  m_valid = true;
+}
+
+inline bool Template::addTag(std::size_t begin, std::size_t end,
+    std::vector<std::size_t>& sections)
+{
+  while (begin < end && _Template::isBlank(m_text[begin]))
+    ++begin;
+  while (end > begin && _Template::isBlank(m_text[end-1]))
+    --end;
+  std::string tag = m_text.substr(begin, end - begin);
+  if (tag.empty())
+    return false;
+
+  Op op = {Op::Field, 0, 0, 0, 0, 0, _Formatter::stringItem()};
+
+  if (tag[0] == '!')
+    return true;
+
+  if (tag == "else")
+  {
+    if (sections.empty() || m_ops[sections.back()].code == Op::Each ||
+        m_ops[sections.back()].elseOp)
+      return false;
+    m_ops[sections.back()].elseOp = m_ops.size();
+    op.code = Op::Else;
+    m_ops.push_back(op);
+    return true;
+  }
+
+  if (tag[0] == '/')
+  {
+    if (sections.empty())
+      return false;
+    Op& section = m_ops[sections.back()];
+    std::string keyword = tag.substr(1);
+    if ((section.code == Op::Each && keyword != "each") ||
+        (section.code == Op::If && keyword != "if") ||
+        (section.code == Op::Unless && keyword != "unless"))
+      return false;
+    section.endOp = m_ops.size();
+    if (!section.elseOp)
+      section.elseOp = section.endOp;
+    sections.pop_back();
+    op.code = Op::End;
+    m_ops.push_back(op);
+    return true;
+  }
+
+  if (tag[0] == '#')
+  {
+    std::size_t space = tag.find_first_of(" \t");
+    if (space == std::string::npos)
+      return false;
+    std::string keyword = tag.substr(1, space - 1);
+    std::string name = tag.substr(tag.find_first_not_of(" \t", space));
+
+    if (keyword == "each")
+      op.code = Op::Each;
+    else if (keyword == "if")
+      op.code = Op::If;
+    else if (keyword == "unless")
+      op.code = Op::Unless;
+    else
+      return false;
+
+    bool inList = false;
+    for (std::size_t section : sections)
+      inList = inList || m_ops[section].code == Op::Each;
+    if (name[0] == '@' && (op.code == Op::Each || !inList))
+      return false;
+
+    op.field = addField(name, name[0] == '@');
+    if (op.field == _Template::FIELD_INVALID)
+      return false;
+    sections.push_back(m_ops.size());
+    m_ops.push_back(op);
+    return true;
+  }
+
+  // a field, with an optional format item
+  std::size_t colon = tag.find(':');
+  std::string name = tag.substr(0, colon);
+  while (!name.empty() && _Template::isBlank(name[name.size()-1]))
+    name.erase(name.size() - 1);
+  if (name.empty())
+    return false;
+
+  if (colon != std::string::npos)
+  {
+    std::size_t percent = tag.find_first_not_of(" \t", colon + 1);
+    if (percent == std::string::npos || tag[percent] != '%')
+      return false;
+
+    _Formatter::StringFormatterItem<const char*> item;
+    const char* iter = tag.c_str() + percent + 1;
+    item.handleFormatter(iter);
+    // the arguments of a field are its value only
+    if (*iter || item.position != _Formatter::FormatterItem::POSITION_NONE ||
+        item.width == _Formatter::FormatterItem::WIDTH_ARG ||
+        item.precision == _Formatter::FormatterItem::WIDTH_ARG)
+      return false;
+    item.position = 0;
+    op.item = item;
+  }
+
+  bool inList = false;
+  for (std::size_t section : sections)
+    inList = inList || m_ops[section].code == Op::Each;
+  if (name[0] == '@' && !inList)
+    return false;
+
+  op.field = addField(name, name[0] == '@');
+  if (op.field == _Template::FIELD_INVALID)
+    return false;
+  m_ops.push_back(op);
+  return true;
+}
+
+inline unsigned int Template::addField(const std::string& name, bool special)
+{
+  if (special)
+  {
+    if (name == "@index")
+      return _Template::FIELD_INDEX;
+    if (name == "@first")
+      return _Template::FIELD_FIRST;
+    if (name == "@last")
+      return _Template::FIELD_LAST;
+    return _Template::FIELD_INVALID;
+  }
+
+  for (std::size_t i = 0; i < m_fields.size(); ++i)
+    if (m_fields[i] == name)
+      return i;
+  m_fields.push_back(name);
+  return m_fields.size() - 1;
+}
+
+inline TemplateValue Template::lookup(unsigned int field,
+    const Scope& scope) const
+{
+  switch (field)
+  {
+    case _Template::FIELD_INDEX:
+      return TemplateValue(scope.index);
+    case _Template::FIELD_FIRST:
+      return TemplateValue(scope.index == 0);
+    case _Template::FIELD_LAST:
+      return TemplateValue(scope.index + 1 == scope.count);
+  }
+
+  for (const Scope* iter = &scope; iter; iter = iter->parent)
+    if (field < iter->data->size() &&
+        iter->data->get(field).type() != TemplateValue::Null)
+      return iter->data->get(field);
+  return TemplateValue();
+}
+
+template <typename Streambuf>
+inline void Template::render(Streambuf& streambuf,
+    const TemplateData& data) const
+{
+  static_assert(sizeof(typename Streambuf::char_type) == 1,
+      "templates are rendered to char streambufs");
+
+  Formatter<Streambuf> formatter(streambuf);
+  Scope scope = {&data, 0, 1, nullptr};
+  renderRange(formatter, 0, m_ops.size(), scope);
+}
+
+template <typename Streambuf>
+void Template::renderRange(Formatter<Streambuf>& formatter,
+    std::size_t begin, std::size_t end, const Scope& scope) const
+{
+  Streambuf& streambuf = formatter.streambuf();
+
+  for (std::size_t i = begin; i < end; )
+  {
+    const Op& op = m_ops[i];
+    switch (op.code)
+    {
+      case Op::Literal:
+        streambuf.sputn(m_text.data() + op.begin, op.size);
+        ++i;
+        break;
+
+      case Op::Field:
+        {
+          TemplateValue value = lookup(op.field, scope);
+          switch (value.m_type)
+          {
+            case TemplateValue::Null:
+              break;
+            case TemplateValue::Bool:
+              formatter.printItem(op.item, value.m_bool);
+              break;
+            case TemplateValue::Int:
+              formatter.printItem(op.item, value.m_int);
+              break;
+            case TemplateValue::UInt:
+              formatter.printItem(op.item, value.m_uint);
+              break;
+            case TemplateValue::String:
+              if (op.item.width == _Formatter::FormatterItem::WIDTH_EMPTY &&
+                  op.item.formatChar == 's')
+                streambuf.sputn(value.m_data, value.m_size);
+              else
+              {
+                _Template::StringRef str = {value.m_data, value.m_size};
+                formatter.printItem(op.item, str);
+              }
+              break;
+            case TemplateValue::List:
+              FORMAT_ERROR(FormatError::IncompatibleType);
+              break;
+          }
+          ++i;
+        }
+        break;
+
+      case Op::Each:
+        {
+          TemplateValue value = lookup(op.field, scope);
+          if (value.m_type == TemplateValue::List)
+            for (std::size_t item = 0; item < value.m_size; ++item)
+            {
+              Scope inner = {value.m_items + item, item, value.m_size,
+                &scope};
+              renderRange(formatter, i + 1, op.endOp, inner);
+            }
+          i = op.endOp + 1;
+        }
+        break;
+
+      case Op::If:
+      case Op::Unless:
+        {
+          bool condition = lookup(op.field, scope).truthy() ==
+            (op.code == Op::If);
+          if (condition)
+            renderRange(formatter, i + 1, op.elseOp, scope);
+          else if (op.elseOp != op.endOp)
+            renderRange(formatter, op.elseOp + 1, op.endOp, scope);
+          i = op.endOp + 1;
+        }
+        break;
+
+      default:
+        ++i;
+        break;
+    }
+  }
+}
+
+}
+
+#endif
+// vim: ts=2:sw=2:sts=2:expandtab
@@ -0,0 +1,318 @@
+// Copyright (c) 2013, Philippe Daouadi <p.daouadi@free.fr>
+// All rights reserved.
+//
+// This file is distributed under the same license as pnt.hpp, see the
+// COPYING file.
+
+#ifndef PNT_UTF8_HPP
+#define PNT_UTF8_HPP
+
+#include <pnt/core.hpp>
+
+#include <cstring>
+#include <string>
+
+namespace pnt
+{
+
+namespace _Utf8
+{
+  // Both kinds of kernels narrow the ASCII code units at the beginning of
+  // [in, in+size) to out, and return how many they narrowed.
+  typedef std::size_t (*Narrow16Kernel)(const void* in, std::size_t size,
+      char* out);
+  typedef std::size_t (*Narrow32Kernel)(const void* in, std::size_t size,
+      char* out);
+
+  template <typename Unit>
+  inline std::size_t narrowScalar(const void* in, std::size_t size,
+      char* out)
+  {
+    const unsigned char* bytes = static_cast<const unsigned char*>(in);
+    std::size_t i = 0;
+    for (; i < size; ++i, bytes += sizeof(Unit))
+    {
+      Unit unit;
+      std::memcpy(&unit, bytes, sizeof(Unit));
+      if (unit >= 0x80)
+        break;
+      out[i] = static_cast<char>(unit);
+    }
+    return i;
+  }
+
+#if PNT_SIMD_X86
+
+  // 16 code units per iteration
+  PNT_SIMD_TARGET("sse2")
+  inline std::size_t narrow16Sse2(const void* in, std::size_t size,
+      char* out)
+  {
+    const __m128i nonAscii = _mm_set1_epi16(static_cast<short>(0xff80));
+    const char* bytes = static_cast<const char*>(in);
+
+    std::size_t i = 0;
+    for (; i + 16 <= size; i += 16)
+    {
+      __m128i a = _mm_loadu_si128(
+          reinterpret_cast<const __m128i*>(bytes + i * 2));
+      __m128i b = _mm_loadu_si128(
+          reinterpret_cast<const __m128i*>(bytes + i * 2 + 16));
+      __m128i high = _mm_and_si128(_mm_or_si128(a, b), nonAscii);
+      if (_mm_movemask_epi8(_mm_cmpeq_epi16(high, _mm_setzero_si128())) !=
+          0xffff)
+        break;
+      _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i),
+          _mm_packus_epi16(a, b));
+    }
+
+    return i + narrowScalar<std::uint16_t>(bytes + i * 2, size - i, out + i);
+  }
+
+  // 8 code units per iteration
+  PNT_SIMD_TARGET("sse2")
+  inline std::size_t narrow32Sse2(const void* in, std::size_t size,
+      char* out)
+  {
+    const __m128i nonAscii = _mm_set1_epi32(static_cast<int>(0xffffff80));
+    const char* bytes = static_cast<const char*>(in);
+
+    std::size_t i = 0;
+    for (; i + 8 <= size; i += 8)
+    {
+      __m128i a = _mm_loadu_si128(
+          reinterpret_cast<const __m128i*>(bytes + i * 4));
+      __m128i b = _mm_loadu_si128(
+          reinterpret_cast<const __m128i*>(bytes + i * 4 + 16));
+      __m128i high = _mm_and_si128(_mm_or_si128(a, b), nonAscii);
+      if (_mm_movemask_epi8(_mm_cmpeq_epi32(high, _mm_setzero_si128())) !=
+          0xffff)
+        break;
+      // the values are below 0x80, signed saturation does not alter them
+      __m128i words = _mm_packs_epi32(a, b);
+      _mm_storel_epi64(reinterpret_cast<__m128i*>(out + i),
+          _mm_packus_epi16(words, words));
+    }
+
+    return i + narrowScalar<std::uint32_t>(bytes + i * 4, size - i, out + i);
+  }
+
+#endif
+
+  inline Narrow16Kernel narrow16Kernel(simd::Level level)
+  {
+#if PNT_SIMD_X86
+    if (level >= simd::Sse2)
+      return narrow16Sse2;
+#else
+    (void)level;
+#endif
+    return narrowScalar<std::uint16_t>;
+  }
+
+  inline Narrow32Kernel narrow32Kernel(simd::Level level)
+  {
+#if PNT_SIMD_X86
+    if (level >= simd::Sse2)
+      return narrow32Sse2;
+#else
+    (void)level;
+#endif
+    return narrowScalar<std::uint32_t>;
+  }
+
+  // UTF-8 of a code point, which must not be a surrogate, returns the end
+  // of the output
+  inline char* encode(char32_t c, char* out)
+  {
+    if (c < 0x80)
+      *out++ = static_cast<char>(c);
+    else if (c < 0x800)
+    {
+      *out++ = static_cast<char>(0xc0 | c >> 6);
+      *out++ = static_cast<char>(0x80 | (c & 0x3f));
+    }
+    else if (c < 0x10000)
+    {
+      *out++ = static_cast<char>(0xe0 | c >> 12);
+      *out++ = static_cast<char>(0x80 | (c >> 6 & 0x3f));
+      *out++ = static_cast<char>(0x80 | (c & 0x3f));
+    }
+    else
+    {
+      *out++ = static_cast<char>(0xf0 | c >> 18);
+      *out++ = static_cast<char>(0x80 | (c >> 12 & 0x3f));
+      *out++ = static_cast<char>(0x80 | (c >> 6 & 0x3f));
+      *out++ = static_cast<char>(0x80 | (c & 0x3f));
+    }
+    return out;
+  }
+
+  const char32_t REPLACEMENT = 0xfffd;
+}
+
+// Streambuf adapter encoding the wide characters it is given in UTF-8 to a
+// byte streambuf, so that a wide formatter can write UTF-8 files without
+// going through a std::wstring converted afterwards:
+//
+//   std::filebuf file;
+//   pnt::Utf8Streambuf<std::filebuf> utf8(file);
+//   pnt::writef(utf8, L"%s\n", name);
+//
+// CharT is UTF-16 when it is 16 bits wide, char16_t and wchar_t on Windows,
+// and UTF-32 otherwise. Runs of ASCII characters are narrowed 8 or 16 at a
+// time with SSE2. Unpaired surrogates and invalid code points are replaced
+// by U+FFFD. A high surrogate at the end of a write is kept until the next
+// one, finish() replaces it when nothing follows.
+template <typename Streambuf, typename CharT = wchar_t>
+class Utf8Streambuf
+{
+  public:
+    typedef CharT char_type;
+    typedef std::char_traits<CharT> traits_type;
+    typedef typename traits_type::int_type int_type;
+
+    explicit Utf8Streambuf(Streambuf& streambuf);
+
+    int_type sputc(char_type c);
+    std::streamsize sputn(const char_type* s, std::streamsize count);
+
+    // writes the replacement of a pending high surrogate, if any
+    void finish();
+
+    Streambuf& streambuf();
+
+  private:
+    static const bool UTF16 = sizeof(CharT) == 2;
+    // code units encoded per call to the underlying streambuf
+    static const std::size_t CHUNK = 256;
+
+    Streambuf& m_streambuf;
+    char32_t m_highSurrogate;
+    _Utf8::Narrow16Kernel m_narrow16;
+    _Utf8::Narrow32Kernel m_narrow32;
+
+    char* encodeChunk(const char_type* s, std::size_t count, char* out);
+};
+
+template <typename Streambuf, typename CharT>
+inline Utf8Streambuf<Streambuf, CharT>::Utf8Streambuf(Streambuf& streambuf) :
+  m_streambuf(streambuf),
+  m_highSurrogate(0),
+  m_narrow16(_Utf8::narrow16Kernel(simd::level())),
+  m_narrow32(_Utf8::narrow32Kernel(simd::level()))
+{
+}
+
+template <typename Streambuf, typename CharT>
+inline typename Utf8Streambuf<Streambuf, CharT>::int_type
+  Utf8Streambuf<Streambuf, CharT>::sputc(char_type c)
+{
+  typedef typename Streambuf::traits_type ByteTraits;
+
+  if (!m_highSurrogate && static_cast<char32_t>(c) < 0x80)
+  {
+    if (ByteTraits::eq_int_type(m_streambuf.sputc(static_cast<char>(c)),
+          ByteTraits::eof()))
+      return traits_type::eof();
+    return traits_type::to_int_type(c);
+  }
+
+  if (sputn(&c, 1) != 1)
+    return traits_type::eof();
+  return traits_type::to_int_type(c);
+}
+
+template <typename Streambuf, typename CharT>
+inline std::streamsize Utf8Streambuf<Streambuf, CharT>::sputn(
+    const char_type* s, std::streamsize count)
+{
+  // at most 4 bytes per code unit, and the replacement of a surrogate
+  // pending from the previous write
+  char buf[3 + CHUNK * 4];
+
+  std::streamsize written = 0;
+  while (written < count)
+  {
+    std::size_t size = count - written;
+    if (size > CHUNK)
+      size = CHUNK;
+
+    char* end = encodeChunk(s + written, size, buf);
+    std::streamsize bytes = end - buf;
+    if (bytes && m_streambuf.sputn(buf, bytes) != bytes)
+      break;
+    written += size;
+  }
+  return written;
+}
+
+template <typename Streambuf, typename CharT>
+inline void Utf8Streambuf<Streambuf, CharT>::finish()
+{
+  if (!m_highSurrogate)
+    return;
+
+  char buf[4];
+  m_highSurrogate = 0;
+  m_streambuf.sputn(buf, _Utf8::encode(_Utf8::REPLACEMENT, buf) - buf);
+}
+
+template <typename Streambuf, typename CharT>
+inline Streambuf& Utf8Streambuf<Streambuf, CharT>::streambuf()
+{
+  return m_streambuf;
+}
+
+template <typename Streambuf, typename CharT>
+char* Utf8Streambuf<Streambuf, CharT>::encodeChunk(const char_type* s,
+    std::size_t count, char* out)
+{
+  std::size_t i = 0;
+  while (i < count)
+  {
+    if (!m_highSurrogate)
+    {
+      std::size_t ascii = UTF16 ?
+        m_narrow16(s + i, count - i, out) :
+        m_narrow32(s + i, count - i, out);
+      out += ascii;
+      i += ascii;
+      if (i == count)
+        break;
+    }
+
+    char32_t c = static_cast<char32_t>(s[i++]);
+    if (UTF16)
+    {
+      c &= 0xffff;
+      if (m_highSurrogate)
+      {
+        if (c >= 0xdc00 && c <= 0xdfff)
+        {
+          c = 0x10000 + ((m_highSurrogate - 0xd800) << 10) + (c - 0xdc00);
+          m_highSurrogate = 0;
+          out = _Utf8::encode(c, out);
+          continue;
+        }
+        m_highSurrogate = 0;
+        out = _Utf8::encode(_Utf8::REPLACEMENT, out);
+      }
+      if (c >= 0xd800 && c <= 0xdbff)
+      {
+        m_highSurrogate = c;
+        continue;
+      }
+    }
+
+    if ((c >= 0xd800 && c <= 0xdfff) || c > 0x10ffff)
+      c = _Utf8::REPLACEMENT;
+    out = _Utf8::encode(c, out);
+  }
+  return out;
+}
+
+}
+
+#endif
+// vim: ts=2:sw=2:sts=2:expandtab
@@ -0,0 +1,49 @@
+// Copyright (c) 2013, Philippe Daouadi <p.daouadi@free.fr>
+// All rights reserved.
+//
+// This file is distributed under the same license as pnt.hpp, see the
+// COPYING file.
+
+// The pnt module, with the same API as pnt.hpp:
+//
+//   import pnt;
+//
+//   pnt::writef(sb, "%s %d\n", name, value);
+//
+// The standard and intrinsic headers are included in the global module
+// fragment, pnt.hpp in the purview of the module where PNT_EXPORT exports
+// its public declarations. Macros are not exported: PNT_COMPILED and the
+// PNT_INSTANTIATE macros need the headers, and the module is built with or
+// without FORMATTER_THROW_ON_ERROR once for all its importers.
+
+module;
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <cstdint>
+#include <cstdlib>
+#include <exception>
+#include <iosfwd>
+#include <iostream>
+#include <limits>
+#include <string>
+#include <type_traits>
+
+#if !defined(PNT_NO_SIMD) && \
+  (defined(__x86_64__) || defined(__i386__) || \
+   defined(_M_X64) || defined(_M_IX86))
+#ifdef _MSC_VER
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#endif
+#include <immintrin.h>
+#endif
+
+export module pnt;
+
+#define PNT_MODULE_INTERFACE
+#include <pnt.hpp>
+
+// vim: ts=2:sw=2:sts=2:expandtab
@@ -0,0 +1,19 @@
+// Copyright (c) 2013, Philippe Daouadi <p.daouadi@free.fr>
+// All rights reserved.
+//
+// This file is distributed under the same license as pnt.hpp, see the
+// COPYING file.
+
+// Explicit instantiations of the common Formatter specializations, users of
+// the pnt_static library declare them extern with PNT_EXTERN_TEMPLATES.
+
+#include <pnt.hpp>
+
+namespace pnt
+{
+
+PNT_INSTANTIATE_COMMON()
+
+}
+
+// vim: ts=2:sw=2:sts=2:expandtab
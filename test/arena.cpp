@@ -0,0 +1,58 @@
+#define FORMATTER_THROW_ON_ERROR
+#include <pnt/arena.hpp>
+#include <catch.hpp>
+
+using namespace pnt;
+
+TEST_CASE("format", "formatting into strings")
+{
+  CHECK(format("%s=%d", "a", 12) == "a=12");
+  CHECK(format(L"%s=%s", L"a", L"b") == L"a=b");
+
+  std::string str("x");
+  appendf(str, "%5d|%-3s|", -12, "ab");
+  CHECK(str == "x  -12|ab |");
+}
+
+TEST_CASE("format/arena", "formatting into arena backed strings")
+{
+  Arena arena(64);
+
+  ArenaString<char> str = format(arena, "%s %d %x", "a long enough string "
+      "to need more than the first block of the arena", -42, 255u);
+  CHECK(str == "a long enough string to need more than the first block of "
+      "the arena -42 ff");
+  CHECK(str.get_allocator().arena() == &arena);
+
+  ArenaString<wchar_t> wstr = format(arena, L"%s %c", L"wide", L'w');
+  CHECK(wstr == L"wide w");
+
+  // strings with other allocators are printed in place
+  ArenaString<char> prefix(str.data(), 6, str.get_allocator());
+  CHECK(format("[%-8s][%4s]", prefix, std::string("ab")) ==
+      "[a long  ][  ab]");
+
+  Arena blocks(64);
+  void* first = blocks.allocate(1, 1);
+  blocks.allocate(1000, 1);
+  blocks.release();
+  CHECK(blocks.allocate(1, 1) == first);
+
+  int* aligned = static_cast<int*>(arena.allocate(sizeof(int), alignof(int)));
+  CHECK(reinterpret_cast<std::uintptr_t>(aligned) % alignof(int) == 0);
+}
+
+#ifdef PNT_HAS_PMR
+TEST_CASE("format/pmr", "formatting into pmr strings")
+{
+  char buf[256];
+  std::pmr::monotonic_buffer_resource resource(buf, sizeof(buf),
+      std::pmr::null_memory_resource());
+
+  std::pmr::string str = format(&resource, "%s %08d", "pmr", 42);
+  CHECK(str == "pmr 00000042");
+  CHECK(format("%s", str) == "pmr 00000042");
+}
+#endif
+
+// vim: ts=2:sw=2:sts=2:expandtab
@@ -0,0 +1,53 @@
+#define FORMATTER_THROW_ON_ERROR
+#include <pnt/buffer.hpp>
+#include <pnt/checksum.hpp>
+#include <string>
+#include <catch.hpp>
+
+using namespace pnt;
+
+TEST_CASE("checksum/crc32c", "CRC32C at every SIMD level")
+{
+  std::string data;
+  for (int i = 0; i < 1000; ++i)
+    data += static_cast<char>(i * 131 + 7);
+
+  for (int level = simd::Scalar; level <= simd::detectLevel(); ++level)
+  {
+    _Checksum::Crc32cKernel kernel =
+      _Checksum::crc32cKernel(static_cast<simd::Level>(level));
+    SCOPED_INFO("level: " << simd::levelName(static_cast<simd::Level>(level)));
+
+    CHECK(~kernel(~0u, reinterpret_cast<const unsigned char*>("123456789"),
+          9) == 0xe3069283);
+    CHECK(~kernel(~0u, 0, 0) == 0);
+
+    for (std::size_t size = 0; size < data.size(); size += 13)
+      CHECK(kernel(~0u,
+            reinterpret_cast<const unsigned char*>(data.data()), size) ==
+          _Checksum::crc32cScalar(~0u,
+            reinterpret_cast<const unsigned char*>(data.data()), size));
+  }
+
+  CHECK(crc32c("123456789", 9) == 0xe3069283);
+  CHECK(crc32c("56789", 5, crc32c("1234", 4)) == 0xe3069283);
+}
+
+TEST_CASE("checksum/streambuf", "checksumming streambuf adapter")
+{
+  Buffer buffer;
+  Crc32cStreambuf<Buffer> checked(buffer);
+
+  writef(checked, "%s %d %c|%-6s|", "a string", -12345, 'x', "pad");
+  for (int i = 0; i < 100; ++i)
+    writef(checked, "%08x\n", i * 2654435761u);
+
+  CHECK(checked.checksum() == crc32c(buffer.data(), buffer.size()));
+
+  checked.reset();
+  buffer.clear();
+  writef(checked, "123456789");
+  CHECK(checked.checksum() == 0xe3069283);
+}
+
+// vim: ts=2:sw=2:sts=2:expandtab
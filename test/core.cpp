@@ -0,0 +1,147 @@
+#define FORMATTER_THROW_ON_ERROR
+#include <pnt/core.hpp>
+
+// the core must not bring the standard streams in
+#if defined(_GLIBCXX_IOSTREAM) || defined(_GLIBCXX_STDEXCEPT)
+#error "pnt/core.hpp includes <iostream> or <stdexcept>"
+#endif
+
+#include <catch.hpp>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+using namespace pnt;
+
+namespace
+{
+
+// not a std::basic_streambuf
+template <typename CharT>
+class StringSink
+{
+  public:
+    typedef CharT char_type;
+    typedef std::char_traits<CharT> traits_type;
+    typedef typename traits_type::int_type int_type;
+
+    int_type sputc(char_type c)
+    {
+      str += c;
+      return traits_type::to_int_type(c);
+    }
+
+    std::streamsize sputn(const char_type* s, std::streamsize count)
+    {
+      str.append(s, count);
+      return count;
+    }
+
+    std::basic_string<CharT> str;
+};
+
+// counts the allocations of the strings using it
+std::size_t allocations = 0;
+
+template <typename T>
+struct CountingAllocator : std::allocator<T>
+{
+  template <typename U>
+  struct rebind
+  {
+    typedef CountingAllocator<U> other;
+  };
+
+  CountingAllocator() {}
+  template <typename U>
+  CountingAllocator(const CountingAllocator<U>&) {}
+
+  T* allocate(std::size_t n)
+  {
+    ++allocations;
+    return std::allocator<T>::allocate(n);
+  }
+};
+
+}
+
+TEST_CASE("core", "formatting with pnt/core.hpp only")
+{
+  StringSink<char> sink;
+  writef(sink, "aa %d %#x %s bb", -42, 255, "str");
+  CHECK(sink.str == "aa -42 0xff str bb");
+
+  StringSink<wchar_t> wsink;
+  writef(wsink, L"aa %d %s bb", 42, L"str");
+  CHECK(wsink.str == L"aa 42 str bb");
+
+  CHECK(format("%05d", 42) == "00042");
+
+  CHECK_THROWS_AS(writef(sink, "%d"), FormatError);
+}
+
+TEST_CASE("format/size_hints", "capacity reserved from previous outputs")
+{
+  typedef std::basic_string<char, std::char_traits<char>,
+          CountingAllocator<char>> String;
+
+  static const char* const fmt = "%s|%s|%s";
+  std::string part(40, 'x');
+
+  String first;
+  appendf(first, fmt, part, part, part);
+  CHECK(sizeHint(fmt) == 122);
+
+  // the whole output is reserved at once
+  allocations = 0;
+  String str;
+  appendf(str, fmt, part, part, part);
+  CHECK(str.size() == 122);
+  CHECK(allocations == 1);
+
+  // larger outputs raise the hint, smaller ones lower it slowly
+  appendf(str, fmt, part, part, std::string(100, 'y'));
+  CHECK(sizeHint(fmt) == 182);
+  appendf(str, fmt, "", "", "");
+  CHECK(sizeHint(fmt) == 182 - 180 / 16);
+
+  bool found = false;
+  forEachSizeHint([&](const void* format, std::size_t size)
+      {
+        if (format == fmt)
+          found = size == sizeHint(fmt);
+      });
+  CHECK(found);
+
+  clearSizeHints();
+  CHECK(sizeHint(fmt) == 0);
+}
+
+TEST_CASE("format/size_hints/stale", "entries of unused formats are replaced")
+{
+  clearSizeHints();
+
+  // more format strings than the table holds, freed afterwards
+  {
+    std::vector<std::string> formats;
+    for (int i = 0; i < 4096; ++i)
+      formats.push_back("%d " + std::to_string(i));
+    for (const std::string& fmt : formats)
+      format(fmt.c_str(), 1);
+  }
+  std::size_t count = 0;
+  forEachSizeHint([&](const void*, std::size_t) { ++count; });
+  CHECK(count == 1024);
+
+  // the first call clears the used flags of the slots it looks at, the
+  // second takes one of them
+  static const char* const fmt = "%s";
+  format(fmt, std::string(50, 'x'));
+  format(fmt, std::string(50, 'x'));
+  CHECK(sizeHint(fmt) == 50);
+
+  clearSizeHints();
+}
+
+// vim: ts=2:sw=2:sts=2:expandtab
@@ -0,0 +1,74 @@
+#define FORMATTER_THROW_ON_ERROR
+#include <pnt/direct.hpp>
+#include <catch.hpp>
+
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <string>
+
+using namespace pnt;
+
+namespace
+{
+  std::string readFile(const char* path)
+  {
+    std::ifstream file(path, std::ios::binary);
+    std::ostringstream ss;
+    ss << file.rdbuf();
+    return ss.str();
+  }
+}
+
+TEST_CASE("direct", "O_DIRECT file sink")
+{
+  char path[] = "/tmp/pnt_direct_XXXXXX";
+  int fd = ::mkstemp(path);
+  REQUIRE(fd >= 0);
+  ::close(fd);
+
+  std::string expected;
+  {
+    // several buffers, and a tail which is not aligned
+    DirectFileSink sink(path, 1);
+    for (int i = 0; i < 2000; ++i)
+    {
+      writef(sink, "%d,%s,%x\n", i, "row", static_cast<unsigned int>(i));
+      char line[64];
+      std::snprintf(line, sizeof(line), "%d,%s,%x\n", i, "row", i);
+      expected += line;
+    }
+    sink.sputc('.');
+    expected += '.';
+
+    CHECK(sink.close());
+    CHECK(sink.error() == 0);
+    CHECK(sink.size() == expected.size());
+    // closing twice does nothing
+    CHECK(sink.close());
+  }
+
+  CHECK(readFile(path) == expected);
+
+  {
+    DirectFileSink sink(path);
+    writef(sink, "%s", "short");
+  }
+  CHECK(readFile(path) == "short");
+
+  {
+    DirectFileSink sink(path);
+  }
+  CHECK(readFile(path) == "");
+
+  ::unlink(path);
+}
+
+TEST_CASE("direct/error", "O_DIRECT file sink failures")
+{
+  DirectFileSink sink("/nonexistent/pnt/export", 1);
+  writef(sink, "%s", std::string(10000, 'x'));
+  CHECK(!sink.close());
+  CHECK(sink.error() == ENOENT);
+  CHECK(sink.size() == 0);
+}
@@ -0,0 +1,217 @@
+#define FORMATTER_THROW_ON_ERROR
+#include <pnt/gate.hpp>
+#include <pnt/buffer.hpp>
+#include <catch.hpp>
+
+#include <string>
+
+using namespace pnt;
+
+namespace
+{
+
+struct FakeClock
+{
+  typedef std::chrono::milliseconds duration;
+  typedef duration::rep rep;
+  typedef duration::period period;
+  typedef std::chrono::time_point<FakeClock> time_point;
+  static const bool is_steady = true;
+
+  static duration& current()
+  {
+    static duration time(0);
+    return time;
+  }
+
+  static time_point now()
+  {
+    return time_point(current());
+  }
+};
+
+typedef BasicLogGate<char, FakeClock> TestGate;
+
+// counts how many times it is printed
+struct Counted
+{
+  int value;
+
+  static int& printed()
+  {
+    static int count = 0;
+    return count;
+  }
+};
+
+}
+
+namespace pnt
+{
+namespace _Formatter
+{
+  template <>
+  struct Printer<Counted>
+  {
+    static const bool printable = true;
+
+    template <typename Formatter>
+    static void print(Formatter& formatter, const Counted& arg)
+    {
+      ++Counted::printed();
+      formatter.print("<%d>", arg.value);
+    }
+  };
+}
+}
+
+TEST_CASE("gate/duplicates", "repeated records are suppressed and counted")
+{
+  FakeClock::current() = FakeClock::duration(0);
+  TestGate gate(std::chrono::seconds(1));
+  Buffer buffer;
+
+  const char* format = "error %s %s\n";
+  std::string name = "disk";
+  char device[8] = "sda";
+  Counted::printed() = 0;
+
+  CHECK(gate.print(buffer, format, name, device));
+  // same content in other objects
+  CHECK_FALSE(gate.print(buffer, format, std::string("disk"), "sda"));
+  CHECK_FALSE(gate.print(buffer, format, name, device));
+  CHECK(gate.print(buffer, format, name, "sdb"));
+  CHECK(gate.print(buffer, "%s\n", Counted{1}));
+  CHECK_FALSE(gate.print(buffer, "%s\n", Counted{1}));
+  CHECK(gate.print(buffer, "%s\n", Counted{2}));
+  // suppressed records are not formatted
+  CHECK(Counted::printed() == 2);
+  CHECK(gate.suppressed() == 3);
+  CHECK(buffer.str() == "error disk sda\nerror disk sdb\n<1>\n<2>\n");
+
+  // the next record of a kind after its window gives the count first
+  buffer.clear();
+  FakeClock::current() = FakeClock::duration(1500);
+  CHECK(gate.print(buffer, format, name, device));
+  std::string out = buffer.str();
+  CHECK(out.size() == 60);
+  CHECK(out.find("[suppressed 1] %s\n") != std::string::npos);
+  CHECK(out.find("[suppressed 2] error %s %s\n") != std::string::npos);
+  CHECK(out.substr(out.size() - 15) == "error disk sda\n");
+
+  // nothing left to summarize
+  buffer.clear();
+  CHECK(gate.flush(buffer) == 0);
+  CHECK(buffer.str() == "");
+}
+
+TEST_CASE("gate/content", "views are hashed by content, with their types")
+{
+  FakeClock::current() = FakeClock::duration(0);
+  TestGate gate(std::chrono::seconds(1));
+  Buffer buffer;
+
+  // a buffer reused for another text is not a repeat
+  const char* format = "%s\n";
+  unsigned char data[3] = {'a', 'b', 'c'};
+  CHECK(gate.print(buffer, format, base64(data, sizeof(data))));
+  data[2] = 'd';
+  CHECK(gate.print(buffer, format, base64(data, sizeof(data))));
+  CHECK_FALSE(gate.print(buffer, format, base64(data, sizeof(data))));
+  CHECK(gate.print(buffer, format, base64url(data, sizeof(data))));
+
+  const char* decimal = "%d\n";
+  std::uint64_t limbs[2] = {1, 0};
+  CHECK(gate.print(buffer, decimal, bigint(limbs, 1)));
+  limbs[0] = 2;
+  CHECK(gate.print(buffer, decimal, bigint(limbs, 1)));
+  CHECK_FALSE(gate.print(buffer, decimal, bigint(limbs, 1)));
+  CHECK(gate.print(buffer, decimal, bigint(limbs, 1, true)));
+
+  // the same bytes in arguments of other types
+  CHECK(gate.print(buffer, format, 'A'));
+  CHECK(gate.print(buffer, format, 65));
+  CHECK(gate.print(buffer, format, static_cast<short>(-1)));
+  CHECK(gate.print(buffer, format, static_cast<unsigned short>(65535)));
+  CHECK(buffer.str() == "YWJj\nYWJk\nYWJk\n1\n2\n-2\nA\n65\n-1\n65535\n");
+}
+
+TEST_CASE("gate/collision", "kinds in the same slots whose windows end apart")
+{
+  FakeClock::current() = FakeClock::duration(0);
+  TestGate gate(std::chrono::seconds(1));
+  Buffer buffer;
+
+  // two arguments whose records start probing at the same slot of the
+  // 1024 of the table, as the gate hashes them
+  const char* format = "%d\n";
+  auto slot = [format](int arg)
+    {
+      _Hash::Hasher hasher;
+      hasher.add(reinterpret_cast<std::uintptr_t>(format));
+      _Hash::addArgs(hasher, arg);
+      return hasher.hash() & 1023;
+    };
+  int other = 1;
+  while (slot(other) != slot(0))
+    ++other;
+
+  CHECK(gate.print(buffer, format, 0));
+  FakeClock::current() = FakeClock::duration(500);
+  CHECK(gate.print(buffer, format, other));
+
+  // the sweep frees the entry of 0, the one of other, after it, is still
+  // in its window
+  FakeClock::current() = FakeClock::duration(1200);
+  CHECK_FALSE(gate.print(buffer, format, other));
+  CHECK(gate.suppressed() == 1);
+
+  FakeClock::current() = FakeClock::duration(1600);
+  CHECK(gate.print(buffer, format, other));
+  CHECK(buffer.str() == "0\n" + std::to_string(other) + "\n"
+      "[suppressed 1] %d\n" + std::to_string(other) + "\n");
+}
+
+TEST_CASE("gate/rate", "rate limit with a burst")
+{
+  FakeClock::current() = FakeClock::duration(0);
+  TestGate gate(std::chrono::milliseconds(100), 3);
+  Buffer buffer;
+
+  int passed = 0;
+  for (int i = 0; i < 10; ++i)
+    passed += gate.print(buffer, "tick %d\n", 7);
+  CHECK(passed == 3);
+
+  // counts are written by flush, without waiting for the window
+  CHECK(gate.flush(buffer) == 1);
+  CHECK(buffer.str() == "tick 7\ntick 7\ntick 7\n[suppressed 7] tick %d\n");
+
+  buffer.clear();
+  FakeClock::current() = FakeClock::duration(100);
+  for (int i = 0; i < 10; ++i)
+    passed += gate.print(buffer, "tick %d\n", 7);
+  CHECK(passed == 6);
+  CHECK(gate.suppressed() == 14);
+
+  // the periodic summary covers all the kinds, the format does not end
+  // with a newline
+  buffer.clear();
+  FakeClock::current() = FakeClock::duration(250);
+  CHECK(gate.print(buffer, "other"));
+  CHECK(buffer.str() == "[suppressed 7] tick %d\nother");
+}
+
+TEST_CASE("gate/wide", "wide log gate")
+{
+  BasicLogGate<wchar_t, FakeClock> gate(std::chrono::seconds(1));
+  WBuffer buffer;
+
+  FakeClock::current() = FakeClock::duration(0);
+  CHECK(gate.print(buffer, L"%s %d\n", L"wide", 1));
+  CHECK_FALSE(gate.print(buffer, L"%s %d\n", L"wide", 1));
+  CHECK(gate.flush(buffer) == 1);
+  CHECK(buffer.str() == L"wide 1\n[suppressed 1] %s %d\n");
+}
+
+// vim: ts=2:sw=2:sts=2:expandtab
@@ -0,0 +1,211 @@
+#define FORMATTER_THROW_ON_ERROR
+#include <compiled_formats.hpp>
+#include <pnt/memo.hpp>
+#include <pnt/buffer.hpp>
+#include <catch.hpp>
+
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace pnt;
+
+namespace
+{
+
+// counts how many times it is printed
+struct Rendered
+{
+  int value;
+
+  static int& count()
+  {
+    static int count = 0;
+    return count;
+  }
+};
+
+// writes how many times sputn was called
+struct CallStreambuf : public Buffer
+{
+  std::size_t calls = 0;
+
+  std::streamsize sputn(const char_type* s, std::streamsize count)
+  {
+    ++calls;
+    return Buffer::sputn(s, count);
+  }
+};
+
+}
+
+namespace pnt
+{
+namespace _Formatter
+{
+  template <>
+  struct Printer<Rendered>
+  {
+    static const bool printable = true;
+
+    template <typename Formatter>
+    static void print(Formatter& formatter, const Rendered& arg)
+    {
+      ++Rendered::count();
+      formatter.print("<%d>", arg.value);
+    }
+  };
+}
+}
+
+TEST_CASE("memo/hits", "repeated records are rendered once")
+{
+  Memo memo;
+  CallStreambuf sb;
+  Rendered::count() = 0;
+
+  const char* format = "%s %s %s\n";
+  std::string name = "worker";
+  char state[8] = "idle";
+  for (int i = 0; i < 3; ++i)
+  {
+    memo.print(sb, format, name, state, Rendered{i % 2});
+    // same content in other objects
+    memo.print(sb, format, std::string("worker"), "idle", Rendered{i % 2});
+  }
+  CHECK(sb.str() ==
+      "worker idle <0>\nworker idle <0>\n"
+      "worker idle <1>\nworker idle <1>\n"
+      "worker idle <0>\nworker idle <0>\n");
+  CHECK(Rendered::count() == 2);
+  CHECK(memo.misses() == 2);
+  CHECK(memo.hits() == 4);
+  CHECK(memo.size() == 2);
+  // one sputn per record
+  CHECK(sb.calls == 6);
+
+  // the format is part of the key
+  const char other[] = "%s %s %s\n";
+  memo.print(sb, other, name, state, Rendered{0});
+  CHECK(memo.misses() == 3);
+
+  memo.clear();
+  CHECK(memo.size() == 0);
+  CHECK(memo.bytes() == 0);
+}
+
+// the string literals of both sites are merged, they share the address of
+// the format
+void printChar(Memo& memo, Buffer& sb, char c)
+{
+  memo.print(sb, "%s|", c);
+}
+
+void printInt(Memo& memo, Buffer& sb, int i)
+{
+  memo.print(sb, "%s|", i);
+}
+
+TEST_CASE("memo/types", "same bytes in arguments of different types")
+{
+  Memo memo;
+  Buffer sb;
+
+  printChar(memo, sb, 'A');
+  printInt(memo, sb, 65);
+  printChar(memo, sb, 'A');
+  printInt(memo, sb, 65);
+
+  const char* format = "%d|";
+  memo.print(sb, format, static_cast<short>(-1));
+  memo.print(sb, format, static_cast<unsigned short>(65535));
+  memo.print(sb, format, static_cast<unsigned short>(65535));
+
+  CHECK(sb.str() == "A|65|A|65|-1|65535|65535|");
+  CHECK(memo.misses() == 4);
+  CHECK(memo.hits() == 3);
+}
+
+TEST_CASE("memo/compiled", "compiled formats are keyed by their Id")
+{
+  Memo memo;
+  Buffer sb;
+  Rendered::count() = 0;
+
+  for (int i = 0; i < 2; ++i)
+  {
+    memo.print(sb, PNT_COMPILED("[%s] %d\n"), Rendered{1}, 2);
+    memo.print(sb, PNT_COMPILED("[%s] %d\n"), Rendered{1}, 2);
+  }
+  CHECK(sb.str() == "[<1>] 2\n[<1>] 2\n[<1>] 2\n[<1>] 2\n");
+  CHECK(Rendered::count() == 1);
+  CHECK(memo.hits() == 3);
+
+  WMemo wmemo;
+  WBuffer wsb;
+  wmemo.print(wsb, PNT_COMPILED(L"%s %d|"), L"wide", 3);
+  wmemo.print(wsb, L"%s %d|", L"wide", 3);
+  wmemo.print(wsb, L"%s %d|", L"wide", 3);
+  CHECK(wsb.str() == L"wide 3|wide 3|wide 3|");
+  CHECK(wmemo.hits() == 1);
+}
+
+TEST_CASE("memo/lru", "bounded by entries and bytes, least recently used out")
+{
+  Memo memo(3, 1024);
+  Buffer sb;
+  const char* format = "%d\n";
+
+  for (int i : {1, 2, 3, 1, 4})
+    memo.print(sb, format, i);
+  CHECK(memo.size() == 3);
+  CHECK(memo.hits() == 1);
+
+  // 2 was the least recently used
+  memo.print(sb, format, 1);
+  memo.print(sb, format, 3);
+  memo.print(sb, format, 4);
+  CHECK(memo.hits() == 4);
+  memo.print(sb, format, 2);
+  CHECK(memo.misses() == 5);
+  CHECK(sb.str() == "1\n2\n3\n1\n4\n1\n3\n4\n2\n");
+
+  // outputs over the size in bytes are not kept
+  Memo small(16, 64);
+  std::string large(100, 'x');
+  small.print(sb, "%s", large);
+  small.print(sb, "%s", large);
+  CHECK(small.size() == 0);
+  CHECK(small.misses() == 2);
+
+  small.print(sb, "%s", "abc");
+  CHECK(small.size() == 1);
+  CHECK(small.bytes() <= 64);
+}
+
+TEST_CASE("memo/threads", "one memo per thread")
+{
+  std::vector<std::string> outputs(4);
+  std::vector<std::thread> threads;
+  for (int t = 0; t < 4; ++t)
+    threads.emplace_back([&outputs, t]()
+        {
+          thread_local Memo memo(8);
+          Buffer sb;
+          for (int i = 0; i < 1000; ++i)
+            memo.print(sb, "%d:%d ", t, i % 10);
+          outputs[t] = sb.str();
+        });
+  for (std::thread& thread : threads)
+    thread.join();
+
+  for (int t = 0; t < 4; ++t)
+  {
+    std::string expected;
+    for (int i = 0; i < 1000; ++i)
+      expected += std::to_string(t) + ":" + std::to_string(i % 10) + " ";
+    CHECK(outputs[t] == expected);
+  }
+}
+
+// vim: ts=2:sw=2:sts=2:expandtab
@@ -0,0 +1,123 @@
+#define FORMATTER_THROW_ON_ERROR
+#include <pnt/merge.hpp>
+#include <pnt/buffer.hpp>
+#include <catch.hpp>
+
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace pnt;
+
+TEST_CASE("merge", "timestamp ordered merge of per-thread queues")
+{
+  MergeLog log;
+  Buffer buffer;
+
+  {
+    MergeLog::Producer a(log);
+    MergeLog::Producer b(log);
+    for (int i = 0; i < 3; ++i)
+    {
+      CHECK(a.print("a%d ", i));
+      CHECK(b.print("b%d ", i));
+    }
+    log.drainAll(buffer);
+    CHECK(buffer.str() == "a0 b0 a1 b1 a2 b2 ");
+
+    buffer.clear();
+    CHECK(b.print("%s", "late"));
+  }
+
+  // the queues of the producers are drained after they are gone
+  CHECK(log.drainAll(buffer) == 1);
+  CHECK(buffer.str() == "late");
+  CHECK(log.drainAll(buffer) == 0);
+}
+
+TEST_CASE("merge/error", "a record whose formatting throws does not hold the others")
+{
+  MergeLog log;
+  Buffer buffer;
+  MergeLog::Producer a(log);
+  MergeLog::Producer b(log);
+
+  CHECK(a.print("%s ", "a0"));
+  CHECK_THROWS_AS(a.print("%d", "a1"), FormatError);
+  CHECK(b.print("%s ", "b0"));
+
+  CHECK(log.drain(buffer) == 2);
+  CHECK(buffer.str() == "a0 b0 ");
+}
+
+TEST_CASE("merge/threads", "global order across threads")
+{
+  const int THREADS = 4;
+  const int RECORDS = 5000;
+
+  MergeLog log(4096, 64);
+  Buffer buffer;
+
+  // records are produced one at a time across the threads, so their
+  // timestamps follow the sequence numbers
+  std::mutex mutex;
+  int sequence = 0;
+  std::atomic<int> done(0);
+
+  std::vector<std::thread> threads;
+  for (int t = 0; t < THREADS; ++t)
+    threads.push_back(std::thread([&]
+          {
+            MergeLog::Producer producer(log);
+            for (int i = 0; i < RECORDS; ++i)
+            {
+              std::lock_guard<std::mutex> lock(mutex);
+              while (!producer.print("%d\n", sequence))
+                std::this_thread::yield();
+              ++sequence;
+            }
+            ++done;
+          }));
+
+  while (done != THREADS)
+    log.drain(buffer);
+  for (std::thread& thread : threads)
+    thread.join();
+  log.drainAll(buffer);
+
+  std::istringstream lines(buffer.str());
+  int expected = 0;
+  int value;
+  bool ordered = true;
+  while (lines >> value)
+    ordered = ordered && value == expected++;
+  CHECK(ordered);
+  CHECK(expected == THREADS * RECORDS);
+}
+
+TEST_CASE("merge/full", "full queues and long records")
+{
+  MergeLog log(256, 32);
+  MergeLog::Producer producer(log);
+
+  CHECK(producer.print("%s", std::string(100, 'x')));
+  int printed = 1;
+  while (producer.print("%d", printed))
+    ++printed;
+  CHECK(log.dropped() == 1);
+
+  Buffer buffer;
+  CHECK(log.drainAll(buffer) == static_cast<std::size_t>(printed));
+  CHECK(buffer.str().compare(0, 33, std::string(32, 'x') + "1") == 0);
+
+  // the space is reused, across the end of the ring
+  for (int round = 0; round < 10; ++round)
+  {
+    buffer.clear();
+    CHECK(producer.print("%s", "abc"));
+    CHECK(producer.print("%s", "defghij"));
+    CHECK(log.drainAll(buffer) == 2);
+    CHECK(buffer.str() == "abcdefghij");
+  }
+}
@@ -0,0 +1,99 @@
+#define FORMATTER_THROW_ON_ERROR
+#include <pnt/buffer.hpp>
+#include <pnt/metrics.hpp>
+#include <limits>
+#include <catch.hpp>
+
+using namespace pnt;
+
+TEST_CASE("buffer", "growable in-memory streambuf")
+{
+  Buffer buffer(4);
+  writef(buffer, "%s=%d", "a rather long key", 12345);
+  CHECK(buffer.str() == "a rather long key=12345");
+  CHECK(buffer.capacity() >= buffer.size());
+
+  std::size_t capacity = buffer.capacity();
+  buffer.clear();
+  CHECK(buffer.size() == 0);
+  writef(buffer, "%d", 1);
+  CHECK(buffer.str() == "1");
+  CHECK(buffer.capacity() == capacity);
+
+  WBuffer wbuffer(1);
+  writef(wbuffer, L"%s", L"wide");
+  CHECK(wbuffer.str() == L"wide");
+}
+
+TEST_CASE("metrics/prometheus", "Prometheus text exposition format")
+{
+  Buffer buffer;
+  PrometheusWriter<Buffer> writer(buffer);
+
+  PrometheusSeries up("up");
+  PrometheusSeries requests("http_requests_total");
+  requests.label("method", "post").label("path", "/a\"b\\c\nd");
+
+  writer.type("http_requests_total", "counter");
+  writer.sample(up, 1);
+  writer.sample(requests, 1027u, 1395066363000);
+  writer.sample(requests, {{"code", "200"}}, 3);
+  writer.sample(up, {{"job", "x\"y"}, {"instance", "z"}}, 0.5);
+  writer.sample(up, 12.0);
+  writer.sample(up, -3.25);
+  writer.sample(up, std::numeric_limits<double>::quiet_NaN());
+  writer.sample(up, std::numeric_limits<double>::infinity());
+  writer.sample(up, -std::numeric_limits<double>::infinity());
+  writer.sample(up, true);
+
+  CHECK(buffer.str() ==
+      "# TYPE http_requests_total counter\n"
+      "up 1\n"
+      "http_requests_total{method=\"post\",path=\"/a\\\"b\\\\c\\nd\"} 1027"
+      " 1395066363000\n"
+      "http_requests_total{method=\"post\",path=\"/a\\\"b\\\\c\\nd\","
+      "code=\"200\"} 3\n"
+      "up{job=\"x\\\"y\",instance=\"z\"} 0.5\n"
+      "up 12\n"
+      "up -3.25\n"
+      "up NaN\n"
+      "up +Inf\n"
+      "up -Inf\n"
+      "up 1\n");
+}
+
+TEST_CASE("metrics/influx", "InfluxDB line protocol")
+{
+  Buffer buffer;
+  InfluxWriter<Buffer> writer(buffer);
+
+  InfluxSeries cpu("cpu load");
+  cpu.tag("host", "server 01").tag("region", "us,west=2");
+
+  CHECK(writer.sample(cpu, "value", 0.64));
+  CHECK(writer.sample(cpu, "count", -12, 1465839830100400200));
+  CHECK(writer.sample(cpu, "total", 12u));
+  CHECK(!writer.sample(cpu, "value",
+        std::numeric_limits<double>::quiet_NaN()));
+  CHECK(writer.sample(cpu, "a=b", 2.0));
+  CHECK(writer.sample(cpu, "up", true));
+  CHECK(writer.sample(cpu, "up", false));
+
+  CHECK(buffer.str() ==
+      "cpu\\ load,host=server\\ 01,region=us\\,west\\=2 value=0.64\n"
+      "cpu\\ load,host=server\\ 01,region=us\\,west\\=2 count=-12i"
+      " 1465839830100400200\n"
+      "cpu\\ load,host=server\\ 01,region=us\\,west\\=2 total=12u\n"
+      "cpu\\ load,host=server\\ 01,region=us\\,west\\=2 a\\=b=2\n"
+      "cpu\\ load,host=server\\ 01,region=us\\,west\\=2 up=true\n"
+      "cpu\\ load,host=server\\ 01,region=us\\,west\\=2 up=false\n");
+
+  // new lines can't be escaped, they are dropped
+  buffer.clear();
+  InfluxSeries disk("disk\nio");
+  disk.tag("dev\n", "sd\na\n").tag("\nx", "y\n\n");
+  CHECK(writer.sample(disk, "rea\nd", 1));
+  CHECK(buffer.str() == "diskio,dev=sda,x=y read=1i\n");
+}
+
+// vim: ts=2:sw=2:sts=2:expandtab
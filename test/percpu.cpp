@@ -0,0 +1,88 @@
+#define FORMATTER_THROW_ON_ERROR
+#include <pnt/percpu.hpp>
+#include <catch.hpp>
+
+#include <set>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using namespace pnt;
+
+TEST_CASE("percpu", "per-CPU log buffers")
+{
+  PerCpuSink sink(16, 3);
+  CHECK(sink.cpuCount() == 3);
+
+  const int THREADS = 4;
+  const int RECORDS = 2000;
+
+  std::string output;
+  auto consumer = [&](const char* data, std::size_t size)
+    {
+      output.append(data, size);
+    };
+
+  std::vector<std::thread> threads;
+  for (int t = 0; t < THREADS; ++t)
+    threads.push_back(std::thread([&sink, t, RECORDS]
+          {
+            for (int i = 0; i < RECORDS; ++i)
+              sink.print("thread %d record %d\n", t, i);
+          }));
+
+  // drains while the threads are printing
+  std::size_t drained = sink.drain(consumer);
+  for (std::thread& thread : threads)
+    thread.join();
+  drained += sink.drain(consumer);
+
+  CHECK(drained == output.size());
+  CHECK(sink.drain(consumer) == 0);
+
+  // every record is there, and whole
+  std::set<std::string> records;
+  std::istringstream lines(output);
+  std::string line;
+  while (std::getline(lines, line))
+    records.insert(line);
+  CHECK(records.size() == static_cast<std::size_t>(THREADS * RECORDS));
+  CHECK(records.count("thread 3 record 1999") == 1);
+  CHECK(output.size() == (THREADS * RECORDS) * std::string(
+        "thread 0 record ").size() + THREADS * (10 + 90 * 2 + 900 * 3 +
+        1000 * 4) + THREADS * RECORDS);
+
+  sink.print("%s", "last");
+  output.clear();
+  sink.drain(consumer);
+  CHECK(output == "last");
+}
+
+TEST_CASE("percpu/error", "a record whose formatting throws is dropped")
+{
+  PerCpuSink sink(16, 1);
+  std::string output;
+  auto consumer = [&](const char* data, std::size_t size)
+    {
+      output.append(data, size);
+    };
+
+  sink.print("%s\n", "first");
+  // "partial " is written before %d throws
+  CHECK_THROWS_AS(sink.print("%s %d\n", "partial", "text"), FormatError);
+  sink.print("%s\n", "second");
+
+  sink.drain(consumer);
+  CHECK(output == "first\nsecond\n");
+}
+
+TEST_CASE("percpu/cpu", "current CPU")
+{
+  PerCpuSink sink;
+  CHECK(sink.cpuCount() >= 1);
+  CHECK(sink.cpuCount() == static_cast<unsigned int>(
+        ::sysconf(_SC_NPROCESSORS_CONF)));
+  // the thread may move between two reads of the CPU, only the range is
+  // certain
+  CHECK(_PerCpu::currentCpu() < sink.cpuCount());
+}
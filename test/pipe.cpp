@@ -0,0 +1,80 @@
+#define FORMATTER_THROW_ON_ERROR
+#include <pnt/pipe.hpp>
+#include <catch.hpp>
+
+#include <string>
+
+#include <sys/socket.h>
+
+using namespace pnt;
+
+namespace
+{
+  std::string readAll(int fd)
+  {
+    std::string data;
+    char buf[4096];
+    ssize_t size;
+    while ((size = ::read(fd, buf, sizeof(buf))) > 0)
+      data.append(buf, size);
+    return data;
+  }
+
+  std::string writeRecords(PipeSink& sink, int count)
+  {
+    std::string expected;
+    for (int i = 0; i < count; ++i)
+    {
+      writef(sink, "record %d %s\n", i, "with some text");
+      expected += "record " + std::to_string(i) + " with some text\n";
+    }
+    return expected;
+  }
+}
+
+TEST_CASE("pipe/splice", "pages given to a pipe")
+{
+  int fds[2];
+  REQUIRE(::pipe(fds) == 0);
+
+  std::string expected;
+  {
+    PipeSink sink(fds[1], 1);
+    CHECK(sink.bufferSize() == static_cast<std::size_t>(
+          ::sysconf(_SC_PAGESIZE)));
+#ifdef PNT_HAS_VMSPLICE
+    CHECK(sink.splicing());
+    CHECK(sink.bufferCount() > 1);
+#endif
+
+    // less than the pipe holds, as nothing reads it yet
+    expected = writeRecords(sink, 1000);
+    CHECK(sink.flush());
+    CHECK(sink.error() == 0);
+
+    sink.sputc('!');
+    expected += '!';
+  }
+  ::close(fds[1]);
+
+  CHECK(readAll(fds[0]) == expected);
+  ::close(fds[0]);
+}
+
+TEST_CASE("pipe/write", "fallback for descriptors which are not pipes")
+{
+  int fds[2];
+  REQUIRE(::socketpair(AF_UNIX, SOCK_STREAM, 0, fds) == 0);
+
+  std::string expected;
+  {
+    PipeSink sink(fds[0], 4096);
+    CHECK(!sink.splicing());
+    expected = writeRecords(sink, 500);
+  }
+  ::shutdown(fds[0], SHUT_WR);
+
+  CHECK(readAll(fds[1]) == expected);
+  ::close(fds[0]);
+  ::close(fds[1]);
+}
@@ -0,0 +1,116 @@
+#define FORMATTER_THROW_ON_ERROR
+#include <pnt/socket.hpp>
+#include <catch.hpp>
+
+#include <string>
+
+using namespace pnt;
+
+namespace
+{
+  std::string receive(int fd)
+  {
+    char buf[4096];
+    ssize_t size = ::recv(fd, buf, sizeof(buf), MSG_DONTWAIT);
+    return size < 0 ? std::string() : std::string(buf, size);
+  }
+}
+
+TEST_CASE("socket/datagram", "batched datagrams")
+{
+  int fds[2];
+  REQUIRE(::socketpair(AF_UNIX, SOCK_DGRAM, 0, fds) == 0);
+
+  SocketSink::Options options;
+  options.maxRecords = 3;
+  options.maxDelay = std::chrono::hours(1);
+
+  {
+    SocketSink sink(fds[0], SocketSink::Datagram, options);
+    sink.record("<%d>first %s", 14, "record");
+    sink.record("second");
+    CHECK(sink.pendingRecords() == 2);
+    CHECK(receive(fds[1]) == "");
+
+    // the third record sends the batch
+    sink.record("third %x", 255u);
+    CHECK(sink.pendingRecords() == 0);
+    CHECK(receive(fds[1]) == "<14>first record");
+    CHECK(receive(fds[1]) == "second");
+    CHECK(receive(fds[1]) == "third ff");
+
+    // a record may be written in pieces, empty ones are not sent
+    writef(sink, "%s", "four");
+    writef(sink, "%s", "th");
+    sink.endRecord();
+    sink.endRecord();
+    writef(sink, "fifth");
+    CHECK(sink.pendingRecords() == 1);
+    CHECK(sink.pendingBytes() == 6);
+
+    // flushing keeps the record being written
+    CHECK(sink.flush());
+    CHECK(receive(fds[1]) == "fourth");
+    CHECK(receive(fds[1]) == "");
+  }
+
+  // the destructor ends the record and sends it
+  CHECK(receive(fds[1]) == "fifth");
+  CHECK(receive(fds[1]) == "");
+
+  ::close(fds[0]);
+  ::close(fds[1]);
+}
+
+TEST_CASE("socket/stream", "batched stream writes")
+{
+  int fds[2];
+  REQUIRE(::socketpair(AF_UNIX, SOCK_STREAM, 0, fds) == 0);
+
+  SocketSink::Options options;
+  options.maxBytes = 16;
+  options.maxDelay = std::chrono::hours(1);
+
+  SocketSink sink(fds[0], SocketSink::Stream, options);
+  sink.record("%s\n", "line one");
+  CHECK(receive(fds[1]) == "");
+  sink.record("%s\n", "line two");
+  CHECK(receive(fds[1]) == "line one\nline two\n");
+
+  ::close(fds[1]);
+  sink.record("lost\n");
+  CHECK(!sink.flush());
+  CHECK(sink.error() == EPIPE);
+  CHECK(sink.pendingRecords() == 0);
+
+  ::close(fds[0]);
+}
+
+TEST_CASE("socket/delay", "latency bound")
+{
+  int fds[2];
+  REQUIRE(::socketpair(AF_UNIX, SOCK_DGRAM, 0, fds) == 0);
+
+  SocketSink::Options options;
+  options.maxDelay = std::chrono::steady_clock::duration::zero();
+
+  {
+    SocketSink sink(fds[0], SocketSink::Datagram, options);
+    sink.record("now");
+    CHECK(receive(fds[1]) == "now");
+  }
+
+  {
+    options.maxDelay = std::chrono::milliseconds(1);
+    SocketSink sink(fds[0], SocketSink::Datagram, options);
+    sink.record("later");
+    sink.poll();
+    CHECK(receive(fds[1]) == "");
+    ::usleep(2000);
+    sink.poll();
+    CHECK(receive(fds[1]) == "later");
+  }
+
+  ::close(fds[0]);
+  ::close(fds[1]);
+}
@@ -0,0 +1,124 @@
+#define FORMATTER_THROW_ON_ERROR
+#include <pnt/std.hpp>
+#include <pnt/buffer.hpp>
+#include <catch.hpp>
+
+#include <sstream>
+
+using namespace pnt;
+
+namespace
+{
+  struct MoveOnly
+  {
+    MoveOnly() {}
+    MoveOnly(const MoveOnly&) = delete;
+    MoveOnly(MoveOnly&&) {}
+  };
+}
+
+namespace pnt
+{
+namespace _Formatter
+{
+  template <>
+  struct Printer<MoveOnly>
+  {
+    static const bool printable = true;
+
+    template <typename Formatter>
+    static void print(Formatter& formatter, const MoveOnly&)
+    {
+      writeAscii(formatter.streambuf(), "move-only");
+    }
+  };
+}
+}
+
+TEST_CASE("std/tuple", "pairs and tuples")
+{
+  CHECK(format("%s", std::make_pair(1, "a")) == "(1, a)");
+  CHECK(format("%s", std::make_tuple(1, 'c', 2u, "s")) == "(1, c, 2, s)");
+  CHECK(format("%s", std::tuple<>()) == "()");
+  CHECK(format("%s", std::make_pair(std::make_pair(1, 2), 3)) ==
+      "((1, 2), 3)");
+  CHECK(format(L"%s", std::make_pair(L"a", L"b")) == L"(a, b)");
+
+  CHECK(format("[%10s]", std::make_pair(1, 2)) == "[    (1, 2)]");
+  CHECK(format("[%-10s]", std::make_pair(1, 2)) == "[(1, 2)    ]");
+  CHECK(format("[%2s]", std::make_pair(1, 2)) == "[(1, 2)]");
+}
+
+TEST_CASE("std/pointers", "smart pointers")
+{
+  std::unique_ptr<int> unique(new int(1));
+  std::shared_ptr<int> shared(new int(2));
+
+  CHECK(format("%s", unique) ==
+      format("%s", static_cast<const void*>(unique.get())));
+  CHECK(format("%s", shared) ==
+      format("%s", static_cast<const void*>(shared.get())));
+  CHECK(format("%s", std::unique_ptr<int>()) ==
+      format("%s", static_cast<const void*>(nullptr)));
+}
+
+TEST_CASE("std/error_code", "error codes and conditions")
+{
+  std::error_code code = std::make_error_code(std::errc::no_such_file_or_directory);
+  CHECK(format("%s", code) == "generic:2");
+  CHECK(format("%s", std::error_condition(code.value(),
+          std::system_category())) == "system:2");
+  CHECK(format("[%11s]", code) == "[  generic:2]");
+}
+
+#ifdef PNT_HAS_PTHREAD
+TEST_CASE("std/thread_id", "thread ids")
+{
+  std::thread::id id = std::this_thread::get_id();
+  std::ostringstream ss;
+  ss << id;
+  CHECK(format("%s", id) == ss.str());
+#if defined(__linux__)
+  CHECK(format("%s", id) == format("%s", pthread_self()));
+#endif
+}
+#endif
+
+TEST_CASE("std/duration", "chrono durations")
+{
+  CHECK(format("%s", std::chrono::nanoseconds(5)) == "5ns");
+  CHECK(format("%s", std::chrono::microseconds(-5)) == "-5us");
+  CHECK(format("%s", std::chrono::milliseconds(15)) == "15ms");
+  CHECK(format("%s", std::chrono::seconds(2)) == "2s");
+  CHECK(format("%s", std::chrono::minutes(3)) == "3min");
+  CHECK(format("%s", std::chrono::hours(4)) == "4h");
+  CHECK(format("%s", std::chrono::duration<int, std::ratio<86400>>(1)) ==
+      "1d");
+  CHECK(format("%s", std::chrono::duration<int, std::ratio<1, 30>>(7)) ==
+      "7[1/30]s");
+  CHECK(format("%s", std::chrono::duration<int, std::ratio<10>>(7)) ==
+      "7[10]s");
+  CHECK(format("%-6s|", std::chrono::milliseconds(15)) == "15ms  |");
+}
+
+TEST_CASE("std/move_only", "arguments are taken by reference")
+{
+  MoveOnly value;
+  CHECK(format("%s", value) == "move-only");
+  CHECK(format("%12s", value) == "   move-only");
+
+  Buffer buffer;
+  writef(buffer, "%s %s", value, std::unique_ptr<int>());
+  CHECK(buffer.str().compare(0, 10, "move-only ") == 0);
+}
+
+#ifdef PNT_HAS_OPTIONAL_VARIANT
+TEST_CASE("std/optional_variant", "optionals and variants")
+{
+  CHECK(format("%s", std::optional<int>(3)) == "3");
+  CHECK(format("%s", std::optional<int>()) == "nullopt");
+  CHECK(format("%s", std::variant<int, const char*>("a")) == "a");
+  CHECK(format("%s", std::variant<int, const char*>(1)) == "1");
+  CHECK(format("%4s", std::optional<int>(3)) == "   3");
+}
+#endif
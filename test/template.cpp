@@ -0,0 +1,168 @@
+#define FORMATTER_THROW_ON_ERROR
+#include <pnt/template.hpp>
+#include <pnt/buffer.hpp>
+#include <catch.hpp>
+
+#include <string>
+#include <vector>
+
+using namespace pnt;
+
+namespace
+{
+
+std::string render(const Template& tpl, const TemplateData& data)
+{
+  Buffer buffer;
+  tpl.render(buffer, data);
+  return buffer.str();
+}
+
+}
+
+TEST_CASE("template/fields", "named fields with format items")
+{
+  Template tpl("{{name}} is {{ age:%3d }} {{ratio:%.2f}}, {{name}} {{ok}}"
+      "{{missing}}!");
+  REQUIRE(tpl.valid());
+  CHECK(tpl.fieldCount() == 5);
+  CHECK(tpl.field("name") == 0);
+  CHECK(tpl.field("age") == 1);
+  CHECK(tpl.field("nope") == static_cast<unsigned int>(-1));
+
+  TemplateData data(tpl);
+  std::string name = "Ada";
+  data.set("name", name).set(tpl.field("age"), 36).set("ok", true);
+  data.set("unknown", 1);
+  CHECK(render(tpl, data) == "Ada is  36 , Ada true!");
+
+  // the values are integers, %f is not compatible with them
+  CHECK_THROWS_AS(render(tpl, data.set("ratio", 1)), FormatError);
+
+  Template other("[{{name:%-8s}}] {{value:%x}} {{value:%+d}}");
+  TemplateData otherData(other);
+  otherData.set("name", "a long name").set("value", 255u);
+  CHECK(render(other, otherData) == "[a long name] ff +255");
+  otherData.set("name", TemplateValue("a long name", 6));
+  CHECK(render(other, otherData) == "[a long  ] ff +255");
+
+  CHECK(render(Template(""), data) == "");
+  CHECK(render(Template("no tags {here}"), data) == "no tags {here}");
+}
+
+TEST_CASE("template/sections", "each, if and unless")
+{
+  Template tpl(
+      "{{title}}:\n"
+      "{{#each rows}}\n"
+      "  {{@index}}. {{name:%-5s}}|{{#if @first}} first{{/if}}"
+      "{{#unless @last}},{{/unless}}\n"
+      "{{/each}}\n"
+      "{{#if rows}}\n"
+      "done\n"
+      "{{else}}\n"
+      "empty\n"
+      "{{/if}}\n");
+  REQUIRE(tpl.valid());
+
+  std::vector<TemplateData> rows;
+  for (const char* name : {"a", "bb", "ccc"})
+  {
+    rows.emplace_back(tpl);
+    rows.back().set("name", name);
+  }
+
+  TemplateData data(tpl);
+  data.set("title", "list").set("rows", rows);
+  CHECK(render(tpl, data) ==
+      "list:\n"
+      "  0. a    | first,\n"
+      "  1. bb   |,\n"
+      "  2. ccc  |\n"
+      "done\n");
+
+  data.set("rows", std::vector<TemplateData>());
+  CHECK(render(tpl, data) == "list:\nempty\n");
+
+  // truthiness
+  Template cond("{{#if x}}y{{else}}n{{/if}}");
+  TemplateData value(cond);
+  CHECK(render(cond, value) == "n");
+  CHECK(render(cond, value.set("x", 0)) == "n");
+  CHECK(render(cond, value.set("x", 2)) == "y");
+  CHECK(render(cond, value.set("x", "")) == "n");
+  CHECK(render(cond, value.set("x", "a")) == "y");
+  CHECK(render(cond, value.set("x", false)) == "n");
+}
+
+TEST_CASE("template/scopes", "nested lists and lookups in the enclosing data")
+{
+  Template tpl("{{#each groups}}{{name}}[{{#each items}}{{name}}{{sep}}"
+      "{{@index}}{{/each}}]{{/each}}");
+  REQUIRE(tpl.valid());
+
+  std::vector<TemplateData> a(2, TemplateData(tpl));
+  a[0].set("name", "x");
+  // not set in the item, taken from the group
+  std::vector<TemplateData> b(1, TemplateData(tpl));
+  b[0].set("sep", "/");
+
+  std::vector<TemplateData> groups(2, TemplateData(tpl));
+  groups[0].set("name", "A").set("items", a);
+  groups[1].set("name", "B").set("items", b);
+
+  TemplateData data(tpl);
+  data.set("groups", groups).set("sep", ":");
+  CHECK(render(tpl, data) == "A[x:0A:1]B[B/0]");
+
+  // a list is not printable
+  CHECK_THROWS_AS(render(Template("{{groups}}"), data), FormatError);
+}
+
+TEST_CASE("template/standalone", "section lines leave no empty line")
+{
+  Template tpl(
+      "a\n"
+      "  {{#if x}}  \r\n"
+      "b {{#if x}}c{{/if}}\n"
+      "  {{! comment }}\n"
+      "{{/if}}\n"
+      "d");
+  TemplateData data(tpl);
+  data.set("x", true);
+  CHECK(render(tpl, data) == "a\nb c\nd");
+  data.set("x", false);
+  CHECK(render(tpl, data) == "a\nd");
+}
+
+TEST_CASE("template/errors", "invalid templates")
+{
+  const char* invalid[] = {
+    "{{",
+    "{{}}",
+    "{{#if x}}",
+    "{{/if}}",
+    "{{#each x}}{{/if}}",
+    "{{#each x}}{{else}}{{/each}}",
+    "{{#if x}}{{else}}{{else}}{{/if}}",
+    "{{#while x}}{{/while}}",
+    "{{#if}}{{/if}}",
+    "{{@index}}",
+    "{{#each x}}{{@size}}{{/each}}",
+    "{{#each @index}}{{/each}}",
+    "{{x:}}",
+    "{{x:d}}",
+    "{{x:%1$d}}",
+    "{{x:%*d}}",
+    "{{x:%dd}}",
+    "{{x:%k}}",
+  };
+
+  for (const char* text : invalid)
+  {
+    INFO(text);
+    CHECK_THROWS_AS(Template(text), FormatError);
+  }
+}
+
+// vim: ts=2:sw=2:sts=2:expandtab
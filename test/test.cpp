@@ -1,6 +1,8 @@
 #define FORMATTER_THROW_ON_ERROR
 #include <pnt.hpp>
+#include <compiled_formats.hpp>
 #include <utility>
+#include <vector>
 #define CATCH_CONFIG_MAIN
 #include <catch.hpp>
 
@@ -238,6 +240,69 @@ TEST_CASE("int/non decimal/explicit base/fill",
   testCase("aa 00017 bb", "aa %#05o bb", 15);
 }
 
+TEST_CASE("int/bigint", "arbitrary precision integers")
+{
+  const std::uint64_t zero[] = {0, 0};
+  const std::uint64_t small[] = {1234567890123456789ull, 0};
+  const std::uint64_t two64[] = {0, 1};
+  const std::uint64_t max128[] = {~0ull, ~0ull};
+
+  testCase("0", "%d", bigint(zero, 2));
+  testCase("0", "%d", bigint(zero, 0, true));
+  testCase("1234567890123456789", "%d", bigint(small, 2));
+  testCase("18446744073709551616", "%d", bigint(two64, 2));
+  testCase("-18446744073709551616", "%d", bigint(two64, 2, true));
+  testCase("340282366920938463463374607431768211455", "%d",
+      bigint(max128, 2));
+  testCase("ffffffffffffffffffffffffffffffff", "%x", bigint(max128, 2));
+  testCase("0X10000000000000000", "%#X", bigint(two64, 2, true));
+  testCase("2000000000000000000000", "%o", bigint(two64, 2));
+  testCase("1" + std::string(64, '0'), "%b", bigint(two64, 2));
+  testCase("[   +18446744073709551616]", "[%+24d]", bigint(two64, 2));
+  testCase("[-0018446744073709551616]", "[%023d]", bigint(two64, 2, true));
+  testCase("[18446744073709551616   ]", "[%-23d]", bigint(two64, 2));
+  testCase("[0000112210f47de98115]", "[%.20x]", bigint(small, 1));
+  CHECK_THROWS(testCase("", "%s", bigint(small, 1)));
+}
+
+TEST_CASE("int/bigint/large", "divide and conquer decimal conversion")
+{
+  // 10^k - 1 and 10^k, built by multiplying by 10
+  std::vector<std::uint64_t> limbs(1, 1);
+  std::vector<std::uint64_t> scratch(bigintScratchSize(200));
+  for (int k = 1; k <= 3000; ++k)
+  {
+    std::uint64_t carry = 0;
+    for (auto& limb : limbs)
+    {
+      unsigned __int128 product = static_cast<unsigned __int128>(limb) * 10 +
+        carry;
+      limb = static_cast<std::uint64_t>(product);
+      carry = static_cast<std::uint64_t>(product >> 64);
+    }
+    if (carry)
+      limbs.push_back(carry);
+
+    if (k % 997 && k % 19)
+      continue;
+
+    SCOPED_INFO("10^" << k);
+    testCase("1" + std::string(k, '0'), "%d",
+        bigint(limbs.data(), limbs.size(), false, scratch.data(),
+          scratch.size()));
+
+    std::vector<std::uint64_t> minusOne(limbs);
+    for (auto& limb : minusOne)
+      if (limb-- != 0)
+        break;
+    testCase(std::string(k, '9'), "%d",
+        bigint(minusOne.data(), minusOne.size(), false, scratch.data(),
+          scratch.size()));
+  }
+
+  CHECK_THROWS(testCase("", "%d", bigint(limbs.data(), limbs.size())));
+}
+
 TEST_CASE("char", "char argument")
 {
   testCase("aa a bb", "aa %c bb", 'a');
@@ -268,6 +333,13 @@ TEST_CASE("s/string/fill", "string with fill")
   testCase("aa let me be       bb", "aa %-15s bb", "let me be");
 }
 
+TEST_CASE("s/string/fill/too small", "string longer than the width")
+{
+  testCase("aa let me be bb", "aa %3s bb", "let me be");
+  testCase("aa let me be bb", "aa %-3s bb", "let me be");
+  testCase("aa false bb", "aa %2s bb", false);
+}
+
 TEST_CASE("s/string/castable object", "%s with string-castable argument")
 {
   struct Obj
@@ -325,6 +397,25 @@ TEST_CASE("unicode", "unicode strings")
   testCase(L"aa x bb", L"aa %c bb", L'x');
 }
 
+TEST_CASE("unicode/integers", "integers in wide strings")
+{
+  testCase(L"aa 42 bb", L"aa %d bb", 42);
+  testCase(L"0 7 -7 10 99 100 -123456789", L"%d %d %d %d %d %d %d",
+      0, 7, -7, 10, 99, 100, -123456789);
+  testCase(L"aa -9223372036854775808 bb", L"aa %d bb",
+      -9223372036854775807ll - 1);
+  testCase(L"aa 18446744073709551615 bb", L"aa %d bb",
+      18446744073709551615llu);
+  testCase(L"[   +0042] [-42   ] [0x2a] [0X2A] [101010] [052]",
+      L"[%+8.4d] [%-6d] [%#x] [%#X] [%b] [%#o]", 42, -42, 42, 42, 42, 42);
+  testCase(L"-32768 65535", L"%d %d", static_cast<short>(-32768),
+      static_cast<unsigned short>(65535));
+
+  std::wstring longFormat(300, L'a');
+  testCase(longFormat + L"1", (longFormat + L"%d").c_str(), 1);
+  testCase(L"aa " + longFormat + L" bb", L"aa %s bb", longFormat.c_str());
+}
+
 TEST_CASE("error/not enough arguments", "not enough arguments")
 {
   CHECK_THROWS(testCase("", "%d %d %d", 1, 2));
@@ -344,4 +435,175 @@ TEST_CASE("error/invalid format string", "invalid format string")
   CHECK_THROWS(testCase("", "%$s", "test"));
 }
 
+TEST_CASE("simd/kernels", "SIMD kernels agree with the scalar ones")
+{
+  char buf[256];
+  const _Simd::Kernels& scalar = _Simd::kernelsFor(simd::Scalar);
+
+  for (int level = simd::Scalar; level <= simd::detectLevel(); ++level)
+  {
+    const _Simd::Kernels& kernels =
+      _Simd::kernelsFor(static_cast<simd::Level>(level));
+    SCOPED_INFO("level: " << simd::levelName(static_cast<simd::Level>(level)));
+
+    for (int offset = 0; offset < 64; ++offset)
+      for (int size = 0; size < 150; size += 7)
+      {
+        char* str = buf + offset;
+        for (int i = 0; i < size; ++i)
+          str[i] = 'a' + i % 26;
+        str[size] = '\0';
+
+        CHECK(kernels.scan(str, '%') == str + size);
+        if (size)
+        {
+          str[size/2] = '%';
+          CHECK(kernels.scan(str, '%') == str + size/2);
+          str[size/3] = '\n';
+        }
+        CHECK(kernels.findAny(str, str + size, '"', '\\', '\n') ==
+            scalar.findAny(str, str + size, '"', '\\', '\n'));
+      }
+
+    wchar_t wbuf[256];
+    for (int offset = 0; offset < 32; ++offset)
+      for (int size = 0; size < 150; size += 7)
+      {
+        wchar_t* str = wbuf + offset;
+        for (int i = 0; i < size; ++i)
+          str[i] = i % 2 ? L'a' + i % 26 : 0x2500 + i;
+        str[size] = L'\0';
+
+        CHECK(kernels.wscan(str, L'%') == str + size);
+        if (size)
+        {
+          str[size/2] = L'%';
+          CHECK(kernels.wscan(str, L'%') == str + size/2);
+          // same low byte as '%'
+          str[size/3] = 0x2525;
+          CHECK(kernels.wscan(str, L'%') == str + size/2);
+        }
+      }
+
+    const std::uint32_t values[] =
+      {0, 1, 9, 10, 99999999, 12345678, 10000000, 87654321};
+    for (std::uint32_t value : values)
+    {
+      char expected[8], result[8];
+      scalar.digits8(value, expected);
+      kernels.digits8(value, result);
+      CHECK(std::string(expected, 8) == std::string(result, 8));
+    }
+
+    unsigned char bytes[150];
+    for (int i = 0; i < 150; ++i)
+      bytes[i] = i * 37 + 11;
+    for (int size = 0; size <= 150; size += 3)
+      for (bool url : {false, true})
+      {
+        char expected[200], result[200];
+        std::string expectedStr(expected,
+            scalar.base64(bytes, size, expected, url));
+        CHECK(expectedStr ==
+            std::string(result, kernels.base64(bytes, size, result, url)));
+      }
+  }
+}
+
+TEST_CASE("s/base64", "binary data in Base64")
+{
+  testCase("", "%s", base64("", 0));
+  testCase("Zg==", "%s", base64("f", 1));
+  testCase("Zm8=", "%s", base64("fo", 2));
+  testCase("Zm9v", "%s", base64("foo", 3));
+  testCase("Zm9vYg==", "%s", base64("foob", 4));
+  testCase("Zm9vYmE=", "%s", base64("fooba", 5));
+  testCase("Zm9vYmFy", "%s", base64("foobar", 6));
+  testCase("Zm9vYg", "%s", base64url("foob", 4));
+  testCase("Zm9vYmE", "%s", base64url("fooba", 5));
+  testCase("-_8", "%s", base64url("\xfb\xff", 2));
+  testCase("+/8=", "%s", base64("\xfb\xff", 2));
+  testCase("[    Zm8=]", "[%8s]", base64("fo", 2));
+  testCase("[Zm8=    ]", "[%-8s]", base64("fo", 2));
+  testCase(L"Zm9vYmE=", L"%s", base64("fooba", 5));
+
+  // longer than the encoding blocks
+  std::string data, expected;
+  for (int i = 0; i < 3000; ++i)
+  {
+    data += "foo";
+    expected += "Zm9v";
+  }
+  data += 'f';
+  expected += "Zg==";
+  testCase(expected, "%s", base64(data.data(), data.size()));
+
+  CHECK_THROWS(testCase("", "%d", base64("f", 1)));
+}
+
+TEST_CASE("simd/level", "formatting at every SIMD level")
+{
+  simd::Level initial = simd::level();
+
+  CHECK(simd::setLevel(simd::Avx512) == simd::detectLevel());
+
+  for (int level = simd::Scalar; level <= simd::detectLevel(); ++level)
+  {
+    CHECK(simd::setLevel(static_cast<simd::Level>(level)) == level);
+    testCase("aa 18446744073709551615 bb", "aa %d bb",
+        18446744073709551615llu);
+    testCase("aa -9223372036854775808 bb", "aa %d bb",
+        -9223372036854775807ll - 1);
+    testCase("aa 100000000 -000000000100000001 a very long string bb",
+        "aa %d %.18d %s bb", 100000000, -100000001, "a very long string");
+  }
+
+  simd::setLevel(initial);
+
+  simd::Level level;
+  CHECK(simd::parseLevel("sse4.2", level));
+  CHECK(level == simd::Sse42);
+  CHECK(!simd::parseLevel("sse4", level));
+}
+
+TEST_CASE("compiled", "format strings compiled by pntc")
+{
+  std::stringbuf sb;
+  writef(sb, PNT_COMPILED("Positive value: %+12.8d, negative value: %+12.8d\n"),
+      15, -15);
+  CHECK(sb.str() ==
+      "Positive value:    +00000015, negative value:    -00000015\n");
+  CHECK(_Formatter::CompiledPrinter<_Formatter::formatId(
+        "Positive value: %+12.8d, negative value: %+12.8d\n")>::compiled);
+
+  sb.str("");
+  writef(sb, PNT_COMPILED("%1$s %% %0$#x" "%2$-3c|"), 255, "a", 'z');
+  CHECK(sb.str() == "a % 0xffz  |");
+
+  std::wstringbuf wsb;
+  writef(wsb, PNT_COMPILED(L"aa %s bb"), L"hello");
+  CHECK(wsb.str() == L"aa hello bb");
+
+  CHECK(format(PNT_COMPILED("%1$s %% %0$#x" "%2$-3c|"), 255, "a", 'z') ==
+      "a % 0xffz  |");
+  CHECK(format(PNT_COMPILED(L"aa %s bb"), L"hello") == L"aa hello bb");
+
+  // extra arguments are ignored, as by the runtime parser
+  CHECK(format(PNT_COMPILED(L"aa %s bb"), L"hello", 12) == L"aa hello bb");
+}
+
+TEST_CASE("compiled/fallback", "format strings not compiled by pntc")
+{
+  static constexpr std::uint64_t id = _Formatter::formatId("aa %05d bb");
+  CHECK(!_Formatter::CompiledPrinter<id>::compiled);
+
+  std::stringbuf sb;
+  writef(sb, CompiledFormat<char, id>{"aa %05d bb"}, 15);
+  CHECK(sb.str() == "aa 00015 bb");
+
+  sb.str("");
+  writef(sb, CompiledFormat<char, id>{"aa %05d bb"}, 15, "extra");
+  CHECK(sb.str() == "aa 00015 bb");
+}
+
 // vim: ts=2:sw=2:sts=2:expandtab
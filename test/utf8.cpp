@@ -0,0 +1,97 @@
+#define FORMATTER_THROW_ON_ERROR
+#include <pnt/utf8.hpp>
+#include <pnt/buffer.hpp>
+#include <catch.hpp>
+
+using namespace pnt;
+
+TEST_CASE("utf8", "wide to UTF-8 encoding streambuf")
+{
+  Buffer buffer;
+  Utf8Streambuf<Buffer> utf8(buffer);
+
+  writef(utf8, L"%s|%-6s|%c|%s", L"ascii", L"été", L'€',
+      L"\U0001f600");
+  CHECK(buffer.str() == "ascii|\xc3\xa9t\xc3\xa9   |\xe2\x82\xac|"
+      "\xf0\x9f\x98\x80");
+
+  // long ASCII runs go through the SIMD kernels, with non-ASCII characters
+  // at every position of a block
+  for (std::size_t position = 0; position < 40; ++position)
+  {
+    std::wstring text(40, L'a');
+    text[position] = L'ÿ';
+    std::string expected(40, 'a');
+    expected.replace(position, 1, "\xc3\xbf");
+
+    buffer.clear();
+    utf8.sputn(text.data(), text.size());
+    CHECK(buffer.str() == expected);
+  }
+
+  // invalid code points
+  buffer.clear();
+  const wchar_t invalid[] = {L'a', static_cast<wchar_t>(0xd800),
+    static_cast<wchar_t>(0x110000), static_cast<wchar_t>(-1), L'b'};
+  utf8.sputn(invalid, 5);
+  CHECK(buffer.str() == "a\xef\xbf\xbd\xef\xbf\xbd\xef\xbf\xbd" "b");
+}
+
+TEST_CASE("utf8/utf16", "UTF-16 to UTF-8 encoding streambuf")
+{
+  Buffer buffer;
+  Utf8Streambuf<Buffer, char16_t> utf8(buffer);
+
+  const char16_t text[] = u"aé€\U0001f600z";
+  utf8.sputn(text, sizeof(text) / sizeof(text[0]) - 1);
+  CHECK(buffer.str() == "a\xc3\xa9\xe2\x82\xac\xf0\x9f\x98\x80z");
+
+  // a pair split between two writes
+  buffer.clear();
+  utf8.sputc(static_cast<char16_t>(0xd83d));
+  CHECK(buffer.size() == 0);
+  utf8.sputc(static_cast<char16_t>(0xde00));
+  CHECK(buffer.str() == "\xf0\x9f\x98\x80");
+
+  // unpaired surrogates
+  buffer.clear();
+  const char16_t unpaired[] = {0xd83d, u'a', 0xde00, 0xd83d};
+  utf8.sputn(unpaired, 4);
+  CHECK(buffer.str() == "\xef\xbf\xbd" "a\xef\xbf\xbd");
+  utf8.finish();
+  CHECK(buffer.str() == "\xef\xbf\xbd" "a\xef\xbf\xbd\xef\xbf\xbd");
+
+  std::u16string ascii(1000, u'x');
+  buffer.clear();
+  utf8.sputn(ascii.data(), ascii.size());
+  CHECK(buffer.str() == std::string(1000, 'x'));
+}
+
+TEST_CASE("utf8/kernels", "ASCII narrowing kernels")
+{
+  for (int level = simd::Scalar; level <= simd::detectLevel(); ++level)
+  {
+    _Utf8::Narrow16Kernel narrow16 =
+      _Utf8::narrow16Kernel(static_cast<simd::Level>(level));
+    _Utf8::Narrow32Kernel narrow32 =
+      _Utf8::narrow32Kernel(static_cast<simd::Level>(level));
+
+    for (std::size_t size = 0; size < 40; ++size)
+      for (std::size_t stop = 0; stop <= size; ++stop)
+      {
+        std::u16string in16(size, u'q');
+        std::u32string in32(size, U'q');
+        if (stop < size)
+        {
+          in16[stop] = 0x100;
+          in32[stop] = 0x80;
+        }
+
+        char out[40];
+        CHECK(narrow16(in16.data(), size, out) == stop);
+        CHECK(std::string(out, stop) == std::string(stop, 'q'));
+        CHECK(narrow32(in32.data(), size, out) == stop);
+        CHECK(std::string(out, stop) == std::string(stop, 'q'));
+      }
+  }
+}
@@ -0,0 +1,572 @@
+// Copyright (c) 2013, Philippe Daouadi <p.daouadi@free.fr>
+// All rights reserved.
+//
+// This file is distributed under the same license as pnt.hpp, see the
+// COPYING file.
+
+// pntc: ahead of time format string compiler.
+//
+// Usage: pntc [-o output] [--extract] inputs...
+//
+// Generates a header with one CompiledPrinter specialization per format
+// string where literal writes are sputn calls of constant size and format
+// items are constants, so that the compiler can specialize the conversions
+// for each of them. Inputs are lists of format strings, one per line with C
+// escapes, empty lines and lines starting with # being ignored. With
+// --extract, inputs are C++ sources in which the string literals passed to
+// PNT_COMPILED() are collected.
+
+#define FORMATTER_THROW_ON_ERROR
+#include <pnt.hpp>
+
+#include <algorithm>
+#include <cctype>
+#include <cstdio>
+#include <fstream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using namespace pnt;
+
+namespace
+{
+
+class CompileError : public std::exception
+{
+  public:
+    CompileError(const std::string& message) :
+      m_message(message)
+    {}
+
+    const char* what() const noexcept
+    {
+      return m_message.c_str();
+    }
+
+  private:
+    std::string m_message;
+};
+
+struct Location
+{
+  std::string file;
+  unsigned int line;
+};
+
+std::string where(const Location& location)
+{
+  std::ostringstream ss;
+  ss << location.file << ":" << location.line << ": ";
+  return ss.str();
+}
+
+unsigned int hexValue(char c)
+{
+  if (c >= '0' && c <= '9')
+    return c - '0';
+  if (c >= 'a' && c <= 'f')
+    return c - 'a' + 10;
+  if (c >= 'A' && c <= 'F')
+    return c - 'A' + 10;
+  return 16;
+}
+
+// Unescapes the C escape sequence starting after the backslash at iter.
+char unescape(std::string::const_iterator& iter,
+    std::string::const_iterator end, const Location& location)
+{
+  if (iter == end)
+    throw CompileError(where(location) + "unterminated escape sequence");
+
+  char c = *iter++;
+  switch (c)
+  {
+    case 'n': return '\n';
+    case 't': return '\t';
+    case 'r': return '\r';
+    case 'a': return '\a';
+    case 'b': return '\b';
+    case 'f': return '\f';
+    case 'v': return '\v';
+    case '\\':
+    case '\'':
+    case '"':
+    case '?':
+      return c;
+    case 'x':
+      {
+        unsigned int value = 0;
+        if (iter == end || hexValue(*iter) == 16)
+          throw CompileError(where(location) + "invalid \\x escape");
+        for (; iter != end && hexValue(*iter) != 16; ++iter)
+          value = value * 16 + hexValue(*iter);
+        if (value > 0xff)
+          throw CompileError(where(location) + "\\x escape out of range");
+        return static_cast<char>(value);
+      }
+    default:
+      if (c >= '0' && c <= '7')
+      {
+        unsigned int value = c - '0';
+        for (int i = 0; i < 2 && iter != end && *iter >= '0' && *iter <= '7';
+            ++i, ++iter)
+          value = value * 8 + (*iter - '0');
+        if (value > 0xff)
+          throw CompileError(where(location) + "octal escape out of range");
+        return static_cast<char>(value);
+      }
+      throw CompileError(where(location) + "unknown escape sequence \\" + c);
+  }
+}
+
+struct Format
+{
+  std::string text;
+  Location location;
+};
+
+void readList(const std::string& file, std::vector<Format>& formats)
+{
+  std::ifstream in(file.c_str());
+  if (!in)
+    throw CompileError("can't open " + file);
+
+  Location location = {file, 0};
+  std::string line;
+  while (std::getline(in, line))
+  {
+    ++location.line;
+
+    if (line.empty() || line[0] == '#')
+      continue;
+
+    Format format = {std::string(), location};
+    for (auto iter = line.cbegin(); iter != line.cend(); )
+    {
+      char c = *iter++;
+      if (c == '\\')
+        c = unescape(iter, line.cend(), location);
+      format.text += c;
+    }
+
+    formats.push_back(format);
+  }
+}
+
+bool isAscii(const std::string& text)
+{
+  for (char c : text)
+    if (static_cast<unsigned char>(c) >= 0x80)
+      return false;
+  return true;
+}
+
+void extract(const std::string& file, std::vector<Format>& formats)
+{
+  std::ifstream in(file.c_str());
+  if (!in)
+    throw CompileError("can't open " + file);
+
+  std::string source((std::istreambuf_iterator<char>(in)),
+      std::istreambuf_iterator<char>());
+
+  static const std::string marker = "PNT_COMPILED(";
+
+  for (std::string::size_type pos = source.find(marker);
+      pos != std::string::npos;
+      pos = source.find(marker, pos))
+  {
+    // skip the macro definition and identifiers ending with the marker
+    if (pos > 0 && (std::isalnum(source[pos-1]) || source[pos-1] == '_'))
+    {
+      pos += marker.size();
+      continue;
+    }
+
+    Location location = {file,
+      static_cast<unsigned int>(
+          std::count(source.begin(), source.begin() + pos, '\n') + 1)};
+    pos += marker.size();
+
+    // concatenate adjacent literals
+    Format format = {std::string(), location};
+    bool found = false;
+    bool wide = false;
+    auto iter = source.cbegin() + pos;
+    while (true)
+    {
+      while (iter != source.cend() && std::isspace(*iter))
+      {
+        if (*iter == '\n')
+          ++location.line;
+        ++iter;
+      }
+
+      if (iter == source.cend())
+        break;
+
+      if (*iter == 'L' || *iter == 'u' || *iter == 'U')
+      {
+        auto quote = iter + 1;
+        if (quote != source.cend() && *quote == '8')
+          ++quote;
+        if (quote == source.cend() || *quote != '"')
+          break;
+        wide = wide || quote == iter + 1;
+        iter = quote;
+      }
+      else if (*iter == 'R')
+        throw CompileError(where(location) + "raw strings are not supported");
+      else if (*iter != '"')
+        break;
+
+      for (++iter; iter != source.cend() && *iter != '"'; )
+      {
+        char c = *iter++;
+        if (c == '\n')
+          throw CompileError(where(location) + "unterminated string");
+        if (c == '\\')
+          c = unescape(iter, source.cend(), location);
+        format.text += c;
+      }
+
+      if (iter == source.cend())
+        throw CompileError(where(location) + "unterminated string");
+
+      ++iter;
+      found = true;
+    }
+
+    // not a literal, a macro parameter for example
+    if (!found)
+      continue;
+
+    // the code units of non ASCII wide literals are unknown here, they use
+    // the runtime parser
+    if (wide && !isAscii(format.text))
+      continue;
+
+    formats.push_back(format);
+  }
+}
+
+std::string quote(const std::string& text)
+{
+  std::string out = "\"";
+  for (char c : text)
+  {
+    unsigned char u = c;
+    switch (c)
+    {
+      case '\n': out += "\\n"; break;
+      case '\t': out += "\\t"; break;
+      case '\r': out += "\\r"; break;
+      case '\\': out += "\\\\"; break;
+      case '"': out += "\\\""; break;
+      default:
+        if (u < 0x20 || u >= 0x7f)
+        {
+          char buf[8];
+          std::snprintf(buf, sizeof(buf), "\\%03o", u);
+          out += buf;
+        }
+        else
+          out += c;
+    }
+  }
+  return out + "\"";
+}
+
+std::string characters(const std::string& text)
+{
+  std::string out;
+  for (char c : text)
+  {
+    unsigned char u = c;
+    if (!out.empty())
+      out += ", ";
+    if (u >= 0x20 && u < 0x7f && c != '\'' && c != '\\')
+    {
+      out += '\'';
+      out += c;
+      out += '\'';
+    }
+    else
+    {
+      char buf[32];
+      std::snprintf(buf, sizeof(buf), "static_cast<char_type>(%u)", u);
+      out += buf;
+    }
+  }
+  return out;
+}
+
+std::string flagsName(unsigned int flags)
+{
+  static const struct
+  {
+    unsigned int flag;
+    const char* name;
+  } names[] = {
+    {_Formatter::FormatterItem::FLAG_LEFT_JUSTIFY, "FLAG_LEFT_JUSTIFY"},
+    {_Formatter::FormatterItem::FLAG_SHOW_SIGN, "FLAG_SHOW_SIGN"},
+    {_Formatter::FormatterItem::FLAG_EXPLICIT_BASE, "FLAG_EXPLICIT_BASE"},
+    {_Formatter::FormatterItem::FLAG_FILL_ZERO, "FLAG_FILL_ZERO"},
+    {_Formatter::FormatterItem::FLAG_ADD_SPACE, "FLAG_ADD_SPACE"},
+  };
+
+  std::string out;
+  for (auto& name : names)
+    if (flags & name.flag)
+    {
+      if (!out.empty())
+        out += " | ";
+      out += std::string("Item::") + name.name;
+    }
+  return out.empty() ? "0" : out;
+}
+
+std::string widthName(unsigned int width)
+{
+  if (width == _Formatter::FormatterItem::WIDTH_EMPTY)
+    return "Item::WIDTH_EMPTY";
+  return std::to_string(width) + "u";
+}
+
+// Generates the CompiledPrinter specialization of a format string, walking
+// it the same way Formatter::print does.
+// Formats which use what pntc does not generate code for, such as %*d or
+// floating point, are left to the runtime parser with a warning: nothing is
+// written for them, and their CompiledPrinter is the generic one.
+void generate(std::ostream& out, const Format& format, std::uint64_t id)
+{
+  struct Step
+  {
+    bool literal;
+    std::string text;
+    _Formatter::FormatterItem item;
+  };
+
+  std::vector<Step> steps;
+  unsigned int nbArgs = 0;
+
+  bool positional = false;
+  unsigned int position = 0;
+  const char* iter = format.text.c_str();
+  std::string literal;
+
+  try
+  {
+    while (*iter)
+    {
+      if (*iter != '%')
+      {
+        literal += *iter++;
+        continue;
+      }
+
+      ++iter;
+      if (*iter == '%')
+      {
+        literal += *iter++;
+        continue;
+      }
+      if (*iter == '(')
+        throw FormatError(FormatError::NotImplemented);
+
+      _Formatter::StringFormatterItem<const char*> fmt;
+      fmt.handleFormatter(iter);
+
+      if (fmt.width == _Formatter::FormatterItem::WIDTH_ARG ||
+          fmt.precision == _Formatter::FormatterItem::WIDTH_ARG)
+        throw FormatError(FormatError::NotImplemented);
+      switch (fmt.formatChar)
+      {
+        case 'e': case 'E': case 'f': case 'F':
+        case 'g': case 'G': case 'a': case 'A':
+          throw FormatError(FormatError::NotImplemented);
+      }
+
+      if (fmt.position == _Formatter::FormatterItem::POSITION_NONE)
+        fmt.position = position;
+      else
+      {
+        positional = true;
+        position = fmt.position;
+      }
+
+      if (!positional)
+        ++position;
+
+      if (!literal.empty())
+      {
+        steps.push_back(Step{true, literal, fmt});
+        literal.clear();
+      }
+      steps.push_back(Step{false, std::string(), fmt});
+      nbArgs = std::max(nbArgs, fmt.position + 1);
+    }
+  }
+  catch (FormatError& e)
+  {
+    std::cerr << "pntc: " << where(format.location) << e.what() << " in "
+      << quote(format.text) << ", left to the runtime parser" << std::endl;
+    return;
+  }
+
+  if (!literal.empty())
+    steps.push_back(Step{true, literal, _Formatter::FormatterItem()});
+
+  out << "// " << quote(format.text) << "\n";
+  out << "template <>\n";
+  out << "struct CompiledPrinter<0x" << std::hex << id << std::dec << "ull>\n";
+  out << "{\n";
+  out << "  static constexpr bool compiled = true;\n\n";
+
+  // arguments beyond those of the format string are ignored, as by
+  // Formatter::print and the generic CompiledPrinter, so that a call
+  // compiles the same whether its format string was generated or not
+  out << "  template <typename Streambuf";
+  for (unsigned int i = 0; i < nbArgs; ++i)
+    out << ", typename A" << i;
+  out << ", typename... Rest>\n";
+  out << "  static void print(Streambuf& streambuf,\n";
+  out << "      const typename Streambuf::char_type* format";
+  for (unsigned int i = 0; i < nbArgs; ++i)
+    out << ", const A" << i << "& a" << i;
+  out << ", const Rest&...)\n";
+  out << "  {\n";
+  out << "    typedef typename Streambuf::char_type char_type;\n";
+  out << "    typedef FormatterItem Item;\n";
+  if (!isAscii(format.text))
+    out << "    static_assert(sizeof(char_type) == 1,\n"
+      << "        \"non ASCII format strings are only compiled for bytes\");\n";
+  out << "    assert(formatId(format) == 0x" << std::hex << id << std::dec
+    << "ull);\n";
+  out << "    (void)format;\n\n";
+
+  bool hasItems = false;
+  for (auto& step : steps)
+    hasItems = hasItems || !step.literal;
+  if (hasItems)
+    out << "    Formatter<Streambuf> formatter(streambuf);\n";
+
+  unsigned int index = 0;
+  for (auto& step : steps)
+  {
+    if (step.literal)
+    {
+      out << "    static const char_type s" << index << "[] = {"
+        << characters(step.text) << "};\n";
+      out << "    streambuf.sputn(s" << index << ", " << step.text.size()
+        << ");\n";
+    }
+    else
+    {
+      out << "    static constexpr Item i" << index << " = {"
+        << step.item.position << "u, " << flagsName(step.item.flags) << ", "
+        << widthName(step.item.width) << ", "
+        << widthName(step.item.precision) << ", '"
+        << step.item.formatChar << "'};\n";
+      out << "    formatter.printItem(i" << index << ", a"
+        << step.item.position << ");\n";
+    }
+    ++index;
+  }
+
+  out << "  }\n";
+  out << "};\n\n";
+}
+
+void usage()
+{
+  std::cerr << "usage: pntc [-o output] [--extract] inputs..." << std::endl;
+}
+
+}
+
+int main(int argc, char* argv[])
+{
+  std::string output;
+  bool extractMode = false;
+  std::vector<std::string> inputs;
+
+  for (int i = 1; i < argc; ++i)
+  {
+    std::string arg = argv[i];
+    if (arg == "-o" && i + 1 < argc)
+      output = argv[++i];
+    else if (arg == "--extract")
+      extractMode = true;
+    else if (arg == "-h" || arg == "--help")
+    {
+      usage();
+      return 0;
+    }
+    else if (!arg.empty() && arg[0] == '-')
+    {
+      usage();
+      return 1;
+    }
+    else
+      inputs.push_back(arg);
+  }
+
+  try
+  {
+    std::vector<Format> formats;
+    for (auto& input : inputs)
+      if (extractMode)
+        extract(input, formats);
+      else
+        readList(input, formats);
+
+    std::ostringstream out;
+    out << "// Generated by pntc, do not edit.\n\n";
+    out << "#ifndef PNT_COMPILED_FORMATS_HPP\n";
+    out << "#define PNT_COMPILED_FORMATS_HPP\n\n";
+    out << "#include <pnt/compiled.hpp>\n\n";
+    out << "namespace pnt\n{\n\nnamespace _Formatter\n{\n\n";
+
+    std::map<std::uint64_t, const Format*> ids;
+    for (auto& format : formats)
+    {
+      std::uint64_t id = _Formatter::formatId(format.text.c_str());
+
+      auto found = ids.find(id);
+      if (found != ids.end())
+      {
+        if (found->second->text != format.text)
+          throw CompileError(where(format.location) + "hash collision with " +
+              quote(found->second->text));
+        continue;
+      }
+      ids[id] = &format;
+
+      generate(out, format, id);
+    }
+
+    out << "}\n\n}\n\n#endif\n";
+
+    if (output.empty())
+      std::cout << out.str();
+    else
+    {
+      std::ofstream file(output.c_str());
+      file << out.str();
+      if (!file)
+        throw CompileError("can't write " + output);
+    }
+  }
+  catch (CompileError& e)
+  {
+    std::cerr << "pntc: " << e.what() << std::endl;
+    return 1;
+  }
+
+  return 0;
+}
+
+// vim: ts=2:sw=2:sts=2:expandtab